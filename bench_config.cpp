@@ -0,0 +1,216 @@
+#include "config.h"
+#include <chrono>
+
+//öȡ΢׼һ̲߳ͣsetValueͬʱȡÿζȡƽʱ()
+
+template<class F>
+static double bench_ns(size_t n, F f)
+{
+	auto begin = std::chrono::steady_clock::now();
+	for (size_t i = 0; i < n; ++i)
+	{
+		f();
+	}
+	auto end = std::chrono::steady_clock::now();
+	return std::chrono::duration<double, std::nano>(end - begin).count() / n;
+}
+
+//sizeԪصvectorãgetValueÿοSnapshot
+static void bench_read(size_t size, size_t n)
+{
+	std::string name = "bench.vec" + std::to_string(size);
+	cch::ConfigVar<std::vector<int> >::ptr var =
+		cch::Config::Lookup(name, std::vector<int>(size, 0), "bench");
+	std::atomic<bool> stop(false);
+	std::atomic<uint64_t> reloads(0);
+	std::thread writer([&]() {
+		int gen = 0;
+		while (!stop)
+		{
+			var->setValue(std::vector<int>(size, ++gen));
+			++reloads;
+			std::this_thread::sleep_for(std::chrono::microseconds(100));
+		}
+	});
+	uint64_t sum = 0;
+	double copy_ns = bench_ns(n, [&]() {
+		sum += var->getValue()[size / 2];
+	});
+	double snap_ns = bench_ns(n, [&]() {
+		cch::ConfigVar<std::vector<int> >::Snapshot snap(*var);
+		sum += (*snap)[size / 2];
+	});
+	stop = true;
+	writer.join();
+	std::cout << "vector<int>(" << size << ") getValue: " << copy_ns << " ns/read, Snapshot: "
+		<< snap_ns << " ns/read, reloads=" << reloads << " (" << sum % 10 << ")" << std::endl;
+}
+
+//ǰתʽÿһ㶼ӽڵлַһYAML::LoadΪ
+template<class T>
+struct LegacyCast
+{
+	T operator() (const std::string& v) { return boost::lexical_cast<T>(v); }
+};
+
+template<class T>
+struct LegacyCast<std::vector<T> >
+{
+	std::vector<T> operator() (const std::string& v)
+	{
+		YAML::Node node = YAML::Load(v);
+		std::vector<T> vec;
+		std::stringstream ss;
+		for (size_t i = 0; i < node.size(); i++)
+		{
+			ss.str("");
+			ss << node[i];
+			vec.push_back(LegacyCast<T>()(ss.str()));
+		}
+		return vec;
+	}
+};
+
+template<class T>
+struct LegacyCast<std::map<std::string, T> >
+{
+	std::map<std::string, T> operator() (const std::string& v)
+	{
+		YAML::Node node = YAML::Load(v);
+		std::map<std::string, T> vec;
+		std::stringstream ss;
+		for (auto it = node.begin(); it != node.end(); it++)
+		{
+			ss.str("");
+			ss << it->second;
+			vec.insert(std::make_pair(it->first.Scalar(), LegacyCast<T>()(ss.str())));
+		}
+		return vec;
+	}
+};
+
+//10000Ƕ map<string, map<string, vector<int>>>ȽϴѽĽڵصĺʱ
+static void bench_load(size_t entries)
+{
+	typedef std::map<std::string, std::map<std::string, std::vector<int> > > Nested;
+	std::stringstream ss;
+	ss << "bench:\n  nested:\n";
+	for (size_t i = 0; i < entries; ++i)
+	{
+		ss << "    k" << i << ": {a: [1, 2, 3], b: [" << i << "]}\n";
+	}
+	YAML::Node root = YAML::Load(ss.str());
+	YAML::Node node = root["bench"]["nested"];
+	cch::ConfigVar<Nested>::ptr var = cch::Config::Lookup("bench.nested", Nested(), "bench");
+	double legacy_ms = bench_ns(1, [&]() {
+		var->setValue(LegacyCast<Nested>()(cch::YamlDump(node)));
+	}) / 1000000;
+	var->setValue(Nested());
+	double string_ms = bench_ns(1, [&]() {
+		var->fromString(cch::YamlDump(node));
+	}) / 1000000;
+	var->setValue(Nested());
+	double node_ms = bench_ns(1, [&]() {
+		var->fromNode(node);
+	}) / 1000000;
+	var->setValue(Nested());
+	double load_ms = bench_ns(1, [&]() {
+		cch::Config::LoadFromYaml(root);
+	}) / 1000000;
+	std::cout << "load " << entries << " nested entries: per-level string round-trip " << legacy_ms
+		<< " ms, fromString " << string_ms << " ms, fromNode " << node_ms
+		<< " ms, LoadFromYaml " << load_ms << " ms (" << var->getValue().size() << ")" << std::endl;
+}
+
+//ǰļطʽȰĵÿڵͬǰ׺ռlist
+static void LegacyListAll(const std::string& prefix, const YAML::Node& node,
+	std::list<std::pair<std::string, const YAML::Node> >& output)
+{
+	output.push_back(std::make_pair(prefix, node));
+	if (node.IsMap())
+	{
+		for (auto it = node.begin(); it != node.end(); it++)
+		{
+			LegacyListAll(prefix.empty() ? it->first.Scalar() : prefix + "." + it->first.Scalar(), it->second, output);
+		}
+	}
+}
+
+//õĴļkeys򲻹ĵļֻһע
+static void bench_shared_file(size_t keys)
+{
+	std::stringstream ss;
+	ss << "bench:\n  port: 8080\n";
+	for (size_t i = 0; i < keys; ++i)
+	{
+		ss << "other" << i % 100 << ":\n  key" << i << ": {a: 1, b: [1, 2]}\n";
+	}
+	YAML::Node root = YAML::Load(ss.str());
+	cch::ConfigVar<int>::ptr port = cch::Config::Lookup("bench.port", 0, "bench");
+	double legacy_ms = bench_ns(10, [&]() {
+		std::list<std::pair<std::string, const YAML::Node> > all;
+		LegacyListAll("", root, all);
+		for (auto& i : all)
+		{
+			cch::ConfigVarBase::ptr var = cch::Config::LookupBase(i.first);
+			if (var)
+			{
+				var->fromNode(i.second);
+			}
+		}
+	}) / 1000000;
+	double load_ms = bench_ns(10, [&]() {
+		cch::Config::LoadFromYaml(root);
+	}) / 1000000;
+	std::cout << "load shared file with " << keys << " unrelated keys: visit all " << legacy_ms
+		<< " ms, prefix trie " << load_ms << " ms (" << port->getValue() << ")" << std::endl;
+}
+
+//Ʋעstd::stringͲstd::string(const char*, len)
+static void bench_lookup(size_t n)
+{
+	cch::Config::Lookup("bench.lookup.a_fairly_long_config_name", 0, "bench");
+	const char* name = "bench.lookup.a_fairly_long_config_name";
+	size_t len = strlen(name);
+	size_t found = 0;
+	double str_ns = bench_ns(n, [&]() {
+		found += cch::Config::LookupBase(std::string(name, len)) != nullptr;
+	});
+	double ref_ns = bench_ns(n, [&]() {
+		found += cch::Config::LookupBase(name, len) != nullptr;
+	});
+	std::cout << "LookupBase(std::string): " << str_ns << " ns, LookupBase(const char*, len): "
+		<< ref_ns << " ns (" << found << ")" << std::endl;
+}
+
+//·϶һintãÿLookup<T>(name)CCH_CONFIG_VARľ̬
+static void bench_handle(size_t n)
+{
+	auto& handle = CCH_CONFIG_VAR(int, "bench.handle.port", 8080, "bench");
+	uint64_t sum = 0;
+	double lookup_ns = bench_ns(n, [&]() {
+		sum += cch::Config::Lookup<int>("bench.handle.port")->getValue();
+	});
+	double handle_ns = bench_ns(n, [&]() {
+		sum += handle->getValue();
+	});
+	double macro_ns = bench_ns(n, [&]() {
+		sum += CCH_CONFIG_VAR(int, "bench.handle.port", 8080, "bench")->getValue();
+	});
+	std::cout << "int config read: Lookup<T>(name) " << lookup_ns << " ns, handle " << handle_ns
+		<< " ns, inline CCH_CONFIG_VAR " << macro_ns << " ns (" << sum % 10 << ")" << std::endl;
+}
+
+int main(int argc, char** argv)
+{
+	size_t n = argc > 1 ? atoi(argv[1]) : 1000000;
+	for (size_t size : { 1, 100, 10000 })
+	{
+		bench_read(size, size >= 10000 ? n / 100 : n);
+	}
+	bench_lookup(n);
+	bench_handle(n);
+	bench_load(10000);
+	bench_shared_file(10000);
+	return 0;
+}
@@ -0,0 +1,352 @@
+#include "log.h"
+#include <chrono>
+#include <unistd.h>
+#include <fcntl.h>
+
+//ʽ΢׼ͬһ־¼ʽÿƽʱ()
+
+class NullBuf : public std::streambuf
+{
+protected:
+	int_type overflow(int_type ch) override { return traits_type::not_eof(ch); }
+	std::streamsize xsputn(const char* /*s*/, std::streamsize n) override { return n; }
+};
+
+template<class F>
+static double bench_ns(size_t n, F f)
+{
+	auto begin = std::chrono::steady_clock::now();
+	for (size_t i = 0; i < n; ++i)
+	{
+		f();
+	}
+	auto end = std::chrono::steady_clock::now();
+	return std::chrono::duration<double, std::nano>(end - begin).count() / n;
+}
+
+static void bench_formatter(const std::string& pattern, size_t n)
+{
+	cch::Logger::ptr logger(new cch::Logger("bench"));
+	cch::LogFormatter::ptr fmt(new cch::LogFormatter(pattern));
+	cch::LogEvent ev(logger, cch::LogLevel::INFO, __FILE__, __LINE__, 1234, cch::GetThreadId(), 7, time(0));
+	ev.getSS() << "formatter benchmark message " << 42;
+	cch::LogEvent::ptr event(cch::LogEvent::ptr(), &ev);
+
+	NullBuf null_buf;
+	std::ostream null_os(&null_buf);
+	size_t sink = 0;
+
+	double str_ns = bench_ns(n, [&]() {
+		sink += fmt->format(logger, cch::LogLevel::INFO, event).size();
+	});
+	double os_ns = bench_ns(n, [&]() {
+		fmt->format(null_os, logger, cch::LogLevel::INFO, event);
+	});
+	char buf[cch::LogStream::BUFFER_SIZE];
+	double buf_ns = bench_ns(n, [&]() {
+		sink += fmt->format(buf, sizeof(buf), logger, cch::LogLevel::INFO, event);
+	});
+	std::cout << "pattern=\"" << pattern << "\"" << std::endl
+		<< "  format -> char buffer : " << buf_ns << " ns/record" << std::endl
+		<< "  format -> std::string : " << str_ns << " ns/record" << std::endl
+		<< "  format -> std::ostream: " << os_ns << " ns/record" << std::endl;
+	if (sink == 0)
+	{
+		std::cout << "unexpected empty output" << std::endl;
+	}
+}
+
+//Ϣjson/logfmtת忪ֻϢ%m%nȽ
+static void bench_structured(size_t n)
+{
+	cch::Logger::ptr logger(new cch::Logger("bench"));
+	cch::LogEvent ev(logger, cch::LogLevel::INFO, __FILE__, __LINE__, 1234, cch::GetThreadId(), 7, time(0));
+	std::string msg(2048, 'a');
+	msg[1500] = '"';
+	ev.getSS() << msg;
+	ev.field("uid", 42).field("path", "/api/v1/user");
+	cch::LogEvent::ptr event(cch::LogEvent::ptr(), &ev);
+	char buf[cch::LogStream::BUFFER_SIZE];
+	size_t sink = 0;
+	for (const char* pattern : { "%m%n", "json", "logfmt" })
+	{
+		cch::LogFormatter fmt(pattern);
+		double ns = bench_ns(n, [&]() {
+			sink += fmt.format(buf, sizeof(buf), logger, cch::LogLevel::INFO, event);
+		});
+		std::cout << "2KB message pattern=\"" << pattern << "\": " << ns << " ns/record" << std::endl;
+	}
+	if (sink == 0)
+	{
+		std::cout << "unexpected empty output" << std::endl;
+	}
+}
+
+//־·( -> ־ -> appender)ĺʱappender첽ģʽֻȽϵ߳ϵĿ
+static void bench_appender(const std::string& name, cch::LogAppender::ptr appender, size_t n)
+{
+	cch::Logger::ptr logger(new cch::Logger("bench"));
+	logger->setFormatter("%d{%Y-%m-%d %H:%M:%S}%T%t%T%F%T[%p]%T[%c]%T%f:%l%T%m%n");
+	logger->addAppender(appender);
+	const char* str = "benchmark";
+	double ns = bench_ns(n, [&]() {
+		CCH_LOG_FMT_INFO(logger, "appender benchmark %s %d %f", str, 42, 1.5);
+	});
+	std::cout << name << ": " << ns << " ns/record" << std::endl;
+}
+
+//IOappendersharedΪfalseʱǰһÿappenderԼʽ
+class NullLogAppender : public cch::LogAppender
+{
+public:
+	NullLogAppender(bool shared) :m_shared(shared) {}
+	void log(cch::Logger::ptr logger, cch::LogLevel::Level level, cch::LogEvent::ptr event) override
+	{
+		char buf[cch::LogStream::BUFFER_SIZE];
+		m_bytes += m_formatter->format(buf, sizeof(buf), logger, level, event);
+	}
+	void logRendered(cch::Logger::ptr /*logger*/, cch::LogLevel::Level /*level*/, cch::LogEvent::ptr /*event*/,
+		const char* /*data*/, size_t len) override
+	{
+		m_bytes += len;
+	}
+	bool usesRendered() const override { return m_shared; }
+	std::string toYamlString() override { return ""; }
+private:
+	bool m_shared;
+	size_t m_bytes = 0;
+};
+
+//һ־Ҷformatterappender(Logger::addAppenderĬϾǹõ)
+static void bench_fan_out(int appenders, bool shared, size_t n)
+{
+	cch::Logger::ptr logger(new cch::Logger("bench"));
+	logger->setFormatter("%d{%Y-%m-%d %H:%M:%S}%T%t%T%F%T[%p]%T[%c]%T%f:%l%T%m%n");
+	for (int i = 0; i < appenders; ++i)
+	{
+		logger->addAppender(cch::LogAppender::ptr(new NullLogAppender(shared)));
+	}
+	double ns = bench_ns(n, [&]() {
+		CCH_LOG_FMT_INFO(logger, "fan out benchmark %s %d %f", "str", 42, 1.5);
+	});
+	std::cout << "fan out to " << appenders << " appenders, "
+		<< (shared ? "format once" : "format per appender") << ": " << ns << " ns/record" << std::endl;
+}
+
+//Ϣʽַʽÿζջ½¼ֻȽϸʽĲ
+//vasprintfǰLogEvent::formatmallocַٿ¼
+static void AsprintfInto(cch::LogEvent& ev, const char* fmt, ...)
+{
+	va_list al;
+	va_start(al, fmt);
+	char* buf = nullptr;
+	int len = vasprintf(&buf, fmt, al);
+	va_end(al);
+	if (len != -1)
+	{
+		ev.getSS().write(buf, len);
+		free(buf);
+	}
+}
+
+static void bench_message_format(size_t n)
+{
+	cch::Logger::ptr logger(new cch::Logger("bench"));
+	std::string str = "benchmark";
+	size_t sink = 0;
+	double asprintf_ns = bench_ns(n, [&]() {
+		cch::LogEvent ev(logger, cch::LogLevel::INFO, __FILE__, __LINE__, 0, 0, 0, 0);
+		AsprintfInto(ev, "message %s %d %u %.3f %x", str.c_str(), -42, 7u, 1.5, 255);
+		sink += ev.getContent().size();
+	});
+	double format_ns = bench_ns(n, [&]() {
+		cch::LogEvent ev(logger, cch::LogLevel::INFO, __FILE__, __LINE__, 0, 0, 0, 0);
+		ev.format("message %s %d %u %.3f %x", str.c_str(), -42, 7u, 1.5, 255);
+		sink += ev.getContent().size();
+	});
+	double print_ns = bench_ns(n, [&]() {
+		cch::LogEvent ev(logger, cch::LogLevel::INFO, __FILE__, __LINE__, 0, 0, 0, 0);
+		ev.print("message {} {} {} {:.3f} {:x}", str, -42, 7u, 1.5, 255);
+		sink += ev.getContent().size();
+	});
+	std::cout << "message vasprintf: " << asprintf_ns << " ns/record" << std::endl
+		<< "message LogEvent::format (vsnprintf): " << format_ns << " ns/record" << std::endl
+		<< "message LogEvent::print ({}): " << print_ns << " ns/record (" << sink % 10 << ")" << std::endl;
+}
+
+//ѹ첽ļappender̵߳Ŀѹʺͺ̨߳ѹķѵCPU
+static void bench_compress(cch::FileLogAppender::Compression compress, int level, size_t n)
+{
+	const char* file = "bench_compress.log";
+	cch::Logger::ptr logger(new cch::Logger("bench"));
+	logger->setFormatter("%d{%Y-%m-%d %H:%M:%S}%T%t%T%F%T[%p]%T[%c]%T%f:%l%T%m%n");
+	cch::FileLogAppender::ptr appender(new cch::FileLogAppender(file, cch::FileLogAppender::RollPolicy(), compress, level));
+	appender->setAsync(4 * 1024 * 1024, 100);
+	logger->addAppender(appender);
+	const char* str = "benchmark";
+	double ns = bench_ns(n, [&]() {
+		CCH_LOG_FMT_INFO(logger, "compress benchmark user=%s id=%d cost=%.3fms", str, 42, 1.5);
+	});
+	logger->clearAppenders();
+	//û־ˢ̰߳ʣµд
+	std::this_thread::sleep_for(std::chrono::milliseconds(300));
+	cch::FileLogAppender::CompressStats stats = appender->getCompressStats();
+	appender.reset();
+	remove(file);
+	std::cout << "FileLogAppender(async, " << cch::FileLogAppender::CompressionToString(compress)
+		<< " level " << level << "): " << ns << " ns/record";
+	if (stats.compressed_bytes)
+	{
+		std::cout << ", ratio " << (double)stats.raw_bytes / stats.compressed_bytes
+			<< ", compress " << (double)stats.cpu_ns / n << " ns/record cpu ("
+			<< stats.raw_bytes * 1e3 / std::max<uint64_t>(stats.cpu_ns, 1) << " MB/s), "
+			<< stats.blocks << " blocks";
+	}
+	std::cout << std::endl;
+}
+
+//׼ض/dev/nullȽдstd::coutwritev
+static void bench_stdout(size_t n)
+{
+	std::cout.flush();
+	int saved = dup(STDOUT_FILENO);
+	int fd = open("/dev/null", O_WRONLY);
+	dup2(fd, STDOUT_FILENO);
+	close(fd);
+	double ns[2];
+	cch::FileLogAppender::FlushStats stats;
+	for (int i = 0; i < 2; ++i)
+	{
+		cch::StdoutLogAppender::ptr out(new cch::StdoutLogAppender);
+		if (i)
+		{
+			out->setAsync(4 * 1024 * 1024, 100);
+		}
+		cch::Logger::ptr logger(new cch::Logger("bench"));
+		logger->setFormatter("%d{%Y-%m-%d %H:%M:%S}%T%t%T%F%T[%p]%T[%c]%T%f:%l%T%m%n");
+		logger->addAppender(out);
+		ns[i] = bench_ns(n, [&]() {
+			CCH_LOG_FMT_INFO(logger, "appender benchmark %s %d %f", "stdout", 42, 1.5);
+		});
+		stats = out->getFlushStats();
+	}
+	std::cout.flush();
+	dup2(saved, STDOUT_FILENO);
+	close(saved);
+	std::cout << "StdoutLogAppender(std::cout): " << ns[0] << " ns/record" << std::endl
+		<< "StdoutLogAppender(async): " << ns[1] << " ns/record, writev " << stats.flushes << " times" << std::endl;
+}
+
+//첽ģʽ°fdatasyncͳͬͺʱ
+static void bench_group_sync(size_t n)
+{
+	const char* file = "bench_sync.log";
+	cch::FileLogAppender::ptr appender(new cch::FileLogAppender(file));
+	appender->setSyncPolicy(cch::FileLogAppender::SYNC_INTERVAL, 100);
+	appender->setAsync(4 * 1024 * 1024, 10);
+	bench_appender("FileLogAppender(async, sync=interval)", appender, n);
+	cch::FileLogAppender::FlushStats stats = appender->getFlushStats();
+	std::cout << "  writev " << stats.flushes << " times, " << stats.bytes << " bytes, fdatasync " << stats.syncs
+		<< " times, max " << stats.max_sync_ns / 1000 << " us" << std::endl;
+	appender.reset();
+	remove(file);
+}
+
+int main(int argc, char** argv)
+{
+	size_t n = argc > 1 ? atoi(argv[1]) : 1000000;
+	bench_formatter("[%p]%T[%c]%T%f:%l%T%m%n", n);
+	bench_formatter("%d{%Y-%m-%d %H:%M:%S}%T%t%T%F%T[%p]%T[%c]%T%f:%l%T%m%n", n);
+	bench_formatter("%r %t %F %l %m%n", n);
+	//%dͬһ̻߳
+	bench_formatter("%d", n);
+	bench_formatter("%d{%Y-%m-%d %H:%M:%S.%6N}", n);
+	bench_formatter("json", n);
+	bench_formatter("logfmt", n);
+	bench_structured(n);
+
+	uint64_t sink = 0;
+	double now_ns = bench_ns(n, [&]() {
+		sink += cch::GetCurrentUS();
+	});
+	std::cout << "GetCurrentUS: " << now_ns << " ns/call (" << sink % 10 << ")" << std::endl;
+
+	bench_message_format(n);
+
+	//ȡ־ÿμ vs õ㻺
+	double lookup_ns = bench_ns(n, [&]() {
+		sink += CCH_LOG_NAME("system.net.http")->getId();
+	});
+	double cached_ns = bench_ns(n, [&]() {
+		sink += CCH_LOG_NAME_CACHED("system.net.http")->getId();
+	});
+	std::cout << "CCH_LOG_NAME lookup: " << lookup_ns << " ns/call" << std::endl
+		<< "CCH_LOG_NAME_CACHED lookup: " << cached_ns << " ns/call (" << sink % 10 << ")" << std::endl;
+
+	for (int i : { 1, 3, 5 })
+	{
+		bench_fan_out(i, false, n);
+		bench_fan_out(i, true, n);
+	}
+
+	//־ʱĿ
+	cch::Logger::ptr limited(new cch::Logger("limit"));
+	double every_ns = bench_ns(n, [&]() {
+		CCH_LOG_EVERY_N(limited, cch::LogLevel::ERROR, 1000000000) << "suppressed";
+	});
+	double sec_ns = bench_ns(n, [&]() {
+		CCH_LOG_FMT_PER_SEC(limited, cch::LogLevel::ERROR, 0, "suppressed %d", 1);
+	});
+	std::cout << "CCH_LOG_EVERY_N suppressed: " << every_ns << " ns/call" << std::endl
+		<< "CCH_LOG_FMT_PER_SEC suppressed: " << sec_ns << " ns/call" << std::endl;
+
+	//־ΪINFOʱDEBUG־ֻм¼ĿԱûм¼ʱ˵Ŀ
+	cch::Logger::ptr recorded(new cch::Logger("recorded"));
+	recorded->setLevel(cch::LogLevel::INFO);
+	double filtered_ns = bench_ns(n, [&]() {
+		CCH_LOG_FMT_DEBUG(recorded, "flight %d %s", 1, "recorder");
+	});
+	recorded->addAppender(cch::LogAppender::ptr(new cch::FlightRecorderLogAppender("/dev/null")));
+	double recorded_ns = bench_ns(n, [&]() {
+		CCH_LOG_FMT_DEBUG(recorded, "flight %d %s", 1, "recorder");
+	});
+	CCH_LOG_ROOT()->setLevel(cch::LogLevel::INFO);
+	double root_ns = bench_ns(n, [&]() {
+		CCH_LOG_DEBUG(CCH_LOG_ROOT()) << "disabled";
+	});
+	CCH_LOG_ROOT()->setLevel(cch::LogLevel::DEBUG);
+	std::cout << "DEBUG filtered: " << filtered_ns << " ns/call" << std::endl
+		<< "DEBUG filtered on CCH_LOG_ROOT(): " << root_ns << " ns/call" << std::endl
+		<< "DEBUG into FlightRecorderLogAppender: " << recorded_ns << " ns/call" << std::endl;
+
+	cch::FileLogAppender::ptr text(new cch::FileLogAppender("/dev/null"));
+	text->setAsync(4 * 1024 * 1024, 100);
+	bench_appender("FileLogAppender(async)", text, n);
+	if (cch::FileLogAppender::IsCompressionSupported(cch::FileLogAppender::COMPRESS_GZIP))
+	{
+		bench_compress(cch::FileLogAppender::COMPRESS_GZIP, 1, n);
+		bench_compress(cch::FileLogAppender::COMPRESS_GZIP, -1, n);
+	}
+	cch::BinaryLogAppender::ptr binary(new cch::BinaryLogAppender("/dev/null"));
+	binary->setAsync(4 * 1024 * 1024, 100);
+	bench_appender("BinaryLogAppender(async)", binary, n);
+	cch::FileLogAppender::ptr sync_file(new cch::FileLogAppender("bench_file.log"));
+	bench_appender("FileLogAppender(sync)", sync_file, n);
+	bench_group_sync(n);
+	bench_stdout(n);
+	cch::MmapLogAppender::ptr mmap(new cch::MmapLogAppender("bench_mmap.log"));
+	bench_appender("MmapLogAppender", mmap, n);
+	sync_file.reset();
+	mmap.reset();
+	remove("bench_file.log");
+	for (int i = 0; ; ++i)
+	{
+		char name[64];
+		snprintf(name, sizeof(name), "bench_mmap.log.%06d", i);
+		if (remove(name) != 0)
+		{
+			break;
+		}
+	}
+	return 0;
+}
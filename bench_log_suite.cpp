@@ -0,0 +1,214 @@
+#include "log.h"
+#include <chrono>
+#include <algorithm>
+#include <unistd.h>
+#include <fcntl.h>
+#include <stdio.h>
+
+//־׼׼formatter pattern x appender x ߳ ȫϣ
+//ÿһJSON(͵־ʱp50/p99/p999)ԱȲͬ汾ܱ֮仯
+//
+//÷bench_log_suite [ÿ̵߳־] [ļ]
+//  ļȱʡд׼ڼ׼ض/dev/null(StdoutLogAppender)
+//  ͨdupд bench_log_suite > result.jsonl Ҳ
+//
+//ʽ(ÿһJSON)
+//  {"type":"env",...}  лclock_nsһμʱĿкʱ
+//  {"type":"result","pattern":...,"appender":...,"threads":...,"records":...,"seconds":...,
+//   "throughput":...,"p50_ns":...,"p99_ns":...,"p999_ns":...,"max_ns":...}
+//
+//appenderȡֵ
+//  stdout   StdoutLogAppender׼ض/dev/null
+//  file     ͬFileLogAppenderдǰĿ¼bench_suite.log
+//  disabled ־ΪERRORǱ˵DEBUG
+
+static const char* s_patterns[] = {
+	"%d{%Y-%m-%d %H:%M:%S}%T%t%T%F%T[%p]%T[%c]%T%f:%l%T%m%n",
+	"[%p]%T[%c]%T%f:%l%T%m%n",
+	"%m%n",
+	"json",
+	"logfmt"
+};
+static const char* s_appenders[] = { "stdout", "file", "disabled" };
+static const int s_threads[] = { 1, 4, 16, 64 };
+static const char* s_file = "bench_suite.log";
+
+static inline uint64_t NowNs()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+struct BenchResult
+{
+	double seconds = 0;
+	uint64_t records = 0;
+	uint64_t p50 = 0;
+	uint64_t p99 = 0;
+	uint64_t p999 = 0;
+	uint64_t max = 0;
+};
+
+//samplesᱻ
+static uint64_t Percentile(std::vector<uint64_t>& samples, double p)
+{
+	if (samples.empty())
+	{
+		return 0;
+	}
+	size_t idx = std::min(samples.size() - 1, (size_t)(samples.size() * p));
+	std::nth_element(samples.begin(), samples.begin() + idx, samples.end());
+	return samples[idx];
+}
+
+static BenchResult RunOne(const std::string& pattern, const std::string& appender, int threads, size_t n)
+{
+	cch::Logger::ptr logger(new cch::Logger("bench"));
+	logger->setFormatter(pattern);
+	if (appender == "stdout")
+	{
+		logger->addAppender(cch::LogAppender::ptr(new cch::StdoutLogAppender));
+	}
+	else if (appender == "file")
+	{
+		logger->addAppender(cch::LogAppender::ptr(new cch::FileLogAppender(s_file)));
+	}
+	else
+	{
+		logger->addAppender(cch::LogAppender::ptr(new cch::FileLogAppender(s_file)));
+		logger->setLevel(cch::LogLevel::ERROR);
+	}
+
+	bool disabled = appender == "disabled";
+	//ÿ߳Լĺʱϲͳ
+	std::vector<std::vector<uint64_t> > samples(threads);
+	std::atomic<int> ready(0);
+	std::atomic<bool> go(false);
+	std::vector<std::thread> workers;
+	for (int t = 0; t < threads; ++t)
+	{
+		samples[t].resize(n);
+		workers.push_back(std::thread([&, t]() {
+			std::vector<uint64_t>& s = samples[t];
+			++ready;
+			while (!go.load(std::memory_order_acquire))
+			{
+				std::this_thread::yield();
+			}
+			for (size_t i = 0; i < n; ++i)
+			{
+				uint64_t begin = NowNs();
+				if (disabled)
+				{
+					CCH_LOG_FMT_DEBUG(logger, "bench suite %s %d %f", "message", (int)i, 1.5);
+				}
+				else
+				{
+					CCH_LOG_FMT_INFO(logger, "bench suite %s %d %f", "message", (int)i, 1.5);
+				}
+				s[i] = NowNs() - begin;
+			}
+		}));
+	}
+	while (ready.load() != threads)
+	{
+		std::this_thread::yield();
+	}
+	uint64_t begin = NowNs();
+	go.store(true, std::memory_order_release);
+	for (auto& i : workers)
+	{
+		i.join();
+	}
+	uint64_t end = NowNs();
+	std::cout.flush();
+	logger->clearAppenders();
+
+	std::vector<uint64_t> all;
+	all.reserve(n * threads);
+	for (auto& i : samples)
+	{
+		all.insert(all.end(), i.begin(), i.end());
+	}
+	BenchResult r;
+	r.seconds = (end - begin) / 1e9;
+	r.records = all.size();
+	r.max = all.empty() ? 0 : *std::max_element(all.begin(), all.end());
+	r.p50 = Percentile(all, 0.5);
+	r.p99 = Percentile(all, 0.99);
+	r.p999 = Percentile(all, 0.999);
+	return r;
+}
+
+//JSONַת壬patternֻֿܳɴӡַ
+static std::string JsonString(const std::string& str)
+{
+	std::string out = "\"";
+	for (char c : str)
+	{
+		if (c == '"' || c == '\\')
+		{
+			out.push_back('\\');
+		}
+		out.push_back(c);
+	}
+	out.push_back('"');
+	return out;
+}
+
+int main(int argc, char** argv)
+{
+	size_t n = argc > 1 ? atoi(argv[1]) : 10000;
+	const char* output = argc > 2 ? argv[2] : nullptr;
+
+	//дԭı׼ָļ֮ѱ׼ض/dev/null
+	int out_fd = output ? ::open(output, O_WRONLY | O_CREAT | O_TRUNC, 0644) : dup(STDOUT_FILENO);
+	FILE* out = out_fd >= 0 ? fdopen(out_fd, "w") : nullptr;
+	if (!out)
+	{
+		std::cout << "bench_log_suite open output failed: " << (output ? output : "stdout") << std::endl;
+		return 1;
+	}
+	std::cout.flush();
+	int null_fd = ::open("/dev/null", O_WRONLY);
+	if (null_fd < 0 || dup2(null_fd, STDOUT_FILENO) < 0)
+	{
+		fprintf(out, "{\"type\":\"error\",\"message\":\"redirect stdout to /dev/null failed\"}\n");
+		return 1;
+	}
+	::close(null_fd);
+
+	uint64_t clock_begin = NowNs();
+	for (int i = 0; i < 1000000; ++i)
+	{
+		NowNs();
+	}
+	double clock_ns = (NowNs() - clock_begin) / 1e6;
+	fprintf(out, "{\"type\":\"env\",\"cpus\":%u,\"records_per_thread\":%zu,\"clock_ns\":%.1f,\"min_level\":%d}\n",
+		std::thread::hardware_concurrency(), n, clock_ns, CCH_LOG_MIN_LEVEL);
+	fflush(out);
+
+	for (auto pattern : s_patterns)
+	{
+		for (auto appender : s_appenders)
+		{
+			for (auto threads : s_threads)
+			{
+				remove(s_file);
+				BenchResult r = RunOne(pattern, appender, threads, n);
+				fprintf(out, "{\"type\":\"result\",\"pattern\":%s,\"appender\":\"%s\",\"threads\":%d,"
+					"\"records\":%llu,\"seconds\":%.6f,\"throughput\":%.0f,"
+					"\"p50_ns\":%llu,\"p99_ns\":%llu,\"p999_ns\":%llu,\"max_ns\":%llu}\n",
+					JsonString(pattern).c_str(), appender, threads,
+					(unsigned long long)r.records, r.seconds, r.seconds > 0 ? r.records / r.seconds : 0.0,
+					(unsigned long long)r.p50, (unsigned long long)r.p99,
+					(unsigned long long)r.p999, (unsigned long long)r.max);
+				fflush(out);
+			}
+		}
+	}
+	remove(s_file);
+	fclose(out);
+	return 0;
+}
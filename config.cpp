@@ -1,26 +1,169 @@
 #include "config.h"
 #include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/inotify.h>
+#include <pthread.h>
+#include <chrono>
 
 namespace cch
 {
-	Config::ConfigVarMap Config::s_datas;
+	//pthreadдд٣ҺͼֻӶעżд
+	class ConfigRWMutex
+	{
+	public:
+		ConfigRWMutex() { pthread_rwlock_init(&m_lock, nullptr); }
+		~ConfigRWMutex() { pthread_rwlock_destroy(&m_lock); }
+		ConfigRWMutex(const ConfigRWMutex&) = delete;
+		ConfigRWMutex& operator=(const ConfigRWMutex&) = delete;
+		void rdlock() { pthread_rwlock_rdlock(&m_lock); }
+		void wrlock() { pthread_rwlock_wrlock(&m_lock); }
+		void unlock() { pthread_rwlock_unlock(&m_lock); }
+
+		struct ReadLock
+		{
+			ConfigRWMutex& m;
+			explicit ReadLock(ConfigRWMutex& mutex) :m(mutex) { m.rdlock(); }
+			~ReadLock() { m.unlock(); }
+		};
+		struct WriteLock
+		{
+			ConfigRWMutex& m;
+			explicit WriteLock(ConfigRWMutex& mutex) :m(mutex) { m.wrlock(); }
+			~WriteLock() { m.unlock(); }
+		};
+	private:
+		pthread_rwlock_t m_lock;
+	};
+
+	//עļָConfigVarBaseԼ(ע󲻻ͷ)ʱָ÷ַ
+	struct ConfigNameRef
+	{
+		const char* data;
+		size_t len;
+		uint64_t hash;
+
+		ConfigNameRef(const char* d, size_t l, uint64_t h) :data(d), len(l), hash(h) {}
+		ConfigNameRef(const char* d, size_t l) :data(d), len(l), hash(14695981039346656037ULL)
+		{
+			//ConfigNameHashͬFNV-1aʱѭ
+			for (size_t i = 0; i < len; ++i)
+			{
+				hash = (hash ^ (uint8_t)data[i]) * 1099511628211ULL;
+			}
+		}
+		bool operator==(const ConfigNameRef& oth) const
+		{
+			return hash == oth.hash && len == oth.len && memcmp(data, oth.data, len) == 0;
+		}
+	};
+
+	struct ConfigNameRefHash
+	{
+		size_t operator()(const ConfigNameRef& ref) const { return (size_t)ref.hash; }
+	};
 
-	static void ListAllMember(const std::string &prefix, const YAML::Node &node,
-		std::list < std::pair<std::string, const YAML::Node> > &output)
+	//עư'.'ֶɵǰ׺varΪʱһαһ
+	struct ConfigPrefixNode
 	{
-		if (prefix.find_first_not_of("abcdefghijklmnopqrstuvwxyz._0123456789") != std::string::npos)
+		ConfigVarBase::ptr var;
+		std::unordered_map<std::string, std::unique_ptr<ConfigPrefixNode> > children;
+
+		//keyܻ'.'( system.port: 1)ߣ߲ͨnullptr
+		const ConfigPrefixNode* find(const std::string& key) const
+		{
+			const ConfigPrefixNode* n = this;
+			size_t begin = 0;
+			while (n)
+			{
+				size_t end = key.find('.', begin);
+				auto it = n->children.find(key.substr(begin, end == std::string::npos ? end : end - begin));
+				n = it == n->children.end() ? nullptr : it->second.get();
+				if (end == std::string::npos)
+				{
+					break;
+				}
+				begin = end + 1;
+			}
+			return n;
+		}
+	};
+
+	struct ConfigRegistry
+	{
+		enum { SHARDS = 16 };
+		struct Shard
+		{
+			ConfigRWMutex mutex;
+			std::unordered_map<ConfigNameRef, ConfigVarBase::ptr, ConfigNameRefHash> datas;
+		};
+		Shard shards[SHARDS];
+		ConfigRWMutex prefixMutex;	//prefix
+		ConfigPrefixNode prefix;
+
+		Shard& shardOf(const ConfigNameRef& ref) { return shards[(ref.hash >> 32) % SHARDS]; }
+
+		static ConfigRegistry& GetInstance()
+		{
+			static ConfigRegistry s_registry;
+			return s_registry;
+		}
+	};
+
+	typedef std::vector<std::pair<ConfigVarBase::ptr, YAML::Node> > ConfigMatches;
+
+	//ͬʱyamlǰ׺ȸڵӽڵ˳ռƥ
+	static void LoadNode(const ConfigPrefixNode* trie, const std::string& prefix, const YAML::Node& node,
+		ConfigMatches& matches)
+	{
+		if (trie->var)
+		{
+			matches.push_back(std::make_pair(trie->var, node));
+		}
+		if (trie->children.empty() || !node.IsMap())
 		{
-			CCH_LOG_ERROR(CCH_LOG_ROOT()) << "Config invalid name: " << prefix << " : " << node;
 			return;
 		}
-		output.push_back(std::make_pair(prefix, node));
-		if (node.IsMap())
+		for (auto it = node.begin(); it != node.end(); it++)
 		{
-			for (auto it = node.begin(); it != node.end(); it++)
+			const std::string& key = it->first.Scalar();
+			if (key.empty())
 			{
-				ListAllMember(prefix.empty() ? it->first.Scalar() : prefix + "." + it->first.Scalar(), it->second, output);
+				continue;
+			}
+			if (key.find_first_not_of("abcdefghijklmnopqrstuvwxyz._0123456789") != std::string::npos)
+			{
+				CCH_LOG_ERROR(CCH_LOG_ROOT()) << "Config invalid name: " << prefix << key << " : " << it->second;
+				continue;
 			}
+			const ConfigPrefixNode* child = trie->find(key);
+			if (child)
+			{
+				LoadNode(child, prefix + key + ".", it->second, matches);
+			}
+		}
+	}
+
+	std::string YamlToString(const YAML::Node& node)
+	{
+		if (node.IsScalar())
+		{
+			return node.Scalar();
 		}
+		return YamlDump(node);
+	}
+
+	std::string YamlDump(const YAML::Node& node)
+	{
+		std::stringstream ss;
+		ss << node;
+		return ss.str();
+	}
+
+	bool ConfigVarBase::fromNode(const YAML::Node& node)
+	{
+		return fromString(YamlToString(node));
 	}
 
 	ConfigVarBase::ConfigVarBase(const std::string & name, const std::string & description) 
@@ -31,38 +174,190 @@ namespace cch
 
 	void Config::LoadFromYaml(const YAML::Node & root)
 	{
-		std::list<std::pair<std::string, const YAML::Node> > all_nodes;
-		ListAllMember("", root, all_nodes);
+		ConfigRegistry& reg = ConfigRegistry::GetInstance();
+		ConfigMatches matches;
+		{
+			ConfigRWMutex::ReadLock lock(reg.prefixMutex);
+			LoadNode(&reg.prefix, "", root, matches);
+		}
+		//ãصLookupעµ
+		for (auto& i : matches)
+		{
+			i.first->fromNode(i.second);
+		}
+	}
 
-		for (auto&i : all_nodes)
+	ConfigVarBase::ptr Config::Register(ConfigVarBase::ptr var)
+	{
+		ConfigRegistry& reg = ConfigRegistry::GetInstance();
+		const std::string& name = var->getName();
+		ConfigNameRef ref(name.data(), name.size());
 		{
-			std::string key = i.first;
-			if (key.empty())
-				continue;
-			std::transform(key.begin(), key.end(), key.begin(), ::tolower);
-			ConfigVarBase::ptr var = LookupBase(key);
-			if (var)
+			ConfigRegistry::Shard& shard = reg.shardOf(ref);
+			ConfigRWMutex::WriteLock lock(shard.mutex);
+			auto rt = shard.datas.insert(std::make_pair(ref, var));
+			if (!rt.second)
 			{
-				if (i.second.IsScalar())
-				{
-					var->fromString(i.second.Scalar());
-				}
-				else
-				{
-					std::stringstream ss;
-					ss << i.second;
-					var->fromString(ss.str());
-				}
+				return rt.first->second;
 			}
 		}
+		ConfigRWMutex::WriteLock lock(reg.prefixMutex);
+		ConfigPrefixNode* n = &reg.prefix;
+		size_t begin = 0;
+		while (true)
+		{
+			size_t end = name.find('.', begin);
+			std::unique_ptr<ConfigPrefixNode>& child =
+				n->children[name.substr(begin, end == std::string::npos ? end : end - begin)];
+			if (!child)
+			{
+				child.reset(new ConfigPrefixNode);
+			}
+			n = child.get();
+			if (end == std::string::npos)
+			{
+				break;
+			}
+			begin = end + 1;
+		}
+		n->var = var;
+		return var;
 	}
 
-	ConfigVarBase::ptr Config::LookupBase(const std::string & name)
+	ConfigVarBase::ptr Config::LookupBase(const char* name, size_t len)
 	{
-		auto it = s_datas.find(name);
+		return LookupBase(name, len, ConfigNameRef(name, len).hash);
+	}
 
-		return it==s_datas.end() ? nullptr : it->second;
+	ConfigVarBase::ptr Config::LookupBase(const char* name, size_t len, uint64_t hash)
+	{
+		ConfigNameRef ref(name, len, hash);
+		ConfigRegistry::Shard& shard = ConfigRegistry::GetInstance().shardOf(ref);
+		ConfigRWMutex::ReadLock lock(shard.mutex);
+		auto it = shard.datas.find(ref);
+		return it == shard.datas.end() ? nullptr : it->second;
 	}
 
-}
+	ConfigFileWatcher::ConfigFileWatcher(const std::string& path, uint32_t debounce_ms)
+		:m_path(path), m_debounce(debounce_ms), m_reloads(0)
+	{
+		size_t pos = path.rfind('/');
+		m_dir = pos == std::string::npos ? "." : pos == 0 ? "/" : path.substr(0, pos);
+		m_file = pos == std::string::npos ? path : path.substr(pos + 1);
+	}
+
+	ConfigFileWatcher::~ConfigFileWatcher()
+	{
+		stop();
+	}
+
+	bool ConfigFileWatcher::start()
+	{
+		if (m_thread.joinable())
+		{
+			return true;
+		}
+		m_inotify = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+		if (m_inotify < 0 || inotify_add_watch(m_inotify, m_dir.c_str(),
+			IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE | IN_DELETE) < 0 || pipe2(m_wakeup, O_CLOEXEC) != 0)
+		{
+			CCH_LOG_ERROR(CCH_LOG_ROOT()) << "ConfigFileWatcher watch " << m_dir << " failed: " << strerror(errno);
+			stop();
+			return false;
+		}
+		m_thread = std::thread(&ConfigFileWatcher::run, this);
+		return true;
+	}
+
+	void ConfigFileWatcher::stop()
+	{
+		if (m_thread.joinable())
+		{
+			char c = 0;
+			if (write(m_wakeup[1], &c, 1) < 0)
+			{
+				CCH_LOG_ERROR(CCH_LOG_ROOT()) << "ConfigFileWatcher wakeup failed: " << strerror(errno);
+			}
+			m_thread.join();
+		}
+		for (int* fd : { &m_inotify, &m_wakeup[0], &m_wakeup[1] })
+		{
+			if (*fd >= 0)
+			{
+				::close(*fd);
+				*fd = -1;
+			}
+		}
+	}
 
+	bool ConfigFileWatcher::reload()
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		YAML::Node root;
+		try
+		{
+			root = YAML::LoadFile(m_path);
+		}
+		catch (std::exception& e)
+		{
+			CCH_LOG_ERROR(CCH_LOG_ROOT()) << "ConfigFileWatcher load " << m_path << " failed: " << e.what();
+			return false;
+		}
+		Config::LoadFromYaml(root);
+		++m_reloads;
+		return true;
+	}
+
+	void ConfigFileWatcher::run()
+	{
+		typedef std::chrono::steady_clock Clock;
+		bool pending = false;
+		Clock::time_point deadline;	//һα仯֮ٹm_debounce룬õʱӣϵͳʱӰ
+		alignas(struct inotify_event) char buf[4096];
+		while (true)
+		{
+			int timeout = -1;
+			if (pending)
+			{
+				Clock::time_point now = Clock::now();
+				//ȡ룬ǰתһ
+				timeout = deadline > now ? (int)std::chrono::duration_cast<std::chrono::milliseconds>(
+					deadline - now + std::chrono::milliseconds(1) - Clock::duration(1)).count() : 0;
+			}
+			struct pollfd fds[2] = { { m_inotify, POLLIN, 0 }, { m_wakeup[0], POLLIN, 0 } };
+			int rt = poll(fds, 2, timeout);
+			if (rt < 0 && errno != EINTR)
+			{
+				CCH_LOG_ERROR(CCH_LOG_ROOT()) << "ConfigFileWatcher poll failed: " << strerror(errno);
+				return;
+			}
+			if (fds[1].revents)
+			{
+				return;
+			}
+			if (fds[0].revents & POLLIN)
+			{
+				ssize_t n;
+				while ((n = read(m_inotify, buf, sizeof(buf))) > 0)
+				{
+					for (char* p = buf; p < buf + n; )
+					{
+						struct inotify_event* ev = (struct inotify_event*)p;
+						if (ev->len && m_file == ev->name && !(ev->mask & IN_DELETE))
+						{
+							pending = true;
+							deadline = Clock::now() + std::chrono::milliseconds(m_debounce);
+						}
+						p += sizeof(struct inotify_event) + ev->len;
+					}
+				}
+				continue;
+			}
+			if (pending && Clock::now() >= deadline)
+			{
+				pending = false;
+				reload();
+			}
+		}
+	}
+}
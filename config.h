@@ -14,9 +14,49 @@
 #include <unordered_map>
 #include <unordered_set>
 #include <functional>
+#include <type_traits>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include "rcu.h"
+#include <string.h>
+#if __cplusplus >= 201703L
+#include <string_view>
+#endif
+
+//УơhashעһΣغھ̬ConfigHandle<type>֮ÿζȡֻǽָ롣
+// static auto& g_port = CCH_CONFIG_VAR(int, "system.port", 8080, "port"); g_port->getValue()
+//ƱַСдĸ֡'.''_'ַʱ뱨(Ϣconfig_error_invalid_name)
+//ͬѾעʱһִе׳std::invalid_argumentĬֵþֲ
+#define CCH_CONFIG_VAR(type, name, default_value, description) \
+	([]() -> const cch::ConfigHandle<type>& { \
+		static const cch::ConfigHandle<type> s_handle(name, sizeof(name) - 1, \
+			std::integral_constant<uint64_t, cch::ConfigCheckedHash(name, sizeof(name) - 1)>::value, \
+			default_value, description); \
+		return s_handle; }())
 
 namespace cch
 {
+	//ƵFNV-1a hashעƬҡC++11constexprֻдɵݹ
+	constexpr uint64_t ConfigNameHash(const char* name, size_t len, uint64_t hash = 14695981039346656037ULL)
+	{
+		return len == 0 ? hash : ConfigNameHash(name + 1, len - 1, (hash ^ (uint8_t)name[0]) * 1099511628211ULL);
+	}
+
+	constexpr bool ConfigNameValid(const char* name, size_t len)
+	{
+		return len == 0 || (((name[0] >= 'a' && name[0] <= 'z') || (name[0] >= '0' && name[0] <= '9')
+			|| name[0] == '.' || name[0] == '_') && ConfigNameValid(name + 1, len - 1));
+	}
+
+	//ʱõĺconstexprڼʧʱıϢк
+	inline uint64_t config_error_invalid_name() { return 0; }
+
+	constexpr uint64_t ConfigCheckedHash(const char* name, size_t len)
+	{
+		return len > 0 && ConfigNameValid(name, len) ? ConfigNameHash(name, len) : config_error_invalid_name();
+	}
+
 	//࣬ù
 	class ConfigVarBase
 	{
@@ -30,6 +70,8 @@ namespace cch
 		const std::string &getDescription() const { return m_description; };
 		virtual std::string toString() = 0;//ת
 		virtual bool fromString(const std::string &val) = 0; //
+		//ѽyamlڵֵĬתַfromString
+		virtual bool fromNode(const YAML::Node& node);
 		virtual std::string getTypeName() const = 0;
 	protected:
 		std::string m_name;
@@ -47,22 +89,76 @@ namespace cch
 		}
 	};
 
+	//ڵתַȡԭֵлyaml
+	std::string YamlToString(const YAML::Node& node);
+	//ڵлyaml
+	std::string YamlDump(const YAML::Node& node);
+
+	//ڵֱֵ֮תַĬתַLexicalCast
+	//ûֻҪǰһػLexicalCastLexicalCastػnode_cast
+	//(ṩfromNode/toNode)ʱֱӵãԪתǶʱÿһ㶼л
+	template<class T, class Enable = void>
+	class FromNode
+	{
+	public:
+		T operator() (const YAML::Node& node)
+		{
+			return LexicalCast<std::string, T>()(YamlToString(node));
+		}
+	};
+
+	template<class T>
+	class FromNode<T, typename LexicalCast<std::string, T>::node_cast>
+	{
+	public:
+		T operator() (const YAML::Node& node)
+		{
+			return LexicalCast<std::string, T>().fromNode(node);
+		}
+	};
+
+	template<class T, class Enable = void>
+	class ToNode
+	{
+	public:
+		YAML::Node operator() (const T& v)
+		{
+			std::string str = LexicalCast<T, std::string>()(v);
+			//ֵַǱ͵LexicalCastyamlı
+			if (std::is_arithmetic<T>::value || std::is_same<T, std::string>::value)
+			{
+				return YAML::Node(str);
+			}
+			return YAML::Load(str);
+		}
+	};
+
+	template<class T>
+	class ToNode<T, typename LexicalCast<T, std::string>::node_cast>
+	{
+	public:
+		YAML::Node operator() (const T& v)
+		{
+			return LexicalCast<T, std::string>().toNode(v);
+		}
+	};
+
 	//ƫػ vector
 	template<class T>
 	class LexicalCast<std::string, std::vector<T>>
 	{
 	public:
+		typedef void node_cast;
 		std::vector<T> operator() (const std::string& v)
 		{
-			YAML::Node node = YAML::Load(v);
-			
+			return fromNode(YAML::Load(v));
+		}
+		std::vector<T> fromNode(const YAML::Node& node)
+		{
 			typename std::vector<T> vec;
-			std::stringstream ss;
 			for (size_t i = 0; i < node.size(); i++)
 			{
-				ss.str("");
-				ss << node[i];
-				vec.push_back(LexicalCast<std::string, T>()(ss.str()));
+				vec.push_back(FromNode<T>()(node[i]));
 			}
 			return vec;
 		}
@@ -73,17 +169,19 @@ namespace cch
 	class LexicalCast<std::vector<T>, std::string>
 	{
 	public:
+		typedef void node_cast;
 		std::string operator() (const std::vector<T>& v)
+		{
+			return YamlDump(toNode(v));
+		}
+		YAML::Node toNode(const std::vector<T>& v)
 		{
 			YAML::Node node;
 			for (auto& i : v)
 			{
-				node.push_back(YAML::Node(LexicalCast<T, std::string>()(i)));
+				node.push_back(ToNode<T>()(i));
 			}
-	
-			std::stringstream ss;
-			ss << node;
-			return ss.str();
+			return node;
 		}
 	};
 
@@ -92,17 +190,17 @@ namespace cch
 	class LexicalCast<std::string, std::list<T>>
 	{
 	public:
+		typedef void node_cast;
 		std::list<T> operator() (const std::string& v)
 		{
-			YAML::Node node = YAML::Load(v);
-
+			return fromNode(YAML::Load(v));
+		}
+		std::list<T> fromNode(const YAML::Node& node)
+		{
 			typename std::list<T> vec;
-			std::stringstream ss;
 			for (size_t i = 0; i < node.size(); i++)
 			{
-				ss.str("");
-				ss << node[i];
-				vec.push_back(LexicalCast<std::string, T>()(ss.str()));
+				vec.push_back(FromNode<T>()(node[i]));
 			}
 			return vec;
 		}
@@ -113,17 +211,19 @@ namespace cch
 	class LexicalCast<std::list<T>, std::string>
 	{
 	public:
+		typedef void node_cast;
 		std::string operator() (const std::list<T>& v)
+		{
+			return YamlDump(toNode(v));
+		}
+		YAML::Node toNode(const std::list<T>& v)
 		{
 			YAML::Node node;
 			for (auto& i : v)
 			{
-				node.push_back(YAML::Node(LexicalCast<T, std::string>()(i)));
+				node.push_back(ToNode<T>()(i));
 			}
-
-			std::stringstream ss;
-			ss << node;
-			return ss.str();
+			return node;
 		}
 	};
 
@@ -132,17 +232,17 @@ namespace cch
 	class LexicalCast<std::string, std::set<T>>
 	{
 	public:
+		typedef void node_cast;
 		std::set<T> operator() (const std::string& v)
 		{
-			YAML::Node node = YAML::Load(v);
-
+			return fromNode(YAML::Load(v));
+		}
+		std::set<T> fromNode(const YAML::Node& node)
+		{
 			typename std::set<T> vec;
-			std::stringstream ss;
 			for (size_t i = 0; i < node.size(); i++)
 			{
-				ss.str("");
-				ss << node[i];
-				vec.insert(LexicalCast<std::string, T>()(ss.str()));
+				vec.insert(FromNode<T>()(node[i]));
 			}
 			return vec;
 		}
@@ -153,17 +253,19 @@ namespace cch
 	class LexicalCast<std::set<T>, std::string>
 	{
 	public:
+		typedef void node_cast;
 		std::string operator() (const std::set<T>& v)
+		{
+			return YamlDump(toNode(v));
+		}
+		YAML::Node toNode(const std::set<T>& v)
 		{
 			YAML::Node node;
 			for (auto& i : v)
 			{
-				node.push_back(YAML::Node(LexicalCast<T, std::string>()(i)));
+				node.push_back(ToNode<T>()(i));
 			}
-
-			std::stringstream ss;
-			ss << node;
-			return ss.str();
+			return node;
 		}
 	};
 
@@ -172,17 +274,17 @@ namespace cch
 	class LexicalCast<std::string, std::unordered_set<T>>
 	{
 	public:
+		typedef void node_cast;
 		std::unordered_set<T> operator() (const std::string& v)
 		{
-			YAML::Node node = YAML::Load(v);
-
+			return fromNode(YAML::Load(v));
+		}
+		std::unordered_set<T> fromNode(const YAML::Node& node)
+		{
 			typename std::unordered_set<T> vec;
-			std::stringstream ss;
 			for (size_t i = 0; i < node.size(); i++)
 			{
-				ss.str("");
-				ss << node[i];
-				vec.insert(LexicalCast<std::string, T>()(ss.str()));
+				vec.insert(FromNode<T>()(node[i]));
 			}
 			return vec;
 		}
@@ -193,17 +295,19 @@ namespace cch
 	class LexicalCast<std::unordered_set<T>, std::string>
 	{
 	public:
+		typedef void node_cast;
 		std::string operator() (const std::unordered_set<T>& v)
+		{
+			return YamlDump(toNode(v));
+		}
+		YAML::Node toNode(const std::unordered_set<T>& v)
 		{
 			YAML::Node node;
 			for (auto& i : v)
 			{
-				node.push_back(YAML::Node(LexicalCast<T, std::string>()(i)));
+				node.push_back(ToNode<T>()(i));
 			}
-
-			std::stringstream ss;
-			ss << node;
-			return ss.str();
+			return node;
 		}
 	};
 
@@ -212,18 +316,17 @@ namespace cch
 	class LexicalCast<std::string, std::map<std::string, T>>
 	{
 	public:
+		typedef void node_cast;
 		std::map<std::string, T> operator() (const std::string& v)
 		{
-			YAML::Node node = YAML::Load(v);
-
+			return fromNode(YAML::Load(v));
+		}
+		std::map<std::string, T> fromNode(const YAML::Node& node)
+		{
 			typename std::map<std::string, T> vec;
-			std::stringstream ss;
-			for(auto it=node.begin(); it!=node.end(); it++)
+			for (auto it = node.begin(); it != node.end(); it++)
 			{
-				ss.str("");
-				ss << it->second;
-				vec.insert(std::make_pair(it->first.Scalar(),
-					LexicalCast<std::string, T>()(ss.str())));
+				vec.insert(std::make_pair(it->first.Scalar(), FromNode<T>()(it->second)));
 			}
 			return vec;
 		}
@@ -234,17 +337,19 @@ namespace cch
 	class LexicalCast<std::map<std::string, T>, std::string>
 	{
 	public:
+		typedef void node_cast;
 		std::string operator() (const std::map<std::string, T>& v)
+		{
+			return YamlDump(toNode(v));
+		}
+		YAML::Node toNode(const std::map<std::string, T>& v)
 		{
 			YAML::Node node;
 			for (auto& i : v)
 			{
-				node[i.first] = YAML::Load(LexicalCast<T, std::string>()(i.second));
+				node[i.first] = ToNode<T>()(i.second);
 			}
-
-			std::stringstream ss;
-			ss << node;
-			return ss.str();
+			return node;
 		}
 	};
 
@@ -253,18 +358,17 @@ namespace cch
 	class LexicalCast<std::string, std::unordered_map<std::string, T>>
 	{
 	public:
+		typedef void node_cast;
 		std::unordered_map<std::string, T> operator() (const std::string& v)
 		{
-			YAML::Node node = YAML::Load(v);
-
+			return fromNode(YAML::Load(v));
+		}
+		std::unordered_map<std::string, T> fromNode(const YAML::Node& node)
+		{
 			typename std::unordered_map<std::string, T> vec;
-			std::stringstream ss;
 			for (auto it = node.begin(); it != node.end(); it++)
 			{
-				ss.str("");
-				ss << it->second;
-				vec.insert(std::make_pair(it->first.Scalar(),
-					LexicalCast<std::string, T>()(ss.str())));
+				vec.insert(std::make_pair(it->first.Scalar(), FromNode<T>()(it->second)));
 			}
 			return vec;
 		}
@@ -275,42 +379,61 @@ namespace cch
 	class LexicalCast<std::unordered_map<std::string, T>, std::string>
 	{
 	public:
+		typedef void node_cast;
 		std::string operator() (const std::unordered_map<std::string, T>& v)
+		{
+			return YamlDump(toNode(v));
+		}
+		YAML::Node toNode(const std::unordered_map<std::string, T>& v)
 		{
 			YAML::Node node;
 			for (auto& i : v)
 			{
-				node[i.first] = YAML::Load(LexicalCast<T, std::string>()(i.second));
+				node[i.first] = ToNode<T>()(i.second);
 			}
-
-			std::stringstream ss;
-			ss << node;
-			return ss.str();
+			return node;
 		}
 	};
 
 	//ʵ
 	//
+	//ֵԲɱյʽRcuPtrSnapshot
+	//setValue滻գɿյж뿪ͷ
 	template<class T, class FromStr = LexicalCast<std::string, T>, class ToStr = LexicalCast<T, std::string> >
 	class ConfigVar : public ConfigVarBase
 	{
 	public:
 		typedef std::shared_ptr<ConfigVar> ptr;
 		typedef std::function<void(const T& old_value, const T& new_value)> on_change_cb;
+
+		//ǰֵֻͼڼһֱЧ֮setValueӰ
+		//ڲRcuٽֻڴ߳ʹãҪʱ(ƳRCUдͷž)
+		class Snapshot
+		{
+		public:
+			explicit Snapshot(const ConfigVar& var) :m_val(var.m_val.get()) {}
+			const T& operator*() const { return *m_val; }
+			const T* operator->() const { return m_val; }
+			const T& get() const { return *m_val; }
+		private:
+			Rcu::ReadGuard m_guard;	//m_val
+			const T* m_val;
+		};
 	public:
 		ConfigVar(const std::string &name, const T &default_value, const std::string &description = "")
-			:ConfigVarBase(name, description), m_val(default_value) {};
+			:ConfigVarBase(name, description), m_val(new T(default_value)) {};
 	public:
 		//תΪstring
 		std::string toString() override
 		{	//ʹtry catchԭlexical_cast޷תʱ׳쳣
 			try{
 				//return boost::lexical_cast<std::string>(m_val);
-				return ToStr()(m_val);
+				Snapshot snap(*this);
+				return ToStr()(*snap);
 			}
 			catch (std::exception &e){
 				CCH_LOG_ERROR(CCH_LOG_ROOT()) << "ConfigVar::toString exception "
-					<< e.what() << " convert: " << typeid(m_val).name() << " to string";
+					<< e.what() << " convert: " << typeid(T).name() << " to string";
 			}
 			return "";
 		}
@@ -323,114 +446,226 @@ namespace cch
 			}
 			catch (std::exception &e) {
 				CCH_LOG_ERROR(CCH_LOG_ROOT()) << "ConfigVar::fromString exception "
-					<< e.what() << " convert: string to " << typeid(m_val).name();
+					<< e.what() << " convert: string to " << typeid(T).name();
 			}
 			return false;
 		}
 
-		const T getValue() const { return m_val; }
+		bool fromNode(const YAML::Node& node) override
+		{
+			try {
+				setValue(ConvertNode(node, (FromStr*)nullptr));
+				return true;
+			}
+			catch (std::exception &e) {
+				CCH_LOG_ERROR(CCH_LOG_ROOT()) << "ConfigVar::fromNode exception "
+					<< e.what() << " convert: node to " << typeid(T).name();
+			}
+			return false;
+		}
+
+		//һݿ͵·Snapshot
+		const T getValue() const
+		{
+			Snapshot snap(*this);
+			return *snap;
+		}
 		void setValue(const T &v) 
 		{ 
-			if (v == m_val)
+			std::lock_guard<std::mutex> lock(m_mutex);
+			const T* old = m_val.get();
+			if (v == *old)
 				return;
 			for (auto& i : m_cbs)
 			{
-				i.second(m_val, v);
+				i.second(*old, v);
 			}
-			m_val = v; 
+			//oldreset֮Ѿͷ
+			m_val.reset(new T(v));
 		}
 		std::string getTypeName() const { return typeid(T).name();}
 
 		//Ӽ
 		void addListener(uint64_t key, on_change_cb cb)
 		{
+			std::lock_guard<std::mutex> lock(m_mutex);
 			m_cbs[key] = cb;
 		}
 		void delListener(uint64_t key)
 		{
+			std::lock_guard<std::mutex> lock(m_mutex);
 			m_cbs.erase(key);
 		}
 		on_change_cb getListener(uint64_t key)
 		{
+			std::lock_guard<std::mutex> lock(m_mutex);
 			auto it = m_cbs.find(key);
 			return it == m_cbs.end() ? nullptr : it->second;
 		}
 
 		void clearListener()
 		{
+			std::lock_guard<std::mutex> lock(m_mutex);
 			m_cbs.clear();
 		}
 	private:
-		T m_val;
+		//ԶFromStrַֻĬϵLexicalCastFromNode
+		template<class F>
+		static T ConvertNode(const YAML::Node& node, F*)
+		{
+			return F()(YamlToString(node));
+		}
+		static T ConvertNode(const YAML::Node& node, LexicalCast<std::string, T>*)
+		{
+			return FromNode<T>()(node);
+		}
+	private:
+		RcuPtr<T> m_val;
+		std::mutex m_mutex;	//лsetValuem_cbs
 		std::map<uint64_t, on_change_cb> m_cbs;//ص飬uint64_t keyҪΨһһhash
 	};
 
 	//
+	//עhashƬÿƬһѶд洢Ǻھ̬뵥Ԫľ̬ʼҲLookup
 	class Config
 	{
 	public:
-		typedef std::unordered_map<std::string, ConfigVarBase::ptr> ConfigVarMap;
-
 		template<class T>
 		static typename ConfigVar<T>::ptr Lookup(const std::string &name,
 			const T &default_value, const std::string &description = "")
 		{	//û򴴽еĻʹе
-			auto it = s_datas.find(name);
-			if (it != s_datas.end())
-			{	//
-				auto tmp = std::dynamic_pointer_cast<ConfigVar<T>>(it->second);
-				if (tmp)
+			ConfigVarBase::ptr base = LookupBase(name);
+			if (!base)
+			{
+				//û򴴽
+				//find_first_not_of ԭַеһַַָеһַƥַ
+				//λá
+				//ʧܣ򷵻npos
+				if (name.find_first_not_of("abcdefghijklmnopqrstuvwxyz._0123456789") != std::string::npos)
 				{
-					CCH_LOG_INFO(CCH_LOG_ROOT()) << "Lookup name=" << name << " exists";
-					return tmp;
+					//nameа"abcdefghijklmnopqrstuvwxyz._0123456789"ַif
+					CCH_LOG_ERROR(CCH_LOG_ROOT()) << "Lookup name invalid " << name;
+					throw std::invalid_argument(name);
 				}
-				else
+
+				typename ConfigVar<T>::ptr v(new ConfigVar<T>(name, default_value, description));
+				//߳ͬʱעͬһʱֻһɹõעǸ
+				base = Register(v);
+				if (base == v)
 				{
-					CCH_LOG_ERROR(CCH_LOG_ROOT()) << "Lookup name=" << name << " exists but type not "
-						<< typeid(T).name() << " real_type=" << it->second->getTypeName()
-						<< " " << it->second ->toString();
-					return nullptr;
+					return v;
 				}
 			}
 
-			//û򴴽
-			//find_first_not_of ԭַеһַַָеһַƥַ
-			//λá
-			//ʧܣ򷵻npos
-			if (name.find_first_not_of("abcdefghijklmnopqrstuvwxyz._0123456789") != std::string::npos)
+			//
+			auto tmp = std::dynamic_pointer_cast<ConfigVar<T>>(base);
+			if (tmp)
 			{
-				//nameа"abcdefghijklmnopqrstuvwxyz._0123456789"ַif
-				CCH_LOG_ERROR(CCH_LOG_ROOT()) << "Lookup name invalid " << name;
-				throw std::invalid_argument(name);
+				CCH_LOG_INFO(CCH_LOG_ROOT()) << "Lookup name=" << name << " exists";
+				return tmp;
+			}
+			else
+			{
+				CCH_LOG_ERROR(CCH_LOG_ROOT()) << "Lookup name=" << name << " exists but type not "
+					<< typeid(T).name() << " real_type=" << base->getTypeName()
+					<< " " << base->toString();
+				return nullptr;
 			}
-
-			typename ConfigVar<T>::ptr v(new ConfigVar<T>(name, default_value, description));
-			s_datas[name] = v;
-			return v;
 		}
 
 		template<class T>
 		static typename ConfigVar<T>::ptr Lookup(const std::string &name)
 		{	//
-			auto it = s_datas.find(name);
-			if (it == s_datas.end())
-				return nullptr;
-
-			return std::dynamic_pointer_cast<ConfigVar<T>>(it->second);
+			return std::dynamic_pointer_cast<ConfigVar<T>>(LookupBase(name));
 		}
 
+		//ֻܰע
 		static void LoadFromYaml(const YAML::Node &root);
 
-		static ConfigVarBase::ptr LookupBase(const std::string &name);
-	private:
-		static ConfigVarMap s_datas;
-		static ConfigVarMap& GetDatas()
+		//Ʋңstd::string
+		static ConfigVarBase::ptr LookupBase(const char* name, size_t len);
+		static ConfigVarBase::ptr LookupBase(const char* name) { return LookupBase(name, strlen(name)); }
+		static ConfigVarBase::ptr LookupBase(const std::string &name) { return LookupBase(name.data(), name.size()); }
+#if __cplusplus >= 201703L
+		static ConfigVarBase::ptr LookupBase(std::string_view name) { return LookupBase(name.data(), name.size()); }
+#endif
+		//hashConfigNameHash(name, len)ʱʡʱhash
+		static ConfigVarBase::ptr LookupBase(const char* name, size_t len, uint64_t hash);
+
+		//һעΪTConfigHandleʹãѾУ
+		//ͬʱ׳std::invalid_argumentLookupnullptr
+		template<class T>
+		static typename ConfigVar<T>::ptr Bind(const char* name, size_t len, uint64_t hash,
+			const T &default_value, const std::string &description)
 		{
-			static ConfigVarMap s_datas;
-			return s_datas;
+			ConfigVarBase::ptr base = LookupBase(name, len, hash);
+			if (!base)
+			{
+				typename ConfigVar<T>::ptr v(new ConfigVar<T>(std::string(name, len), default_value, description));
+				base = Register(v);
+				if (base == v)
+				{
+					return v;
+				}
+			}
+			auto tmp = std::dynamic_pointer_cast<ConfigVar<T>>(base);
+			if (!tmp)
+			{
+				std::string msg = "Config " + std::string(name, len) + " registered as " + base->getTypeName()
+					+ ", bind as " + typeid(T).name();
+				CCH_LOG_ERROR(CCH_LOG_ROOT()) << msg;
+				throw std::invalid_argument(msg);
+			}
+			return tmp;
 		}
+	private:
+		//עͬʱư'.'ֶμǵǰ׺Ѵʱ滻е
+		static ConfigVarBase::ptr Register(ConfigVarBase::ptr var);
+	};
+
+	//ȷCCH_CONFIG_VARע󲻻ͷţֱӱָ
+	template<class T>
+	class ConfigHandle
+	{
+	public:
+		ConfigHandle(const char* name, size_t len, uint64_t hash, const T& default_value, const std::string& description)
+			:m_var(Config::Bind<T>(name, len, hash, default_value, description)) {}
+		ConfigVar<T>* operator->() const { return m_var.get(); }
+		ConfigVar<T>& operator*() const { return *m_var; }
+		const typename ConfigVar<T>::ptr& get() const { return m_var; }
+	private:
+		typename ConfigVar<T>::ptr m_var;
 	};
 
+	//һyamlļļ仯ٰdebounce_msŵConfig::LoadFromYaml
+	//༭ʱĶд롢дʱļٸֻһμء
+	//ӵĿ¼(inotify)ļɾؽҲܼյ֪ͨʧʱԭ
+	class ConfigFileWatcher
+	{
+	public:
+		typedef std::shared_ptr<ConfigFileWatcher> ptr;
+		ConfigFileWatcher(const std::string& path, uint32_t debounce_ms = 200);
+		~ConfigFileWatcher();
+		//̨̣߳ȼһΣҪĻȵreload()
+		bool start();
+		void stop();
+		//һΣɹtrue
+		bool reload();
+		const std::string& getPath() const { return m_path; }
+		uint64_t getReloadCount() const { return m_reloads.load(std::memory_order_relaxed); }
+	private:
+		void run();
+	private:
+		std::string m_path;
+		std::string m_dir;
+		std::string m_file;	//Ŀ¼ļĿ¼ļ¼
+		uint32_t m_debounce;
+		int m_inotify = -1;
+		int m_wakeup[2] = { -1, -1 };	//stop()дһֽڻѺ̨߳
+		std::thread m_thread;
+		std::mutex m_mutex;	//лreload()
+		std::atomic<uint64_t> m_reloads;
+	};
 }
 #endif // !__CCH_CONFIG_H__
 
@@ -2,36 +2,175 @@
 #include<map>
 #include <functional>
 #include<time.h>
+#include<chrono>
+#include<atomic>
 #include<string.h>
 #include <stdarg.h>
+#include <algorithm>
+#include <unistd.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <signal.h>
+#include <cmath>
+#if __cplusplus >= 201703L
+#include <charconv>
+#endif
+//json/logfmtתʱɨַĿȣ2ΪAVX21ΪSSE20ΪֽڣĬϰѡѡ
+#ifndef CCH_LOG_SIMD
+#if defined(__AVX2__)
+#define CCH_LOG_SIMD 2
+#elif defined(__SSE2__)
+#define CCH_LOG_SIMD 1
+#else
+#define CCH_LOG_SIMD 0
+#endif
+#endif
+#if CCH_LOG_SIMD >= 2
+#include <immintrin.h>
+#elif CCH_LOG_SIMD
+#include <emmintrin.h>
+#endif
+//zlibͷļ(Ҫz)
+#if !defined(CCH_LOG_ZLIB) && defined(__has_include)
+#if __has_include(<zlib.h>)
+#define CCH_LOG_ZLIB 1
+#endif
+#endif
+#ifndef CCH_LOG_ZLIB
+#define CCH_LOG_ZLIB 0
+#endif
+#if CCH_LOG_ZLIB
+#include <zlib.h>
+#endif
 #include "config.h"
 
 namespace cch
 {
-	Logger::Logger(const std::string & name):m_name(name),m_level(LogLevel::DEBUG)
+	static std::atomic<uint32_t> s_logger_id(0);
+	//ȫôţκ־¿ʱ
+	static std::atomic<uint64_t> s_log_generation(0);
+
+	Logger::Logger(const std::string & name):m_name(name),m_id(++s_logger_id),m_level(LogLevel::DEBUG),m_siteKey(0)
 	{
 		//ָreset°ָĶͷԭĶ
 		//m_formatter.reset(new LogFormatter("%d{%Y-%m-%d %H:%M:%S}%T%t%T%F%T[%p]%T[%c]%T%f:%l%T%m%n"));
-		m_formatter.reset(new LogFormatter("[%p]%T[%c]%T%f:%l%T%m%n"));
+		State* state = new State;
+		state->ownLevel = LogLevel::DEBUG;
+		state->formatter.reset(new LogFormatter("[%p]%T[%c]%T%f:%l%T%m%n"));
+		publish(state);
+	}
+
+	Logger::State* Logger::copyState() const
+	{
+		return new State(*m_state.get());
+	}
+
+	void Logger::publish(State* state)
+	{
+		std::shared_ptr<const std::vector<LogAppender::ptr> > inherited;
+		state->level = state->ownLevel;
+		if (m_parent)
+		{
+			Rcu::ReadGuard guard;
+			const State* parent = m_parent->m_state.get();
+			state->level = state->ownLevel != LogLevel::UNKNOW ? state->ownLevel : parent->level;
+			inherited = parent->appenders;
+		}
+		if (inherited && state->ownAppenders.empty())
+		{
+			state->appenders = inherited;
+		}
+		else
+		{
+			std::shared_ptr<std::vector<LogAppender::ptr> > appenders(new std::vector<LogAppender::ptr>(state->ownAppenders));
+			GroupByFormatter(*appenders);
+			state->appenders = appenders;
+		}
+		LogLevel::Level level = state->level;
+		state->bypass = false;
+		for (auto& i : *state->appenders)
+		{
+			if (i->ignoreLoggerLevel())
+			{
+				state->bypass = true;
+				level = std::min(level, i->getLevel());
+			}
+		}
+		m_level.store(level, std::memory_order_relaxed);
+		//LogIniterӦҲͨеõԸ־Ļ涼֮ʧЧ
+		m_siteKey.store(++s_log_generation << 36 | (uint64_t)m_id << 4, std::memory_order_release);
+		m_state.reset(state);
+		//¼֮ºϲһܿշĿ
+		for (auto child : m_children)
+		{
+			std::lock_guard<std::mutex> lock(child->m_mutex);
+			child->publish(child->copyState());
+		}
+	}
+
+	void Logger::GroupByFormatter(std::vector<LogAppender::ptr>& appenders)
+	{
+		std::map<LogFormatter*, size_t> first;
+		for (size_t i = 0; i < appenders.size(); ++i)
+		{
+			first.insert(std::make_pair(appenders[i]->m_formatter.get(), i));
+		}
+		std::stable_sort(appenders.begin(), appenders.end(),
+			[&first](const LogAppender::ptr& a, const LogAppender::ptr& b) {
+				return first[a->m_formatter.get()] < first[b->m_formatter.get()];
+			});
 	}
 
 	void Logger::log(LogLevel::Level level, LogEvent::ptr event)
 	{
-		if (level >= m_level)
+		if (level >= m_level.load(std::memory_order_relaxed))
 		{
-			auto ptr = shared_from_this();
-			if (!m_appenders.empty())
+			bool below;
+			std::shared_ptr<const std::vector<LogAppender::ptr> > appenders;
 			{
-				for (auto& i : m_appenders)
+				Rcu::ReadGuard guard;
+				const State* state = m_state.get();
+				//־level־ֻignoreLoggerLevel()appender
+				below = level < state->level;
+				if (below && !state->bypass)
 				{
-					i->log(ptr, level, event);
+					return;
 				}
+				appenders = state->appenders;
 			}
-			else if(m_root)
+			if (!appenders->empty())
 			{
-				m_root->log(level, event);
+				auto ptr = shared_from_this();
+				//ͬһformatterappenderڣֻformatter仯ʱȾ
+				char buf[LogStream::BUFFER_SIZE];
+				LogFormatter* rendered = nullptr;
+				size_t len = 0;
+				for (auto& i : *appenders)
+				{
+					if (below && !i->ignoreLoggerLevel())
+					{
+						continue;
+					}
+					LogFormatter* fmt = i->m_formatter.get();
+					if (!fmt || !i->usesRendered())
+					{
+						i->log(ptr, level, event);
+						continue;
+					}
+					if (level < i->m_level)
+					{
+						continue;
+					}
+					if (fmt != rendered)
+					{
+						len = fmt->format(buf, sizeof(buf), ptr, level, event);
+						rendered = fmt;
+					}
+					i->logRendered(ptr, level, event, buf, len);
+				}
 			}
-
 		}
 	}
 
@@ -62,7 +201,10 @@ namespace cch
 
 	void Logger::setFormatter(LogFormatter::ptr val)
 	{
-		m_formatter = val;
+		std::lock_guard<std::mutex> lock(m_mutex);
+		State* state = copyState();
+		state->formatter = val;
+		publish(state);
 	}
 	void Logger::setFormatter(const std::string& val)
 	{
@@ -73,43 +215,82 @@ namespace cch
 				<< " value=" << val << " invalud formatter" << std::endl;
 			return;
 		}
-		m_formatter = new_val;
+		setFormatter(new_val);
+	}
+
+	LogFormatter::ptr Logger::getFormatter() const
+	{
+		Rcu::ReadGuard guard;
+		return m_state.get()->formatter;
 	}
 
 	void Logger::addAppender(LogAppender::ptr appender)
 	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		State* state = copyState();
 		if (!appender->getFormatter())
 		{
-			appender->setFormatter(m_formatter);
+			appender->setFormatter(state->formatter);
 		}
-		m_appenders.push_back(appender);
+		state->ownAppenders.push_back(appender);
+		publish(state);
 	}
 
 	void Logger::delAppender(LogAppender::ptr appender)
 	{
-		for (auto it = m_appenders.begin(); it != m_appenders.end(); it++)
+		std::lock_guard<std::mutex> lock(m_mutex);
+		State* state = copyState();
+		for (auto it = state->ownAppenders.begin(); it != state->ownAppenders.end(); it++)
 		{
 			if (*it == appender)
 			{
-				m_appenders.erase(it);
+				state->ownAppenders.erase(it);
 				break;
 			}
 		}
+		publish(state);
 	}
 
 	void Logger::clearAppenders()
 	{
-		m_appenders.clear();
+		std::lock_guard<std::mutex> lock(m_mutex);
+		State* state = copyState();
+		state->ownAppenders.clear();
+		publish(state);
+	}
+
+	void Logger::setAppenders(const std::vector<LogAppender::ptr>& appenders)
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		State* state = copyState();
+		state->ownAppenders = appenders;
+		for (auto& i : state->ownAppenders)
+		{
+			if (!i->getFormatter())
+			{
+				i->setFormatter(state->formatter);
+			}
+		}
+		publish(state);
+	}
+
+	std::vector<LogAppender::ptr> Logger::getAppenders() const
+	{
+		Rcu::ReadGuard guard;
+		return m_state.get()->ownAppenders;
 	}
 
 	LogLevel::Level Logger::getLevel() const
 	{
-		return m_level;
+		return m_level.load(std::memory_order_relaxed);
 	}
 
 	void Logger::setLevel(LogLevel::Level level)
 	{
-		this->m_level = level;
+		std::lock_guard<std::mutex> lock(m_mutex);
+		State* state = copyState();
+		state->ownLevel = level;
+		publish(state);
 	}
 
 	LogFormatter::LogFormatter(const std::string& pattern):m_pattern(pattern)
@@ -117,164 +298,174 @@ namespace cch
 		init();
 	}
 
-	class MessageFormatItem : public LogFormatter::FormatItem
+	//[p, end)׷lenֽڣŲµĲֽضϣµдλ
+	static inline char* AppendBytes(char* p, char* end, const char* s, size_t len)
 	{
-	public:
-		MessageFormatItem(const std::string& fmt = ""){}
-		void format(std::ostream& os, std::shared_ptr<Logger> logger, LogLevel::Level level, LogEvent::ptr event) override
+		size_t left = end - p;
+		if (len > left)
 		{
-			os << event->getContent();
-			//os << "sssssss";
+			len = left;
 		}
-	};
+		memcpy(p, s, len);
+		return p + len;
+	}
 
-	class LevelFormatItem : public LogFormatter::FormatItem
+	//޷תʮƣÿδλ
+	static inline char* AppendUInt(char* p, char* end, uint64_t v)
 	{
-	public:
-		LevelFormatItem(const std::string& fmt = "") :m_string(fmt) {}
-		void format(std::ostream& os, std::shared_ptr<Logger> logger, LogLevel::Level level, LogEvent::ptr event) override
+		static const char s_digits[] =
+			"00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+			"40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+			"8081828384858687888990919293949596979899";
+		char tmp[24];
+		char* q = tmp + sizeof(tmp);
+		while (v >= 100)
 		{
-			os << LogLevel::ToString(level);
+			unsigned idx = (v % 100) * 2;
+			v /= 100;
+			*--q = s_digits[idx + 1];
+			*--q = s_digits[idx];
 		}
-	private:
-		std::string m_string;
-	};
-
-	class ElapseFormatItem : public LogFormatter::FormatItem
-	{
-	public:
-		ElapseFormatItem(const std::string& fmt = "") :m_string(fmt) {}
-		void format(std::ostream& os, std::shared_ptr<Logger> logger, LogLevel::Level level, LogEvent::ptr event) override
+		if (v < 10)
 		{
-			os << event->gettElapse();
+			*--q = '0' + v;
 		}
-	private:
-		std::string m_string;
-	};
-
-	class NameFormatItem : public LogFormatter::FormatItem
-	{
-	public:
-		NameFormatItem(const std::string& fmt = "") :m_string(fmt) {}
-		void format(std::ostream& os, std::shared_ptr<Logger> logger, LogLevel::Level level, LogEvent::ptr event) override
+		else
 		{
-			os << event->getLogger()->getName();
+			*--q = s_digits[v * 2 + 1];
+			*--q = s_digits[v * 2];
 		}
-	private:
-		std::string m_string;
-	};
+		return AppendBytes(p, end, q, tmp + sizeof(tmp) - q);
+	}
 
-	class ThreadIdFormatItem : public LogFormatter::FormatItem
+	static inline char* AppendInt(char* p, char* end, int64_t v)
 	{
-	public:
-		ThreadIdFormatItem(const std::string& fmt = "") :m_string(fmt) {}
-		void format(std::ostream& os, std::shared_ptr<Logger> logger, LogLevel::Level level, LogEvent::ptr event) override
+		if (v < 0)
 		{
-			os << event->getThreadId();
+			p = AppendBytes(p, end, "-", 1);
+			return AppendUInt(p, end, 0 - (uint64_t)v);
 		}
-	private:
-		std::string m_string;
-	};
+		return AppendUInt(p, end, v);
+	}
 
-	class FiberIdFormatItem : public LogFormatter::FormatItem
+	static inline char* AppendString(char* p, char* end, const std::string& s)
 	{
-	public:
-		FiberIdFormatItem(const std::string& fmt = "") :m_string(fmt) {}
-		void format(std::ostream& os, std::shared_ptr<Logger> logger, LogLevel::Level level, LogEvent::ptr event) override
-		{
-			os << event->getFiberId();
-		}
-	private:
-		std::string m_string;
-	};
+		return AppendBytes(p, end, s.data(), s.size());
+	}
 
-	class DataTimeFormatItem : public LogFormatter::FormatItem
+	//߳˽е%dȾ棬DateFormat::idֱӳ䡣ֻ仯ʱŵlocaltime_r/strftime
+	struct DateCacheEntry
 	{
-	public:
-		DataTimeFormatItem(const std::string& format = "%Y-%m-%d %H:%M:%s") :m_format(format) 
-		{
-			if (m_format.empty())
-			{
-				m_format = "%Y-%m-%d %H:%M:%s";
-			}
-		}
-		void format(std::ostream& os, std::shared_ptr<Logger> logger, LogLevel::Level level, LogEvent::ptr event) override
-		{
-			struct tm tm;
-			time_t time = event->getTime();
-			localtime_r(&time, &tm);
-			char buf[64];
-			strftime(buf, sizeof(buf), m_format.c_str(), &tm);
-			os << buf;
-			//os << event->getTime();
-		}
-	private:
-		std::string m_format;
+		enum { MAX_SUBSEC = 4 };
+		uint64_t id;
+		time_t sec;
+		uint32_t len;
+		uint32_t subsecCount;
+		uint8_t subsecPos[MAX_SUBSEC];	//λbufеƫ
+		uint8_t subsecDigits[MAX_SUBSEC];	//36
+		char buf[64];
 	};
 
-	class FilenameFormatItem : public LogFormatter::FormatItem
-	{
-	public:
-		FilenameFormatItem(const std::string& fmt = "") :m_string(fmt) {}
-		void format(std::ostream& os, std::shared_ptr<Logger> logger, LogLevel::Level level, LogEvent::ptr event) override
-		{
-			os << event->getFile();
-		}
-	private:
-		std::string m_string;
-	};
+	static thread_local DateCacheEntry t_date_cache[8];
 
-	class LineFormatItem : public LogFormatter::FormatItem
+	static LogFormatter::DateFormat CompileDateFormat(const std::string& fmt)
 	{
-	public:
-		LineFormatItem(const std::string& fmt = "") :m_string(fmt) {}
-		void format(std::ostream& os, std::shared_ptr<Logger> logger, LogLevel::Level level, LogEvent::ptr event) override
+		static std::atomic<uint64_t> s_date_id(0);
+		LogFormatter::DateFormat df;
+		df.id = ++s_date_id;
+		std::string part;
+		size_t count = 0;
+		for (size_t i = 0; i < fmt.size(); ++i)
 		{
-			os << event->getLine();
+			if (fmt[i] == '%' && i + 1 < fmt.size())
+			{
+				if ((fmt[i + 1] == '3' || fmt[i + 1] == '6') && i + 2 < fmt.size() && fmt[i + 2] == 'N'
+					&& count < DateCacheEntry::MAX_SUBSEC)
+				{
+					df.parts.push_back(part);
+					df.subsec.push_back(fmt[i + 1] - '0');
+					part.clear();
+					++count;
+					i += 2;
+					continue;
+				}
+				//%%תԭstrftime
+				part.append(fmt, i, 2);
+				++i;
+				continue;
+			}
+			part.append(1, fmt[i]);
 		}
-	private:
-		std::string m_string;
-	};
+		df.parts.push_back(part);
+		df.subsec.push_back(0);
+		return df;
+	}
 
-	class NewLineFormatItem : public LogFormatter::FormatItem
+	static void RenderDate(DateCacheEntry& e, const LogFormatter::DateFormat& df, time_t sec)
 	{
-	public:
-		NewLineFormatItem(const std::string& fmt = "") :m_string(fmt) {}
-		void format(std::ostream& os, std::shared_ptr<Logger> logger, LogLevel::Level level, LogEvent::ptr event) override
+		struct tm tm;
+		localtime_r(&sec, &tm);
+		size_t pos = 0;
+		e.subsecCount = 0;
+		for (size_t i = 0; i < df.parts.size(); ++i)
 		{
-			os << std::endl;
+			if (!df.parts[i].empty())
+			{
+				pos += strftime(e.buf + pos, sizeof(e.buf) - pos, df.parts[i].c_str(), &tm);
+			}
+			uint8_t digits = df.subsec[i];
+			if (digits && pos + digits <= sizeof(e.buf))
+			{
+				memset(e.buf + pos, '0', digits);
+				e.subsecPos[e.subsecCount] = pos;
+				e.subsecDigits[e.subsecCount] = digits;
+				++e.subsecCount;
+				pos += digits;
+			}
 		}
-	private:
-		std::string m_string;
-	};
+		e.len = pos;
+		e.id = df.id;
+		e.sec = sec;
+	}
 
-	class StringFormatItem : public LogFormatter::FormatItem
+	static inline char* AppendDate(char* p, char* end, const LogFormatter::DateFormat& df, time_t sec, uint32_t usec)
 	{
-	public:
-		StringFormatItem(const std::string& str): m_string(str) {}
-		void format(std::ostream& os, std::shared_ptr<Logger> logger, LogLevel::Level level, LogEvent::ptr event) override
+		DateCacheEntry& e = t_date_cache[df.id & 7];
+		if (e.id != df.id || e.sec != sec)
 		{
-			os << m_string;
+			RenderDate(e, df, sec);
 		}
-	private:
-		std::string m_string;
-	};
-
-	class TabFormatItem : public LogFormatter::FormatItem
-	{
-	public:
-		TabFormatItem(const std::string& str = "") : m_string(str) {}
-		void format(std::ostream& os, std::shared_ptr<Logger> logger, LogLevel::Level level, LogEvent::ptr event) override
+		char* begin = p;
+		p = AppendBytes(p, end, e.buf, e.len);
+		for (uint32_t i = 0; i < e.subsecCount; ++i)
 		{
-			os << "\t";
+			uint32_t v = e.subsecDigits[i] == 3 ? usec / 1000 : usec;
+			for (int k = e.subsecDigits[i] - 1; k >= 0; --k)
+			{
+				char* d = begin + e.subsecPos[i] + k;
+				if (d < p)
+				{
+					*d = '0' + v % 10;
+				}
+				v /= 10;
+			}
 		}
-	private:
-		std::string m_string;
-	};
+		return p;
+	}
 
 	//%xxx %xxx(xxx) %%
 	void LogFormatter::init()
 	{
+		if (m_pattern == "json" || m_pattern == "logfmt")
+		{
+			m_mode = m_pattern == "json" ? MODE_JSON : MODE_LOGFMT;
+			m_program.clear();
+			m_literals.clear();
+			m_dateFormats.clear();
+			m_dateFormats.push_back(CompileDateFormat("%Y-%m-%dT%H:%M:%S.%6N"));
+			m_flush = true;
+			return;
+		}
 		// str(d,t,F,T), format(Ĳ), type
 		std::vector<std::tuple<std::string, std::string, int>> vec;
 		std::string str;//洢ַ,[,],:
@@ -379,53 +570,86 @@ namespace cch
 
 
 		
-		static std::map<std::string, std::function<FormatItem::ptr(const std::string& str)> > s_format_items = {
+		static std::map<std::string, OpCode> s_format_ops = {
 #define XX(str, C) \
-			{#str, [](const std::string& fmt) {return FormatItem::ptr(new C(fmt)); }}
-			
-			XX(m, MessageFormatItem),
-			XX(p, LevelFormatItem),
-			XX(r, ElapseFormatItem),
-			XX(c, NameFormatItem),
-			XX(t, ThreadIdFormatItem),
-			XX(n, NewLineFormatItem),
-			XX(d, DataTimeFormatItem),
-			XX(f, FilenameFormatItem),
-			XX(l, LineFormatItem),
-			XX(T, TabFormatItem),
-			XX(F, FiberIdFormatItem),
+			{#str, C}
+
+			XX(m, OP_MESSAGE),
+			XX(p, OP_LEVEL),
+			XX(r, OP_ELAPSE),
+			XX(c, OP_NAME),
+			XX(t, OP_THREAD_ID),
+			XX(n, OP_NEWLINE),
+			XX(d, OP_DATETIME),
+			XX(f, OP_FILENAME),
+			XX(l, OP_LINE),
+			XX(T, OP_TAB),
+			XX(F, OP_FIBER_ID),
 #undef XX
 		};
 
+		//ѽָУڵ(%T)ϲһOP_STRING
+		m_program.clear();
+		m_literals.clear();
+		m_dateFormats.clear();
+		m_flush = false;
+		auto add_literal = [this](const std::string& str) {
+			if (!m_program.empty() && m_program.back().code == OP_STRING
+				&& m_program.back().arg + m_program.back().len == m_literals.size())
+			{
+				m_program.back().len += str.size();
+			}
+			else
+			{
+				m_program.push_back(Op{ OP_STRING, (uint32_t)m_literals.size(), (uint32_t)str.size() });
+			}
+			m_literals.append(str);
+		};
 		for (auto& i : vec)
 		{
 			if (std::get<2>(i) == 0)
 			{
-				m_items.push_back(FormatItem::ptr(new StringFormatItem(std::get<0>(i))));
+				add_literal(std::get<0>(i));
+				continue;
 			}
-			else
+			auto it = s_format_ops.find(std::get<0>(i));
+			if (it == s_format_ops.end())
+			{
+				add_literal("<<error_format %" + std::get<0>(i) + ">>");
+				m_error = true;
+			}
+			else if (it->second == OP_TAB)
+			{
+				add_literal("\t");
+			}
+			else if (it->second == OP_DATETIME)
 			{
-				auto it = s_format_items.find(std::get<0>(i));
-				if (it == s_format_items.end())
+				std::string fmt = std::get<1>(i);
+				if (fmt.empty())
 				{
-					m_items.push_back(FormatItem::ptr(new StringFormatItem("<<error_format %" + std::get<0>(i) + ">>")));
-					m_error = true;
+					fmt = "%Y-%m-%d %H:%M:%s";
 				}
-				else
+				m_program.push_back(Op{ OP_DATETIME, (uint32_t)m_dateFormats.size(), 0 });
+				m_dateFormats.push_back(CompileDateFormat(fmt));
+			}
+			else
+			{
+				if (it->second == OP_NEWLINE)
 				{
-					m_items.push_back(it->second(std::get<1>(i)));
+					m_flush = true;
 				}
+				m_program.push_back(Op{ it->second, 0, 0 });
 			}
 			//std::cout << "(" << std::get<0>(i) << ") - (" << std::get<1>(i) << ") - (" << std::get<2>(i) << ")" << std::endl;
 		}
-		//std::cout << m_items.size() << std::endl;
+		//std::cout << m_program.size() << std::endl;
 		//%m Ϣ
 		//%p level
 		//%r ʱ
 		//%c ־
 		//%t ߳id
 		//%n س
-		//%d ʱ
+		//%d ʱ䣬{}Ϊstrftimeʽ֧%3N롢%6N΢
 		//%f ļ
 		//%l к
 		//%T Tab
@@ -433,22 +657,114 @@ namespace cch
 	}
 
 
+	size_t LogFormatter::format(char* buf, size_t size, std::shared_ptr<Logger> /*logger*/, LogLevel::Level level, LogEvent::ptr event)
+	{
+		if (m_mode != MODE_PATTERN)
+		{
+			return formatStructured(buf, size, level, event);
+		}
+		char* p = buf;
+		char* end = buf + size;
+		for (auto& op : m_program)
+		{
+			switch (op.code)
+			{
+			case OP_STRING:
+				p = AppendBytes(p, end, m_literals.data() + op.arg, op.len);
+				break;
+			case OP_MESSAGE:
+				p = AppendBytes(p, end, event->getContentData(), event->getContentSize());
+				break;
+			case OP_LEVEL:
+			{
+				const char* str = LogLevel::ToString(level);
+				p = AppendBytes(p, end, str, strlen(str));
+				break;
+			}
+			case OP_ELAPSE:
+				p = AppendUInt(p, end, event->gettElapse());
+				break;
+			case OP_NAME:
+				p = AppendString(p, end, event->getLogger()->getName());
+				break;
+			case OP_THREAD_ID:
+				p = AppendUInt(p, end, event->getThreadId());
+				break;
+			case OP_NEWLINE:
+				p = AppendBytes(p, end, "\n", 1);
+				break;
+			case OP_DATETIME:
+				p = AppendDate(p, end, m_dateFormats[op.arg], event->getTime(), event->getUsec());
+				break;
+			case OP_FILENAME:
+			{
+				const char* file = event->getFile();
+				p = AppendBytes(p, end, file, strlen(file));
+				break;
+			}
+			case OP_LINE:
+				p = AppendInt(p, end, event->getLine());
+				break;
+			case OP_FIBER_ID:
+				p = AppendUInt(p, end, event->getFiberId());
+				break;
+			default:
+				break;
+			}
+		}
+		return p - buf;
+	}
+
 	std::string LogFormatter::format(std::shared_ptr<Logger> logger, LogLevel::Level level, LogEvent::ptr event)
 	{
-		std::stringstream ss;
-		for (auto &i : m_items)
+		char buf[LogStream::BUFFER_SIZE];
+		size_t len = format(buf, sizeof(buf), logger, level, event);
+		return std::string(buf, len);
+	}
+
+	std::ostream& LogFormatter::format(std::ostream& ofs, std::shared_ptr<Logger> logger, LogLevel::Level level, LogEvent::ptr event)
+	{
+		char buf[LogStream::BUFFER_SIZE];
+		size_t len = format(buf, sizeof(buf), logger, level, event);
+		ofs.write(buf, len);
+		//ԭ%nstd::endlΪһ
+		if (m_flush)
 		{
-			i->format(ss, logger, level, event);
+			ofs.flush();
 		}
-		//std::cout << ss.str() << std::endl;
-		return ss.str();
+		return ofs;
 	}
 
 	void StdoutLogAppender::log(Logger::ptr logger, LogLevel::Level level, LogEvent::ptr event)
 	{
 		if (level >= m_level)
 		{
-			std::cout << m_formatter->format(logger, level, event);
+			if (m_batch)
+			{
+				char buf[LogStream::BUFFER_SIZE];
+				size_t len = m_formatter->format(buf, sizeof(buf), logger, level, event);
+				m_batch->logRendered(logger, level, event, buf, len);
+				return;
+			}
+			m_formatter->format(std::cout, logger, level, event);
+		}
+	}
+
+	void StdoutLogAppender::logRendered(Logger::ptr logger, LogLevel::Level level, LogEvent::ptr event,
+		const char* data, size_t len)
+	{
+		if (level >= m_level)
+		{
+			if (m_batch)
+			{
+				m_batch->logRendered(logger, level, event, data, len);
+				return;
+			}
+			std::cout.write(data, len);
+			if (m_formatter->needFlush())
+			{
+				std::cout.flush();
+			}
 		}
 	}
 
@@ -456,89 +772,3413 @@ namespace cch
 	{
 		if (level >= m_level)
 		{
-			m_filestream << m_formatter->format(logger, level, event);
+			//ʽڵ߳ɣͬģʽֱдļ첽ģʽֻ׷ӵǰ̨
+			char msg[LogStream::BUFFER_SIZE];
+			size_t len = m_formatter->format(msg, sizeof(msg), logger, level, event);
+			write(msg, len, m_index ? event->getTime() * 1000000 + event->getUsec() : 0, needSync(level));
 		}
 	}
 
-	FileLogAppender::FileLogAppender(const std::string & filename):m_filename(filename)
+	void FileLogAppender::logRendered(Logger::ptr /*logger*/, LogLevel::Level level, LogEvent::ptr event,
+		const char* data, size_t len)
 	{
-		reopen();
+		if (level >= m_level)
+		{
+			write(data, len, m_index ? event->getTime() * 1000000 + event->getUsec() : 0, needSync(level));
+		}
 	}
 
-	bool FileLogAppender::reopen()
+	bool FileLogAppender::needIndex(uint64_t time_us)
 	{
-		if (m_filestream)
+		bool mark = m_sinceIndex == 0
+			|| (m_indexRecords && m_sinceIndex >= m_indexRecords)
+			|| (m_indexInterval && time_us >= m_lastIndex + (uint64_t)m_indexInterval * 1000);
+		if (mark)
 		{
-			m_filestream.close();
+			m_sinceIndex = 0;
+			m_lastIndex = time_us;
 		}
-		m_filestream.open(m_filename);
-		return !!m_filestream;
+		++m_sinceIndex;
+		return mark;
 	}
 
-	void LogAppender::setFormatter(LogFormatter::ptr val)
+	bool FileLogAppender::write(const char* data, size_t len, uint64_t time_us, bool sync)
 	{
-		m_formatter = val;
+		if (!m_async)
+		{
+			RollResult r;
+			{
+				std::lock_guard<std::mutex> lock(m_fileMutex);
+				IndexEntry mark = { time_us, 0 };
+				bool index = time_us && m_index && needIndex(time_us);
+				writeLocked(data, len, r, index ? &mark : nullptr, index ? 1 : 0);
+				syncLocked(sync);
+			}
+			FinishRoll(r);
+			return true;
+		}
+
+		std::unique_lock<std::mutex> lock(m_mutex);
+		if (!m_front.empty() && m_front.size() + len > m_bufferSize)
+		{
+			m_cond.notify_one();
+			if (m_overflow == DROP)
+			{
+				++m_dropped;
+				return false;
+			}
+			m_notFull.wait(lock, [this, len]() {
+				return m_stop || m_front.empty() || m_front.size() + len <= m_bufferSize;
+			});
+		}
+		if (time_us && m_index && needIndex(time_us))
+		{
+			m_frontIndex.push_back(IndexEntry{ time_us, m_front.size() });
+		}
+		m_front.append(data, len);
+		if (sync)
+		{
+			//־һдͬһͬ־һfdatasync
+			uint64_t target = m_flushSeq + 1;
+			m_syncPending = true;
+			m_cond.notify_one();
+			m_synced.wait(lock, [this, target]() {
+				return m_stop || m_syncedSeq >= target;
+			});
+		}
+		else if (m_front.size() >= m_bufferSize / 2)
+		{
+			m_cond.notify_one();
+		}
+		return true;
 	}
 
-	LogFormatter::ptr LogAppender::getFormatter() const
+	std::string FileLogAppender::droppedNotice(uint64_t dropped)
 	{
-		return m_formatter;
+		std::stringstream ss;
+		ss << "<<FileLogAppender dropped " << dropped << " log records, async buffer full>>" << std::endl;
+		return ss.str();
 	}
 
-	const char * LogLevel::ToString(LogLevel::Level level)
+	//һѹһĿ飬ÿԵѹ֮䲻ֵ
+	struct LogCompressor
 	{
-		switch (level)
+		FileLogAppender::Compression type;
+		int level;
+		std::string out;	//һѹĽ
+#if CCH_LOG_ZLIB
+		z_stream zs;
+		bool zinit = false;
+#endif
+
+		LogCompressor(FileLogAppender::Compression t, int l) :type(t), level(l)
 		{
-#define XX(name) \
-		case LogLevel::name: \
-			return #name; \
-			break;
+#if CCH_LOG_ZLIB
+			if (type == FileLogAppender::COMPRESS_GZIP)
+			{
+				memset(&zs, 0, sizeof(zs));
+				//windowBits16gzipʽ
+				zinit = deflateInit2(&zs, level < 0 ? Z_DEFAULT_COMPRESSION : std::min(level, 9),
+					Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) == Z_OK;
+			}
+#endif
+		}
 
-			XX(DEBUG);
-			XX(INFO);
-			XX(WARN);
-			XX(ERROR);
-			XX(FATAL);
-#undef XX
-		default:
-			return "UNKNOW";
+		~LogCompressor()
+		{
+#if CCH_LOG_ZLIB
+			if (zinit)
+			{
+				deflateEnd(&zs);
+			}
+#endif
 		}
-		return "UNKNOW";
-	}
 
-	LogEvent::LogEvent(std::shared_ptr<Logger> logger, LogLevel::Level level, const char * file, int32_t line,
-		uint32_t elapse, uint32_t threadid, uint32_t fiberid, uint64_t time)
-		:m_logger(logger),m_level(level),m_file(file),m_line(line),m_elapse(elapse),m_threadid(threadid),m_fiberid(fiberid),m_time(time)
-	{
+		bool compress(const char* data, size_t len)
+		{
+			switch (type)
+			{
+#if CCH_LOG_ZLIB
+			case FileLogAppender::COMPRESS_GZIP:
+			{
+				if (!zinit || deflateReset(&zs) != Z_OK)
+				{
+					return false;
+				}
+				//gzipͷβ18ֽ
+				out.resize(deflateBound(&zs, len) + 18);
+				zs.next_in = (Bytef*)data;
+				zs.avail_in = len;
+				zs.next_out = (Bytef*)&out[0];
+				zs.avail_out = out.size();
+				if (deflate(&zs, Z_FINISH) != Z_STREAM_END)
+				{
+					return false;
+				}
+				out.resize(out.size() - zs.avail_out);
+				return true;
+			}
+#endif
+			default:
+				return false;
+			}
+		}
+	};
 
-	}
-	LogEvent::~LogEvent()
+	bool FileLogAppender::IsCompressionSupported(Compression compress)
 	{
-
+		switch (compress)
+		{
+		case COMPRESS_NONE:
+			return true;
+		case COMPRESS_GZIP:
+			return CCH_LOG_ZLIB;
+		}
+		return false;
 	}
 
-	void LogEvent::format(const char* fmt, ...)
+	FileLogAppender::Compression FileLogAppender::CompressionFromString(const std::string& str)
 	{
-		va_list al;
-		va_start(al, fmt);
-		format(fmt, al);
-		va_end(al);
+		if (str == "gzip" || str == "GZIP")
+		{
+			return COMPRESS_GZIP;
+		}
+		return COMPRESS_NONE;
 	}
 
-	void LogEvent::format(const char* fmt, va_list al)
+	const char* FileLogAppender::CompressionToString(Compression compress)
 	{
-		char* buf = nullptr;
-		int len = vasprintf(&buf, fmt, al);
-		if (len != -1)
+		switch (compress)
 		{
-			m_ss << std::string(buf, len);
-			free(buf);
+		case COMPRESS_GZIP:
+			return "gzip";
+		default:
+			return "none";
 		}
 	}
 
-	LogLevel::Level LogLevel::FromString(const std::string& str)
+	FileLogAppender::CompressStats FileLogAppender::getCompressStats()
 	{
-#define XX(level, v) \
+		std::lock_guard<std::mutex> lock(m_fileMutex);
+		return m_compressStats;
+	}
+
+	static uint64_t ThreadCpuNs()
+	{
+		struct timespec ts;
+		clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+		return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+	}
+
+	//д[iov, iov + count)EINTRͲд룬дֽ
+	static size_t WriteAllV(int fd, struct iovec* iov, int count)
+	{
+		size_t total = 0;
+		while (count > 0)
+		{
+			ssize_t n = ::writev(fd, iov, count);
+			if (n < 0)
+			{
+				if (errno == EINTR)
+				{
+					continue;
+				}
+				break;
+			}
+			total += n;
+			while (count > 0 && (size_t)n >= iov->iov_len)
+			{
+				n -= iov->iov_len;
+				++iov;
+				--count;
+			}
+			if (count > 0)
+			{
+				iov->iov_base = (char*)iov->iov_base + n;
+				iov->iov_len -= n;
+			}
+		}
+		return total;
+	}
+
+	void FileLogAppender::writeFile(const char* data, size_t len)
+	{
+		struct iovec iov = { (void*)data, len };
+		writeFile(&iov, 1);
+	}
+
+	void FileLogAppender::writeFile(struct iovec* iov, int count)
+	{
+		if (m_fd < 0)
+		{
+			return;
+		}
+		if (!m_compressor)
+		{
+			size_t n = WriteAllV(m_fd, iov, count);
+			if (n)
+			{
+				m_fileSize += n;
+				m_flushStats.bytes += n;
+				++m_flushStats.flushes;
+				m_unsynced = true;
+			}
+			return;
+		}
+		//ÿѹһ飬ѹͬһֻһһд
+		for (int i = 0; i < count; ++i)
+		{
+			if (!iov[i].iov_len)
+			{
+				continue;
+			}
+			uint64_t begin = ThreadCpuNs();
+			bool ok = m_compressor->compress((const char*)iov[i].iov_base, iov[i].iov_len);
+			m_compressStats.cpu_ns += ThreadCpuNs() - begin;
+			if (!ok)
+			{
+				//дδѹݻƻļɶһ
+				std::cout << "FileLogAppender compress " << m_filename << " failed, "
+					<< iov[i].iov_len << " bytes dropped" << std::endl;
+				continue;
+			}
+			m_compressStats.raw_bytes += iov[i].iov_len;
+			m_compressStats.compressed_bytes += m_compressor->out.size();
+			++m_compressStats.blocks;
+			struct iovec out = { &m_compressor->out[0], m_compressor->out.size() };
+			size_t n = WriteAllV(m_fd, &out, 1);
+			m_fileSize += n;
+			m_flushStats.bytes += n;
+			++m_flushStats.flushes;
+			m_unsynced = true;
+		}
+	}
+
+	void FileLogAppender::syncLocked(bool force)
+	{
+		if (m_fd < 0 || !m_unsynced || m_syncPolicy == SYNC_NONE)
+		{
+			return;
+		}
+		uint64_t now = GetCurrentUS();
+		if (!force && (m_syncPolicy != SYNC_INTERVAL || now < m_lastSync + (uint64_t)m_syncInterval * 1000))
+		{
+			return;
+		}
+		auto begin = std::chrono::steady_clock::now();
+		int rt = fdatasync(m_fd);
+		uint64_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - begin).count();
+		//նˡ֧ܵfdatasyncʧҲ
+		m_unsynced = false;
+		m_lastSync = now;
+		if (rt == 0)
+		{
+			++m_flushStats.syncs;
+			m_flushStats.sync_ns += ns;
+			m_flushStats.max_sync_ns = std::max(m_flushStats.max_sync_ns, ns);
+		}
+	}
+
+	void FileLogAppender::setSyncPolicy(SyncPolicy policy, uint32_t interval_ms)
+	{
+		std::lock_guard<std::mutex> lock(m_fileMutex);
+		m_syncPolicy = policy;
+		m_syncInterval = interval_ms ? interval_ms : 1000;
+	}
+
+	FileLogAppender::FlushStats FileLogAppender::getFlushStats()
+	{
+		std::lock_guard<std::mutex> lock(m_fileMutex);
+		return m_flushStats;
+	}
+
+	FileLogAppender::SyncPolicy FileLogAppender::SyncPolicyFromString(const std::string& str)
+	{
+		if (str == "interval" || str == "INTERVAL")
+		{
+			return SYNC_INTERVAL;
+		}
+		if (str == "fatal" || str == "FATAL")
+		{
+			return SYNC_FATAL;
+		}
+		return SYNC_NONE;
+	}
+
+	const char* FileLogAppender::SyncPolicyToString(SyncPolicy policy)
+	{
+		switch (policy)
+		{
+		case SYNC_INTERVAL:
+			return "interval";
+		case SYNC_FATAL:
+			return "fatal";
+		default:
+			return "none";
+		}
+	}
+
+	void FileLogAppender::writeLocked(const char* data, size_t len, RollResult& r, IndexEntry* marks, size_t count,
+		const std::string& notice)
+	{
+		//ȹд֤ļmax_size(һд뱾max_sizeʱ)
+		if (m_roll.enabled() && m_fileSize > 0)
+		{
+			bool roll = m_roll.max_size && m_fileSize + len + notice.size() > m_roll.max_size;
+			if (!roll && m_nextRoll)
+			{
+				roll = (time_t)(GetCurrentUS() / 1000000) >= m_nextRoll;
+			}
+			if (roll)
+			{
+				openLocked(r);
+			}
+		}
+		uint64_t base = m_fileSize;
+		struct iovec iov[2] = { { (void*)data, len }, { (void*)notice.data(), notice.size() } };
+		writeFile(iov, notice.empty() ? 1 : 2);
+		//дݺдʱָûдȥ
+		if (count && m_indexFd >= 0)
+		{
+			for (size_t i = 0; i < count; ++i)
+			{
+				marks[i].offset += base;
+			}
+			const char* p = (const char*)marks;
+			size_t left = count * sizeof(IndexEntry);
+			while (left > 0)
+			{
+				ssize_t n = ::write(m_indexFd, p, left);
+				if (n < 0)
+				{
+					if (errno == EINTR)
+					{
+						continue;
+					}
+					break;
+				}
+				p += n;
+				left -= n;
+			}
+		}
+	}
+
+	//һ(ʱ)
+	static time_t NextRollTime(time_t now, FileLogAppender::RollInterval interval)
+	{
+		if (interval == FileLogAppender::ROLL_NONE)
+		{
+			return 0;
+		}
+		struct tm tm;
+		localtime_r(&now, &tm);
+		tm.tm_min = 0;
+		tm.tm_sec = 0;
+		if (interval == FileLogAppender::ROLL_DAILY)
+		{
+			tm.tm_hour = 0;
+			++tm.tm_mday;
+		}
+		else
+		{
+			++tm.tm_hour;
+		}
+		tm.tm_isdst = -1;
+		return mktime(&tm);
+	}
+
+	//鵵ļ ļ.YYYYmmdd-HHMMSSѴʱټ .1 .2 ...
+	static std::string ArchiveName(const std::string& filename, time_t start)
+	{
+		struct tm tm;
+		localtime_r(&start, &tm);
+		char buf[32];
+		strftime(buf, sizeof(buf), ".%Y%m%d-%H%M%S", &tm);
+		std::string name = filename + buf;
+		std::string result = name;
+		for (int i = 1; access(result.c_str(), F_OK) == 0; ++i)
+		{
+			result = name + "." + std::to_string(i);
+		}
+		return result;
+	}
+
+	//鵵ļȺȱʱ䣬ͬһٱȺ׺(.2.10֮ǰ)
+	static bool ArchiveLess(const std::string& a, const std::string& b)
+	{
+		size_t pa = a.rfind('-');
+		size_t pb = b.rfind('-');
+		pa = pa == std::string::npos ? 0 : pa;
+		pb = pb == std::string::npos ? 0 : pb;
+		int c = a.compare(0, pa + 7, b, 0, pb + 7);	//HHMMSSΪֹ
+		if (c)
+		{
+			return c < 0;
+		}
+		return atoi(a.c_str() + std::min(a.size(), pa + 8)) < atoi(b.c_str() + std::min(b.size(), pb + 8));
+	}
+
+	//sǷArchiveNameӵĺ׺ YYYYmmdd-HHMMSS[.N]logrotate .1 ֮಻
+	static bool IsArchiveSuffix(const char* s)
+	{
+		for (int i = 0; i < 15; ++i)
+		{
+			if (i == 8 ? s[i] != '-' : !isdigit((unsigned char)s[i]))
+			{
+				return false;
+			}
+		}
+		s += 15;
+		if (!*s)
+		{
+			return true;
+		}
+		if (*s++ != '.' || *s < '1' || *s > '9')
+		{
+			return false;
+		}
+		while (isdigit((unsigned char)*s))
+		{
+			++s;
+		}
+		return !*s;
+	}
+
+	//ҳϴµĹ鵵ļʱ
+	static void ListArchives(const std::string& filename, std::deque<std::string>& out)
+	{
+		size_t pos = filename.rfind('/');
+		std::string dir = pos == std::string::npos ? "." : filename.substr(0, pos + 1);
+		std::string prefix = (pos == std::string::npos ? filename : filename.substr(pos + 1)) + ".";
+		DIR* d = opendir(dir.c_str());
+		if (!d)
+		{
+			return;
+		}
+		std::vector<std::string> names;
+		while (struct dirent* e = readdir(d))
+		{
+			std::string name = e->d_name;
+			//ֻArchiveNameɵ֣鵵ļ(鵵 + ".idx")µļ
+			if (name.size() > prefix.size() && name.compare(0, prefix.size(), prefix) == 0
+				&& IsArchiveSuffix(name.c_str() + prefix.size()))
+			{
+				names.push_back(pos == std::string::npos ? name : dir + name);
+			}
+		}
+		closedir(d);
+		std::sort(names.begin(), names.end(), ArchiveLess);
+		out.assign(names.begin(), names.end());
+	}
+
+	void FileLogAppender::archiveLocked(RollResult& r, time_t start)
+	{
+		std::string name = ArchiveName(m_filename, start);
+		if (rename(m_filename.c_str(), name.c_str()))
+		{
+			std::cout << "FileLogAppender rename " << m_filename << " to " << name
+				<< " failed: " << strerror(errno) << std::endl;
+			return;
+		}
+		if (m_index)
+		{
+			//ûļʱrenameʧܣù
+			rename((m_filename + ".idx").c_str(), (name + ".idx").c_str());
+		}
+		r.trim = true;
+		m_segments.push_back(name);
+		while (m_roll.max_files && m_segments.size() > m_roll.max_files)
+		{
+			r.expired.push_back(m_segments.front());
+			m_segments.pop_front();
+		}
+	}
+
+	bool FileLogAppender::openLocked(RollResult& r)
+	{
+		time_t now = GetCurrentUS() / 1000000;
+		if (m_roll.enabled())
+		{
+			struct stat st;
+			if (stat(m_filename.c_str(), &st) == 0 && st.st_size > 0)
+			{
+				//ʱѾڵļ֪ʼʱ䣬޸ʱ
+				archiveLocked(r, m_fd >= 0 ? m_segmentStart : st.st_mtime);
+			}
+		}
+		r.old_fd = m_fd;
+		//ļﻹûͬڹرǰͬ
+		r.sync = m_syncPolicy != SYNC_NONE && m_unsynced;
+		m_unsynced = false;
+		//׷ģʽȼʱ¾appenderͬʱдͬһļ˭ܽض϶ԷѾд
+		m_fd = ::open(m_filename.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+		m_fileSize = 0;
+		m_segmentStart = now;
+		m_nextRoll = NextRollTime(now, m_roll.interval);
+		if (m_fd < 0)
+		{
+			std::cout << "FileLogAppender open " << m_filename << " failed: " << strerror(errno) << std::endl;
+			return false;
+		}
+		struct stat st;
+		if (fstat(m_fd, &st) == 0)
+		{
+			m_fileSize = st.st_size;
+		}
+		if (m_index)
+		{
+			openIndexLocked();
+		}
+		if (m_roll.preallocate && m_roll.max_size)
+		{
+			r.prealloc_fd = dup(m_fd);
+			r.prealloc_size = m_roll.max_size;
+		}
+		onOpen();
+		return true;
+	}
+
+	//ͷļĩβԤ(FALLOC_FL_KEEP_SIZE)ûõĴ̿顣
+	//صfstatʵʳȶԼǵm_fileSizeȼʱ¾appenderO_APPENDһļ
+	//m_fileSizeܻ֮һappenderд
+	static void TrimPreallocated(int fd)
+	{
+		struct stat st;
+		if (fstat(fd, &st) == 0)
+		{
+			ftruncate(fd, st.st_size);
+		}
+	}
+
+	void FileLogAppender::FinishRoll(RollResult& r)
+	{
+		if (r.prealloc_fd >= 0)
+		{
+			//FALLOC_FL_KEEP_SIZEֻ̿飬ļȲ䣬߳ճ׷
+			fallocate(r.prealloc_fd, FALLOC_FL_KEEP_SIZE, 0, r.prealloc_size);
+			::close(r.prealloc_fd);
+		}
+		if (r.old_fd >= 0)
+		{
+			if (r.sync)
+			{
+				fdatasync(r.old_fd);
+			}
+			if (r.trim)
+			{
+				TrimPreallocated(r.old_fd);
+			}
+			::close(r.old_fd);
+		}
+		for (auto& i : r.expired)
+		{
+			unlink(i.c_str());
+			unlink((i + ".idx").c_str());
+		}
+	}
+
+	FileLogAppender::FileLogAppender(const std::string & filename):m_filename(filename)
+	{
+		reopen();
+	}
+
+	FileLogAppender::FileLogAppender(int fd)
+		:m_adopted(true)
+	{
+		m_fd = fcntl(fd, F_DUPFD_CLOEXEC, 0);
+		if (m_fd < 0)
+		{
+			std::cout << "FileLogAppender dup fd " << fd << " failed: " << strerror(errno) << std::endl;
+		}
+	}
+
+	FileLogAppender::FileLogAppender(const std::string& filename, const RollPolicy& roll,
+		Compression compress, int compress_level)
+		:m_filename(filename), m_roll(roll), m_compressLevel(compress_level)
+	{
+		if (!IsCompressionSupported(compress))
+		{
+			std::cout << "FileLogAppender " << m_filename << " compression "
+				<< CompressionToString(compress) << " is not supported in this build" << std::endl;
+		}
+		else if (compress != COMPRESS_NONE)
+		{
+			m_compress = compress;
+			m_compressor.reset(new LogCompressor(compress, compress_level));
+		}
+		if (m_roll.max_files)
+		{
+			ListArchives(m_filename, m_segments);
+		}
+		reopen();
+		//ͬģʽÿ־ѹһ飬ѹڴ־߳ϣѹҲܲǰں̨ѹ
+		//ûйҵ־ϣˢ̲߳Ҫд๹֮ǰص麯
+		if (m_compressor)
+		{
+			setAsync(1024 * 1024, 1000);
+		}
+	}
+
+	FileLogAppender::~FileLogAppender()
+	{
+		stopAsync();
+		syncLocked(true);
+		if (m_fd >= 0)
+		{
+			if (m_roll.preallocate && m_roll.max_size)
+			{
+				TrimPreallocated(m_fd);
+			}
+			::close(m_fd);
+		}
+		if (m_indexFd >= 0)
+		{
+			::close(m_indexFd);
+		}
+	}
+
+	void FileLogAppender::openIndexLocked()
+	{
+		if (m_indexFd >= 0)
+		{
+			::close(m_indexFd);
+		}
+		std::string path = m_filename + ".idx";
+		m_indexFd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+		if (m_indexFd < 0)
+		{
+			std::cout << "FileLogAppender open " << path << " failed: " << strerror(errno) << std::endl;
+		}
+	}
+
+	bool FileLogAppender::setTimeIndex(uint32_t records, uint32_t interval_ms)
+	{
+		std::lock_guard<std::mutex> lock(m_fileMutex);
+		if (m_adopted && (records || interval_ms))
+		{
+			std::cout << "FileLogAppender time index needs a file name" << std::endl;
+			return false;
+		}
+		if (m_compressor && (records || interval_ms))
+		{
+			std::cout << "FileLogAppender " << m_filename << " time index is not supported with compression" << std::endl;
+			return false;
+		}
+		m_indexRecords = records;
+		m_indexInterval = interval_ms;
+		m_index = records || interval_ms;
+		if (m_index && m_indexFd < 0)
+		{
+			openIndexLocked();
+		}
+		return !m_index || m_indexFd >= 0;
+	}
+
+	bool FileLogAppender::ExtractTimeRange(const std::string& filename, uint64_t begin_us, uint64_t end_us, std::ostream& os)
+	{
+		std::string index_path = filename + ".idx";
+		int log_fd = ::open(filename.c_str(), O_RDONLY | O_CLOEXEC);
+		int index_fd = ::open(index_path.c_str(), O_RDONLY | O_CLOEXEC);
+		struct stat log_st, index_st;
+		bool ok = log_fd >= 0 && index_fd >= 0 && fstat(log_fd, &log_st) == 0 && fstat(index_fd, &index_st) == 0;
+		if (!ok)
+		{
+			std::cout << "FileLogAppender::ExtractTimeRange open " << (log_fd < 0 ? filename : index_path)
+				<< " failed: " << strerror(errno) << std::endl;
+		}
+		//ʱһֻдһ룬
+		size_t count = ok ? index_st.st_size / sizeof(IndexEntry) : 0;
+		uint64_t size = ok ? log_st.st_size : 0;
+		void* index = count ? mmap(nullptr, count * sizeof(IndexEntry), PROT_READ, MAP_SHARED, index_fd, 0) : nullptr;
+		if (index == MAP_FAILED)
+		{
+			std::cout << "FileLogAppender::ExtractTimeRange mmap " << index_path << " failed: " << strerror(errno) << std::endl;
+			ok = false;
+			index = nullptr;
+			count = 0;
+		}
+		uint64_t begin = 0;
+		uint64_t end = size;
+		if (count)
+		{
+			const IndexEntry* first = (const IndexEntry*)index;
+			const IndexEntry* last = first + count;
+			auto less = [](const IndexEntry& e, uint64_t t) { return e.time_us < t; };
+			//һbegin_usʼһend_usΪֹ
+			const IndexEntry* lo = std::lower_bound(first, last, begin_us, less);
+			const IndexEntry* hi = std::lower_bound(lo, last, end_us, less);
+			begin = lo == first ? 0 : (lo - 1)->offset;
+			end = hi == last ? size : hi->offset;
+			munmap(index, count * sizeof(IndexEntry));
+		}
+		begin = std::min(begin, size);
+		end = std::min(std::max(end, begin), size);
+		if (ok && end > begin)
+		{
+			//ֻӳҪһΣ㰴ҳ
+			uint64_t page = sysconf(_SC_PAGESIZE);
+			uint64_t map_begin = begin / page * page;
+			void* data = mmap(nullptr, end - map_begin, PROT_READ, MAP_SHARED, log_fd, map_begin);
+			if (data == MAP_FAILED)
+			{
+				std::cout << "FileLogAppender::ExtractTimeRange mmap " << filename << " failed: " << strerror(errno) << std::endl;
+				ok = false;
+			}
+			else
+			{
+				madvise(data, end - map_begin, MADV_SEQUENTIAL);
+				os.write((const char*)data + (begin - map_begin), end - begin);
+				munmap(data, end - map_begin);
+			}
+		}
+		if (log_fd >= 0)
+		{
+			::close(log_fd);
+		}
+		if (index_fd >= 0)
+		{
+			::close(index_fd);
+		}
+		return ok && os.good();
+	}
+
+	bool FileLogAppender::reopen()
+	{
+		if (m_adopted)
+		{
+			return m_fd >= 0;
+		}
+		RollResult r;
+		bool ok;
+		{
+			std::lock_guard<std::mutex> lock(m_fileMutex);
+			ok = openLocked(r);
+		}
+		FinishRoll(r);
+		return ok;
+	}
+
+	FileLogAppender::RollInterval FileLogAppender::RollIntervalFromString(const std::string& str)
+	{
+		if (str == "hourly" || str == "HOURLY")
+		{
+			return ROLL_HOURLY;
+		}
+		if (str == "daily" || str == "DAILY")
+		{
+			return ROLL_DAILY;
+		}
+		return ROLL_NONE;
+	}
+
+	const char* FileLogAppender::RollIntervalToString(RollInterval interval)
+	{
+		switch (interval)
+		{
+		case ROLL_HOURLY:
+			return "hourly";
+		case ROLL_DAILY:
+			return "daily";
+		default:
+			return "none";
+		}
+	}
+
+	void FileLogAppender::setAsync(size_t buffer_size, uint32_t flush_interval, OverflowPolicy policy)
+	{
+		stopAsync();
+		m_bufferSize = buffer_size ? buffer_size : 1;
+		m_flushInterval = flush_interval ? flush_interval : 1;
+		m_overflow = policy;
+		m_dropped = 0;
+		//黺Ԥȷãֻ֮
+		m_front.reserve(m_bufferSize);
+		m_back.reserve(m_bufferSize);
+		m_async = true;
+		m_thread = std::thread(&FileLogAppender::flushThread, this);
+	}
+
+	void FileLogAppender::stopAsync()
+	{
+		if (!m_async)
+		{
+			return;
+		}
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_stop = true;
+		}
+		m_cond.notify_one();
+		m_notFull.notify_all();
+		m_synced.notify_all();
+		m_thread.join();
+		m_stop = false;
+		m_async = false;
+	}
+
+	void FileLogAppender::flushThread()
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		while (true)
+		{
+			m_cond.wait_for(lock, std::chrono::milliseconds(m_flushInterval), [this]() {
+				return m_stop || m_syncPending || m_front.size() >= m_bufferSize / 2;
+			});
+			if (m_front.empty() && !m_dropped)
+			{
+				bool stop = m_stop;
+				if (m_syncPolicy != SYNC_NONE)
+				{
+					//ûʱҲʱͬһֹͣʱʣµĶͬ
+					lock.unlock();
+					{
+						std::lock_guard<std::mutex> file_lock(m_fileMutex);
+						syncLocked(stop);
+					}
+					lock.lock();
+				}
+				if (stop)
+				{
+					break;
+				}
+				continue;
+			}
+
+			m_front.swap(m_back);
+			m_frontIndex.swap(m_backIndex);
+			uint64_t dropped = m_dropped;
+			m_dropped = 0;
+			uint64_t seq = ++m_flushSeq;
+			bool sync = m_syncPending;
+			m_syncPending = false;
+			lock.unlock();
+			m_notFull.notify_all();
+
+			//ʾһ棬һһwritevд
+			std::string notice = dropped ? droppedNotice(dropped) : std::string();
+			//Ҳд־̲߳ᱻԤ
+			RollResult r;
+			{
+				std::lock_guard<std::mutex> file_lock(m_fileMutex);
+				writeLocked(m_back.data(), m_back.size(), r, m_backIndex.data(), m_backIndex.size(), notice);
+				syncLocked(sync);
+			}
+			FinishRoll(r);
+			m_back.clear();
+			m_backIndex.clear();
+			lock.lock();
+			if (sync)
+			{
+				m_syncedSeq = seq;
+				m_synced.notify_all();
+			}
+		}
+	}
+
+	FileLogAppender::OverflowPolicy FileLogAppender::OverflowFromString(const std::string& str)
+	{
+		if (str == "drop" || str == "DROP")
+		{
+			return DROP;
+		}
+		return BLOCK;
+	}
+
+	const char* FileLogAppender::OverflowToString(OverflowPolicy policy)
+	{
+		return policy == DROP ? "drop" : "block";
+	}
+
+	static void IndexToYaml(YAML::Node& node, uint32_t records, uint32_t interval)
+	{
+		if (records)
+		{
+			node["index_records"] = records;
+		}
+		if (interval)
+		{
+			node["index_interval"] = interval;
+		}
+	}
+
+	static void SyncToYaml(YAML::Node& node, FileLogAppender::SyncPolicy policy, uint32_t interval)
+	{
+		if (policy == FileLogAppender::SYNC_NONE)
+		{
+			return;
+		}
+		node["sync"] = FileLogAppender::SyncPolicyToString(policy);
+		if (policy == FileLogAppender::SYNC_INTERVAL)
+		{
+			node["sync_interval"] = interval;
+		}
+	}
+
+	static void CompressToYaml(YAML::Node& node, FileLogAppender::Compression compress, int level)
+	{
+		if (compress == FileLogAppender::COMPRESS_NONE)
+		{
+			return;
+		}
+		node["compress"] = FileLogAppender::CompressionToString(compress);
+		if (level >= 0)
+		{
+			node["compress_level"] = level;
+		}
+	}
+
+	static void RollToYaml(YAML::Node& node, const FileLogAppender::RollPolicy& roll)
+	{
+		if (!roll.enabled())
+		{
+			return;
+		}
+		if (roll.max_size)
+		{
+			node["max_size"] = roll.max_size;
+		}
+		if (roll.interval != FileLogAppender::ROLL_NONE)
+		{
+			node["roll_interval"] = FileLogAppender::RollIntervalToString(roll.interval);
+		}
+		if (roll.max_files)
+		{
+			node["max_files"] = roll.max_files;
+		}
+		node["preallocate"] = roll.preallocate;
+	}
+
+	const char BinaryLogAppender::MAGIC[8] = { 'C', 'C', 'H', 'B', 'L', 'O', 'G', '\0' };
+
+	template<class T>
+	static inline char* PutValue(char* p, T v)
+	{
+		memcpy(p, &v, sizeof(T));
+		return p + sizeof(T);
+	}
+
+	//Ųʱضַ
+	static inline char* PutString(char* p, char* end, const char* s, size_t len)
+	{
+		size_t left = end - p - sizeof(uint32_t);
+		len = len < left ? len : left;
+		p = PutValue(p, (uint32_t)len);
+		memcpy(p, s, len);
+		return p + len;
+	}
+
+	//¼ͷu8 + u32سȣظصʼλ
+	static inline char* BeginRecord(char* buf, uint8_t type)
+	{
+		buf[0] = type;
+		return buf + 1 + sizeof(uint32_t);
+	}
+
+	static inline size_t EndRecord(char* buf, char* p)
+	{
+		uint32_t len = p - buf - 1 - sizeof(uint32_t);
+		memcpy(buf + 1, &len, sizeof(len));
+		return p - buf;
+	}
+
+	BinaryLogAppender::BinaryLogAppender(const std::string& filename, const RollPolicy& roll,
+		Compression compress, int compress_level)
+		:FileLogAppender(filename, roll, compress, compress_level)
+		,m_sites(new std::atomic<bool>[MAX_SITES]())
+		,m_loggers(new std::atomic<bool>[MAX_LOGGERS]())
+	{
+		reopen();
+	}
+
+	BinaryLogAppender::~BinaryLogAppender()
+	{
+		//ˢ̻߳صdroppedNotice֮ǰͣ
+		stopAsync();
+	}
+
+	bool BinaryLogAppender::reopen()
+	{
+		std::lock_guard<std::mutex> lock(m_defineMutex);
+		for (int i = 0; i < MAX_SITES; ++i)
+		{
+			m_sites[i].store(false, std::memory_order_relaxed);
+		}
+		for (int i = 0; i < MAX_LOGGERS; ++i)
+		{
+			m_loggers[i].store(false, std::memory_order_relaxed);
+		}
+		{
+			std::lock_guard<std::mutex> cache_lock(m_cacheMutex);
+			m_defines.clear();
+		}
+		return FileLogAppender::reopen();
+	}
+
+	void BinaryLogAppender::onOpen()
+	{
+		char header[sizeof(MAGIC) + sizeof(uint32_t)];
+		memcpy(header, MAGIC, sizeof(MAGIC));
+		PutValue(header + sizeof(MAGIC), VERSION);
+		//ļͷѻĶһд
+		std::lock_guard<std::mutex> lock(m_cacheMutex);
+		struct iovec iov[2] = { { header, sizeof(header) }, { (void*)m_defines.data(), m_defines.size() } };
+		writeFile(iov, m_defines.empty() ? 1 : 2);
+	}
+
+	bool BinaryLogAppender::writeDefine(const char* data, size_t len)
+	{
+		//Ƚдļм䷢ʱļͬĶ壬ʱһݸǰһ
+		size_t cached;
+		{
+			std::lock_guard<std::mutex> lock(m_cacheMutex);
+			cached = m_defines.size();
+			m_defines.append(data, len);
+		}
+		if (write(data, len))
+		{
+			return true;
+		}
+		//첽ӻﳷ´ٶ壬ʱԽԽࡣ
+		//ֻڳm_defineMutexʱ׷ӣﳷһǸղ׷ӵǶ
+		std::lock_guard<std::mutex> lock(m_cacheMutex);
+		if (m_defines.size() == cached + len)
+		{
+			m_defines.resize(cached);
+		}
+		return false;
+	}
+
+	bool BinaryLogAppender::define(LogCallSite* site, const Logger::ptr& logger)
+	{
+		uint32_t sid = site ? site->getId() : 0;
+		uint32_t lid = logger->getId();
+		auto need_site = [this, sid]() {
+			return sid && (sid >= MAX_SITES || !m_sites[sid].load(std::memory_order_acquire));
+		};
+		auto need_logger = [this, lid]() {
+			return lid >= MAX_LOGGERS || !m_loggers[lid].load(std::memory_order_acquire);
+		};
+		if (!need_site() && !need_logger())
+		{
+			return true;
+		}
+
+		std::lock_guard<std::mutex> lock(m_defineMutex);
+		bool ok = true;
+		char buf[LogStream::BUFFER_SIZE];
+		char* end = buf + sizeof(buf);
+		if (need_site())
+		{
+			const LogFmtSpec* spec = site->getCompiled();
+			const char* fmt = spec ? spec->getFormat() : "";
+			char* p = BeginRecord(buf, RECORD_SITE);
+			p = PutValue(p, sid);
+			p = PutValue(p, site->getLine());
+			p = PutString(p, end, site->getFile(), strlen(site->getFile()));
+			p = PutString(p, end, fmt, strlen(fmt));
+			size_t len = EndRecord(buf, p);
+			if (!writeDefine(buf, len))
+			{
+				ok = false;
+			}
+			else if (sid < MAX_SITES)
+			{
+				m_sites[sid].store(true, std::memory_order_release);
+			}
+		}
+		if (need_logger())
+		{
+			char* p = BeginRecord(buf, RECORD_LOGGER);
+			p = PutValue(p, lid);
+			p = PutString(p, end, logger->getName().c_str(), logger->getName().size());
+			size_t len = EndRecord(buf, p);
+			if (!writeDefine(buf, len))
+			{
+				ok = false;
+			}
+			else if (lid < MAX_LOGGERS)
+			{
+				m_loggers[lid].store(true, std::memory_order_release);
+			}
+		}
+		return ok;
+	}
+
+	void BinaryLogAppender::log(Logger::ptr /*logger*/, LogLevel::Level level, LogEvent::ptr event)
+	{
+		if (level < m_level)
+		{
+			return;
+		}
+		//%cȡ¼־תroot
+		LogCallSite* site = event->getSite();
+		Logger::ptr owner = event->getLogger();
+		if (!define(site, owner))
+		{
+			//屻ʱ¼ҲдʱҲõ㣬Ѿ붪ͳ
+			return;
+		}
+
+		char buf[LogStream::BUFFER_SIZE];
+		char* end = buf + sizeof(buf);
+		const LogFmtSpec* spec = event->getFmtSpec();
+		char* p = BeginRecord(buf, RECORD_EVENT);
+		p = PutValue(p, (uint32_t)(site ? site->getId() : 0));
+		p = PutValue(p, owner->getId());
+		p = PutValue(p, (uint8_t)level);
+		p = PutValue(p, (uint8_t)(spec ? EVENT_FLAG_ARGS : 0));
+		p = PutValue(p, (uint64_t)event->getTime() * 1000000 + event->getUsec());
+		p = PutValue(p, event->getThreadId());
+		p = PutValue(p, event->getFiberId());
+		p = PutValue(p, event->gettElapse());
+		if (!site)
+		{
+			p = PutValue(p, event->getLine());
+			p = PutString(p, end, event->getFile(), strlen(event->getFile()));
+		}
+		if (spec)
+		{
+			//CONTENT_SIZEһŵ
+			memcpy(p, event->getArgsData(), event->getArgsSize());
+			p += event->getArgsSize();
+		}
+		else
+		{
+			size_t len = event->getContentSize();
+			len = len < (size_t)(end - p) ? len : end - p;
+			memcpy(p, event->getContentData(), len);
+			p += len;
+		}
+		write(buf, EndRecord(buf, p), 0, needSync(level));
+	}
+
+	std::string BinaryLogAppender::droppedNotice(uint64_t dropped)
+	{
+		//ûеõ־EVENT¼ʱ־Ϊ
+		std::stringstream ss;
+		ss << "<<BinaryLogAppender dropped " << dropped << " log records, async buffer full>>";
+		std::string msg = ss.str();
+		const char* file = __FILE__;
+		char buf[LogStream::BUFFER_SIZE];
+		char* end = buf + sizeof(buf);
+		char* p = BeginRecord(buf, RECORD_EVENT);
+		p = PutValue(p, (uint32_t)0);
+		p = PutValue(p, (uint32_t)0);
+		p = PutValue(p, (uint8_t)LogLevel::WARN);
+		p = PutValue(p, (uint8_t)0);
+		p = PutValue(p, GetCurrentUS());
+		p = PutValue(p, (uint32_t)GetThreadId());
+		p = PutValue(p, (uint32_t)0);
+		p = PutValue(p, (uint32_t)0);
+		p = PutValue(p, (int32_t)__LINE__);
+		p = PutString(p, end, file, strlen(file));
+		memcpy(p, msg.c_str(), msg.size());
+		p += msg.size();
+		return std::string(buf, EndRecord(buf, p));
+	}
+
+	std::string BinaryLogAppender::toYamlString()
+	{
+		YAML::Node node;
+		node["type"] = "BinaryLogAppender";
+		node["file"] = m_filename;
+		node["level"] = LogLevel::ToString(m_level);
+		if (m_async)
+		{
+			node["async"] = true;
+			node["buffer_size"] = m_bufferSize;
+			node["flush_interval"] = m_flushInterval;
+			node["overflow"] = OverflowToString(m_overflow);
+		}
+		SyncToYaml(node, m_syncPolicy, m_syncInterval);
+		RollToYaml(node, m_roll);
+		CompressToYaml(node, m_compress, m_compressLevel);
+		std::stringstream ss;
+		ss << node;
+		return ss.str();
+	}
+
+	//ʱ˳ȡֶΣԽһֱfalse
+	struct BinaryReader
+	{
+		const char* p;
+		const char* end;
+		bool ok = true;
+
+		BinaryReader(const char* data, size_t len) :p(data), end(data + len) {}
+
+		template<class T>
+		T get()
+		{
+			T v = T();
+			if (ok && (size_t)(end - p) >= sizeof(T))
+			{
+				memcpy(&v, p, sizeof(T));
+				p += sizeof(T);
+			}
+			else
+			{
+				ok = false;
+			}
+			return v;
+		}
+
+		std::string getString()
+		{
+			uint32_t len = get<uint32_t>();
+			if (!ok || (size_t)(end - p) < len)
+			{
+				ok = false;
+				return "";
+			}
+			std::string str(p, len);
+			p += len;
+			return str;
+		}
+	};
+
+#if CCH_LOG_ZLIB
+	//ѹβӵĶgzip memberһ鲻(дһ̱)ʱܽĲ֣false
+	static bool GunzipAll(const std::string& in, std::string& out)
+	{
+		z_stream zs;
+		memset(&zs, 0, sizeof(zs));
+		if (inflateInit2(&zs, 15 + 16) != Z_OK)
+		{
+			return false;
+		}
+		zs.next_in = (Bytef*)in.data();
+		zs.avail_in = in.size();
+		char buf[64 * 1024];
+		bool ok = true;
+		while (true)
+		{
+			zs.next_out = (Bytef*)buf;
+			zs.avail_out = sizeof(buf);
+			int rt = inflate(&zs, Z_NO_FLUSH);
+			out.append(buf, sizeof(buf) - zs.avail_out);
+			if (rt == Z_STREAM_END)
+			{
+				inflateReset(&zs);
+				if (!zs.avail_in)
+				{
+					break;
+				}
+				continue;
+			}
+			//û˵Ѿ꣬һûн
+			if (rt != Z_OK || (!zs.avail_in && zs.avail_out))
+			{
+				ok = false;
+				break;
+			}
+		}
+		inflateEnd(&zs);
+		return ok;
+	}
+#endif
+
+	bool BinaryLogAppender::Decode(const std::string& filename, std::ostream& os, LogFormatter::ptr formatter)
+	{
+		std::ifstream ifs(filename, std::ios::binary);
+		if (!ifs)
+		{
+			std::cout << "BinaryLogAppender::Decode open " << filename << " failed" << std::endl;
+			return false;
+		}
+		std::string data((std::istreambuf_iterator<char>(ifs)), std::istreambuf_iterator<char>());
+		if (data.size() >= 2 && (uint8_t)data[0] == 0x1f && (uint8_t)data[1] == 0x8b)
+		{
+#if CCH_LOG_ZLIB
+			std::string raw;
+			if (!GunzipAll(data, raw))
+			{
+				std::cout << "BinaryLogAppender::Decode " << filename << " last gzip block is incomplete" << std::endl;
+			}
+			data.swap(raw);
+#else
+			std::cout << "BinaryLogAppender::Decode " << filename << " is gzip compressed, unzip it first" << std::endl;
+			return false;
+#endif
+		}
+		BinaryReader in(data.data(), data.size());
+		char magic[sizeof(MAGIC)];
+		for (size_t i = 0; i < sizeof(MAGIC); ++i)
+		{
+			magic[i] = in.get<char>();
+		}
+		uint32_t version = in.get<uint32_t>();
+		if (!in.ok || memcmp(magic, MAGIC, sizeof(MAGIC)) || version != VERSION)
+		{
+			std::cout << "BinaryLogAppender::Decode " << filename << " is not a binary log" << std::endl;
+			return false;
+		}
+
+		struct Site
+		{
+			int32_t line = 0;
+			std::string file;
+			std::string fmt;
+			std::unique_ptr<LogFmtSpec> spec;
+		};
+		std::map<uint32_t, Site> sites;
+		std::map<uint32_t, Logger::ptr> loggers;
+		char buf[LogStream::BUFFER_SIZE];
+		while (in.p != in.end)
+		{
+			//ļ׷Ӵ򿪵ģÿδ򿪶дһļͷ֮idµһΣ¶
+			if ((size_t)(in.end - in.p) >= sizeof(magic) + sizeof(uint32_t) && !memcmp(in.p, MAGIC, sizeof(MAGIC)))
+			{
+				in.p += sizeof(MAGIC);
+				if (in.get<uint32_t>() != VERSION)
+				{
+					std::cout << "BinaryLogAppender::Decode " << filename << " unsupported version" << std::endl;
+					return false;
+				}
+				sites.clear();
+				loggers.clear();
+				continue;
+			}
+			uint8_t type = in.get<uint8_t>();
+			uint32_t len = in.get<uint32_t>();
+			if (!in.ok || (size_t)(in.end - in.p) < len)
+			{
+				std::cout << "BinaryLogAppender::Decode " << filename << " truncated record" << std::endl;
+				return false;
+			}
+			BinaryReader rec(in.p, len);
+			in.p += len;
+			if (type == RECORD_SITE)
+			{
+				uint32_t id = rec.get<uint32_t>();
+				Site& site = sites[id];
+				site.line = rec.get<int32_t>();
+				site.file = rec.getString();
+				site.fmt = rec.getString();
+				site.spec.reset(site.fmt.empty() ? nullptr : LogFmtSpec::Compile(site.fmt.c_str()));
+			}
+			else if (type == RECORD_LOGGER)
+			{
+				uint32_t id = rec.get<uint32_t>();
+				loggers[id].reset(new Logger(rec.getString()));
+			}
+			else if (type == RECORD_EVENT)
+			{
+				uint32_t sid = rec.get<uint32_t>();
+				uint32_t lid = rec.get<uint32_t>();
+				LogLevel::Level level = (LogLevel::Level)rec.get<uint8_t>();
+				uint8_t flags = rec.get<uint8_t>();
+				uint64_t time_us = rec.get<uint64_t>();
+				uint32_t threadid = rec.get<uint32_t>();
+				uint32_t fiberid = rec.get<uint32_t>();
+				uint32_t elapse = rec.get<uint32_t>();
+				int32_t line = 0;
+				std::string file;
+				const LogFmtSpec* spec = nullptr;
+				if (sid)
+				{
+					Site& site = sites[sid];
+					line = site.line;
+					file = site.file;
+					spec = site.spec.get();
+				}
+				else
+				{
+					line = rec.get<int32_t>();
+					file = rec.getString();
+				}
+				Logger::ptr& logger = loggers[lid];
+				if (!logger)
+				{
+					logger.reset(new Logger(""));
+				}
+				if (!rec.ok)
+				{
+					continue;
+				}
+
+				LogEvent event(logger, level, file.c_str(), line, elapse, threadid, fiberid,
+					time_us / 1000000, time_us % 1000000);
+				if ((flags & EVENT_FLAG_ARGS) && spec)
+				{
+					event.setArgs(spec, rec.p, rec.end - rec.p);
+				}
+				else
+				{
+					event.getSS().write(rec.p, rec.end - rec.p);
+				}
+				size_t n = formatter->format(buf, sizeof(buf), logger, level, LogEvent::ptr(LogEvent::ptr(), &event));
+				os.write(buf, n);
+			}
+		}
+		return true;
+	}
+
+	struct MmapLogAppender::Segment
+	{
+		uint32_t seq = 0;
+		int fd = -1;
+		char* base = nullptr;
+		uint64_t size = 0;
+		std::atomic<uint64_t> offset;	//һԤ㣬Գsize
+		std::atomic<uint64_t> written;	//Ѿɵֽ
+
+		Segment() :offset(0), written(0) {}
+	};
+
+	MmapLogAppender::MmapLogAppender(const std::string& filename, size_t segment_size)
+		:m_filename(filename)
+		,m_segmentSize(segment_size < MIN_SEGMENT_SIZE ? (size_t)MIN_SEGMENT_SIZE : segment_size)
+		,m_current(nullptr)
+		,m_retryTime(0)
+		,m_openFailed(false)
+	{
+		//ϴµκдǾ־
+		size_t pos = filename.rfind('/');
+		std::string dir = pos == std::string::npos ? "." : filename.substr(0, pos + 1);
+		std::string prefix = (pos == std::string::npos ? filename : filename.substr(pos + 1)) + ".";
+		uint32_t seq = 0;
+		if (DIR* d = opendir(dir.c_str()))
+		{
+			while (struct dirent* e = readdir(d))
+			{
+				const char* name = e->d_name;
+				if (strncmp(name, prefix.c_str(), prefix.size()) == 0 && isdigit((unsigned char)name[prefix.size()]))
+				{
+					seq = std::max(seq, (uint32_t)atoi(name + prefix.size()) + 1);
+				}
+			}
+			closedir(d);
+		}
+		m_firstSeq = seq;
+		std::lock_guard<std::mutex> lock(m_openMutex);
+		m_current.store(tryOpenSegment(seq), std::memory_order_release);
+	}
+
+	MmapLogAppender::~MmapLogAppender()
+	{
+		//ʱѾû߳д
+		Segment* seg = m_current.exchange(nullptr);
+		if (seg)
+		{
+			closeSegment(seg, std::min(seg->offset.load(), seg->size));
+			delete seg;
+		}
+	}
+
+	MmapLogAppender::Segment* MmapLogAppender::openSegment(uint32_t seq)
+	{
+		char suffix[16];
+		snprintf(suffix, sizeof(suffix), ".%06u", seq);
+		std::string path = m_filename + suffix;
+		int fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+		if (fd < 0)
+		{
+			if (!m_openFailed)
+			{
+				std::cout << "MmapLogAppender open " << path << " failed: " << strerror(errno) << std::endl;
+			}
+			return nullptr;
+		}
+		//ȷô̿飬ʱʧܣдӳʱյSIGBUS
+		//ֻļϵͳ֧Ԥʱ˻صftruncate(ϡļ)posix_fallocateֱӷش룬errno
+		int rc = posix_fallocate(fd, 0, m_segmentSize);
+		if (rc == EOPNOTSUPP || rc == EINVAL)
+		{
+			rc = ftruncate(fd, m_segmentSize) == 0 ? 0 : errno;
+		}
+		if (rc != 0)
+		{
+			if (!m_openFailed)
+			{
+				std::cout << "MmapLogAppender resize " << path << " failed: " << strerror(rc) << std::endl;
+			}
+			::close(fd);
+			return nullptr;
+		}
+		void* base = mmap(nullptr, m_segmentSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+		if (base == MAP_FAILED)
+		{
+			if (!m_openFailed)
+			{
+				std::cout << "MmapLogAppender mmap " << path << " failed: " << strerror(errno) << std::endl;
+			}
+			::close(fd);
+			return nullptr;
+		}
+		Segment* seg = new Segment;
+		seg->seq = seq;
+		seg->fd = fd;
+		seg->base = (char*)base;
+		seg->size = m_segmentSize;
+		return seg;
+	}
+
+	MmapLogAppender::Segment* MmapLogAppender::tryOpenSegment(uint32_t seq)
+	{
+		uint64_t now = GetCurrentUS();
+		if (now < m_retryTime)
+		{
+			return nullptr;
+		}
+		Segment* seg = openSegment(seq);
+		if (!seg)
+		{
+			if (!m_openFailed)
+			{
+				std::cout << "MmapLogAppender " << m_filename << " cannot open segment " << seq
+					<< ", dropping logs until it can be opened" << std::endl;
+				m_openFailed = true;
+			}
+			m_retryTime = now + 1000000;
+			return nullptr;
+		}
+		if (m_openFailed)
+		{
+			std::cout << "MmapLogAppender " << m_filename << " opened segment " << seq << ", logging resumed" << std::endl;
+			m_openFailed = false;
+		}
+		return seg;
+	}
+
+	void MmapLogAppender::closeSegment(Segment* seg, uint64_t end)
+	{
+		//Ԥend֮ǰֻ߳ʣmemcpyû꣬һ¾ͺ
+		while (seg->written.load(std::memory_order_acquire) < end)
+		{
+			std::this_thread::yield();
+		}
+		munmap(seg->base, seg->size);
+		seg->base = nullptr;
+		if (ftruncate(seg->fd, end) != 0)
+		{
+			std::cout << "MmapLogAppender truncate segment " << seg->seq << " failed: " << strerror(errno) << std::endl;
+		}
+		::close(seg->fd);
+		seg->fd = -1;
+	}
+
+	bool MmapLogAppender::rollover(Segment* seg, uint64_t off)
+	{
+		Segment* next;
+		{
+			std::lock_guard<std::mutex> lock(m_openMutex);
+			next = tryOpenSegment(seg->seq + 1);
+		}
+		if (!next)
+		{
+			//дľɶΣԤλ˻صԽβ֮ǰһԽβ־л
+			//˻ǰ߳ԽβԤǵЩ־
+			seg->offset.store(off, std::memory_order_release);
+			return false;
+		}
+		m_current.store(next, std::memory_order_release);
+		closeSegment(seg, off);
+		return true;
+	}
+
+	void MmapLogAppender::log(Logger::ptr logger, LogLevel::Level level, LogEvent::ptr event)
+	{
+		if (level < m_level)
+		{
+			return;
+		}
+		char msg[LogStream::BUFFER_SIZE];
+		append(msg, m_formatter->format(msg, sizeof(msg), logger, level, event));
+	}
+
+	void MmapLogAppender::logRendered(Logger::ptr /*logger*/, LogLevel::Level level, LogEvent::ptr /*event*/,
+		const char* data, size_t len)
+	{
+		if (level >= m_level)
+		{
+			append(data, len);
+		}
+	}
+
+	void MmapLogAppender::append(const char* msg, size_t len)
+	{
+		while (true)
+		{
+			Segment* retired = nullptr;
+			bool done;
+			{
+				Rcu::ReadGuard guard;
+				done = tryAppend(msg, len, retired);
+			}
+			if (retired)
+			{
+				//ܻ߳̿žɶfetch_addṹȿڹͷš
+				//ڶٽRetireȿڵдߺụȴ
+				Rcu::Retire([retired]() {
+					delete retired;
+				});
+			}
+			if (done)
+			{
+				return;
+			}
+		}
+	}
+
+	bool MmapLogAppender::tryAppend(const char* msg, size_t len, Segment*& retired)
+	{
+		while (true)
+		{
+			Segment* seg = m_current.load(std::memory_order_acquire);
+			if (!seg)
+			{
+				//ʱһû򿪣
+				std::lock_guard<std::mutex> lock(m_openMutex);
+				if (!m_current.load(std::memory_order_relaxed))
+				{
+					seg = tryOpenSegment(m_firstSeq);
+					if (!seg)
+					{
+						return true;
+					}
+					m_current.store(seg, std::memory_order_release);
+				}
+				continue;
+			}
+			uint64_t off = seg->offset.fetch_add(len, std::memory_order_relaxed);
+			if (off + len <= seg->size)
+			{
+				memcpy(seg->base + off, msg, len);
+				seg->written.fetch_add(len, std::memory_order_release);
+				return true;
+			}
+			if (off <= seg->size)
+			{
+				//ģֻһ̵߳Ԥβ
+				if (!rollover(seg, off))
+				{
+					return true;
+				}
+				retired = seg;
+				return false;
+			}
+			//ȿβ߳лꣻлʧʱԤλ˻ضڣ־
+			while (m_current.load(std::memory_order_acquire) == seg
+				&& seg->offset.load(std::memory_order_acquire) > seg->size)
+			{
+				std::this_thread::yield();
+			}
+			if (m_current.load(std::memory_order_acquire) == seg)
+			{
+				return true;
+			}
+		}
+	}
+
+	std::string MmapLogAppender::toYamlString()
+	{
+		YAML::Node node;
+		node["type"] = "MmapLogAppender";
+		node["file"] = m_filename;
+		node["segment_size"] = m_segmentSize;
+		node["level"] = LogLevel::ToString(m_level);
+		if (m_formatter)
+		{
+			node["formatter"] = m_formatter->getPattern();
+		}
+		std::stringstream ss;
+		ss << node;
+		return ss.str();
+	}
+
+	//һ¼ֶζǴLogEventԭģתʱŸʽ
+	struct FlightRecord
+	{
+		enum { DATA_SIZE = 400 };
+		uint64_t time;	//΢
+		const char* file;	//__FILE__һֱЧ
+		const LogFmtSpec* spec;	//ǿձʾdataǰspecĲ(õspecͷ)ı
+		int32_t line;
+		uint32_t threadid;
+		uint32_t fiberid;
+		uint32_t elapse;
+		uint16_t len;
+		uint8_t level;
+		char name[29];	//־ƣض
+		char data[DATA_SIZE];
+	};
+
+	struct FlightSlot
+	{
+		std::atomic<uint64_t> seq;	//дΪ0дΪ+1תʱǰһ
+		FlightRecord rec;
+	};
+
+	//ֻг߳дתֻ߳
+	struct FlightRing
+	{
+		std::atomic<int> refs;	//¼ʹ̸߳һ
+		std::atomic<bool> inUse;	//߳˳falseԷָ߳
+		std::atomic<uint64_t> head;	//һ¼
+		uint32_t capacity;
+		FlightSlot* slots;
+
+		FlightRing(uint32_t cap) :refs(1), inUse(true), head(0), capacity(cap), slots(new FlightSlot[cap])
+		{
+			for (uint32_t i = 0; i < cap; ++i)
+			{
+				slots[i].seq.store(0, std::memory_order_relaxed);
+			}
+		}
+		~FlightRing() { delete[] slots; }
+
+		void unref()
+		{
+			if (refs.fetch_sub(1, std::memory_order_acq_rel) == 1)
+			{
+				delete this;
+			}
+		}
+	};
+
+	//߳˽У¼id̵߳Ļ߳˳ʱ黹
+	struct FlightRingCache
+	{
+		enum { SIZE = 4 };
+		struct Entry
+		{
+			uint64_t owner = 0;
+			FlightRing* ring = nullptr;
+		};
+		Entry entries[SIZE];
+		uint32_t next = 0;
+
+		static void Release(FlightRing* ring)
+		{
+			if (ring)
+			{
+				ring->inUse.store(false, std::memory_order_release);
+				ring->unref();
+			}
+		}
+		~FlightRingCache()
+		{
+			for (auto& i : entries)
+			{
+				Release(i.ring);
+			}
+		}
+	};
+
+	static thread_local FlightRingCache t_flight_rings;
+	static std::atomic<uint64_t> s_flight_id(0);
+
+	//źŴҪļ¼ܼù̶С
+	enum { MAX_FLIGHT_RECORDERS = 8 };
+	static std::atomic<FlightRecorderLogAppender*> s_flight_recorders[MAX_FLIGHT_RECORDERS];
+	static const int s_flight_signals[] = { SIGSEGV, SIGABRT };
+	static struct sigaction s_flight_old_actions[2];
+
+	FlightRecorderLogAppender::FlightRecorderLogAppender(const std::string& filename, uint32_t capacity)
+		:m_filename(filename)
+		,m_capacity(capacity ? capacity : 1)
+		,m_id(++s_flight_id)
+		,m_rings(new std::atomic<FlightRing*>[MAX_RINGS])
+		,m_ringCount(0)
+		,m_dumping(false)
+	{
+		for (size_t i = 0; i < MAX_RINGS; ++i)
+		{
+			m_rings[i].store(nullptr, std::memory_order_relaxed);
+		}
+		InstallSignalHandlers();
+		for (auto& i : s_flight_recorders)
+		{
+			FlightRecorderLogAppender* expected = nullptr;
+			if (i.compare_exchange_strong(expected, this))
+			{
+				return;
+			}
+		}
+		std::cout << "FlightRecorderLogAppender " << filename << ": too many recorders, not dumped on signal" << std::endl;
+	}
+
+	FlightRecorderLogAppender::~FlightRecorderLogAppender()
+	{
+		for (auto& i : s_flight_recorders)
+		{
+			FlightRecorderLogAppender* expected = this;
+			i.compare_exchange_strong(expected, nullptr);
+		}
+		//̻߳Ļ̹߳黹ʱͷ
+		uint32_t count = m_ringCount.load(std::memory_order_acquire);
+		for (uint32_t i = 0; i < count; ++i)
+		{
+			m_rings[i].load(std::memory_order_relaxed)->unref();
+		}
+	}
+
+	void FlightRecorderLogAppender::InstallSignalHandlers()
+	{
+		static std::once_flag s_once;
+		std::call_once(s_once, []() {
+			struct sigaction sa;
+			memset(&sa, 0, sizeof(sa));
+			sa.sa_handler = &FlightRecorderLogAppender::OnSignal;
+			sigemptyset(&sa.sa_mask);
+			sa.sa_flags = SA_ONSTACK;	//߳˱ջʱڱջУջҲת
+			for (size_t i = 0; i < sizeof(s_flight_signals) / sizeof(s_flight_signals[0]); ++i)
+			{
+				sigaction(s_flight_signals[i], &sa, &s_flight_old_actions[i]);
+			}
+		});
+	}
+
+	void FlightRecorderLogAppender::OnSignal(int sig)
+	{
+		const char* reason = sig == SIGSEGV ? "SIGSEGV" : "SIGABRT";
+		for (auto& i : s_flight_recorders)
+		{
+			if (FlightRecorderLogAppender* r = i.load(std::memory_order_acquire))
+			{
+				r->dump(reason, true);
+			}
+		}
+		//ָԭĴʽغͶݵźŰԭķʽ(Ĭcoreļ)
+		for (size_t i = 0; i < sizeof(s_flight_signals) / sizeof(s_flight_signals[0]); ++i)
+		{
+			if (s_flight_signals[i] == sig)
+			{
+				sigaction(sig, &s_flight_old_actions[i], nullptr);
+			}
+		}
+		raise(sig);
+	}
+
+	FlightRing* FlightRecorderLogAppender::ring()
+	{
+		FlightRingCache& cache = t_flight_rings;
+		for (auto& i : cache.entries)
+		{
+			if (i.owner == m_id)
+			{
+				return i.ring;
+			}
+		}
+		FlightRing* ring = nullptr;
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			uint32_t count = m_ringCount.load(std::memory_order_relaxed);
+			//ʱ˳̵߳ļ¼KEEP_RINGSã̲߳½˳ʱڴ治
+			for (uint32_t i = 0; i < count && count >= KEEP_RINGS && !ring; ++i)
+			{
+				FlightRing* r = m_rings[i].load(std::memory_order_relaxed);
+				bool expected = false;
+				if (r->inUse.compare_exchange_strong(expected, true, std::memory_order_acquire))
+				{
+					ring = r;
+				}
+			}
+			if (!ring && count < MAX_RINGS)
+			{
+				ring = new FlightRing(m_capacity);
+				m_rings[count].store(ring, std::memory_order_release);
+				m_ringCount.store(count + 1, std::memory_order_release);
+			}
+			if (ring)
+			{
+				ring->refs.fetch_add(1, std::memory_order_relaxed);
+			}
+		}
+		//ûֵʱҲֱ֮ÿμ
+		FlightRingCache::Entry* entry = nullptr;
+		for (auto& i : cache.entries)
+		{
+			if (!i.owner)
+			{
+				entry = &i;
+				break;
+			}
+		}
+		if (!entry)
+		{
+			entry = &cache.entries[cache.next++ % FlightRingCache::SIZE];
+			FlightRingCache::Release(entry->ring);
+		}
+		entry->owner = m_id;
+		entry->ring = ring;
+		return ring;
+	}
+
+	void FlightRecorderLogAppender::log(Logger::ptr /*logger*/, LogLevel::Level level, LogEvent::ptr event)
+	{
+		if (level < m_level)
+		{
+			return;
+		}
+		if (FlightRing* r = ring())
+		{
+			uint64_t seq = r->head.load(std::memory_order_relaxed);
+			FlightSlot& slot = r->slots[seq % r->capacity];
+			slot.seq.store(0, std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_release);
+
+			FlightRecord& rec = slot.rec;
+			rec.time = (uint64_t)event->getTime() * 1000000 + event->getUsec();
+			rec.file = event->getFile();
+			rec.line = event->getLine();
+			rec.threadid = event->getThreadId();
+			rec.fiberid = event->getFiberId();
+			rec.elapse = event->gettElapse();
+			rec.level = (uint8_t)level;
+			const std::string& name = event->getLogger()->getName();
+			size_t n = std::min(name.size(), sizeof(rec.name) - 1);
+			memcpy(rec.name, name.data(), n);
+			rec.name[n] = '\0';
+			const LogFmtSpec* spec = event->getFmtSpec();
+			if (spec && event->getArgsSize() <= FlightRecord::DATA_SIZE)
+			{
+				rec.spec = spec;
+				rec.len = event->getArgsSize();
+				memcpy(rec.data, event->getArgsData(), rec.len);
+			}
+			else
+			{
+				rec.spec = nullptr;
+				rec.len = std::min(event->getContentSize(), (size_t)FlightRecord::DATA_SIZE);
+				memcpy(rec.data, event->getContentData(), rec.len);
+			}
+
+			slot.seq.store(seq + 1, std::memory_order_release);
+			r->head.store(seq + 1, std::memory_order_release);
+		}
+		if (level == LogLevel::FATAL)
+		{
+			dump("FATAL");
+		}
+	}
+
+	//ֻwriteڴ棬źŴҲԵ
+	static void WriteAll(int fd, const char* data, size_t len)
+	{
+		while (len)
+		{
+			ssize_t n = ::write(fd, data, len);
+			if (n < 0)
+			{
+				if (errno == EINTR)
+				{
+					continue;
+				}
+				return;
+			}
+			data += n;
+			len -= n;
+		}
+	}
+
+	//źŴõʮAppendUIntһֻͿ
+	static char* AppendHex(char* p, char* end, const char* data, size_t len)
+	{
+		static const char s_hex[] = "0123456789abcdef";
+		for (size_t i = 0; i < len && end - p >= 2; ++i)
+		{
+			*p++ = s_hex[(uint8_t)data[i] >> 4];
+			*p++ = s_hex[(uint8_t)data[i] & 0xf];
+		}
+		return p;
+	}
+
+	//źŴתʽlocaltimeprintf֮಻ĺ
+	//.΢  ߳id  Эid  [level]  [־]  ļ:к  CCH_LOG_FMT_*ĸʽ + Ʊ + ʮƵĲ룬
+	//ʽ־ֱ
+	static char* DumpRaw(char* p, char* end, const FlightRecord& rec)
+	{
+		p = AppendUInt(p, end, rec.time / 1000000);
+		p = AppendBytes(p, end, ".", 1);
+		char usec[8];
+		char* u = AppendUInt(usec, usec + sizeof(usec), 1000000 + rec.time % 1000000);
+		p = AppendBytes(p, end, usec + 1, u - usec - 1);
+		p = AppendBytes(p, end, "\t", 1);
+		p = AppendUInt(p, end, rec.threadid);
+		p = AppendBytes(p, end, "\t", 1);
+		p = AppendUInt(p, end, rec.fiberid);
+		p = AppendBytes(p, end, "\t[", 2);
+		const char* level = LogLevel::ToString((LogLevel::Level)rec.level);
+		p = AppendBytes(p, end, level, strlen(level));
+		p = AppendBytes(p, end, "]\t[", 3);
+		p = AppendBytes(p, end, rec.name, strlen(rec.name));
+		p = AppendBytes(p, end, "]\t", 2);
+		p = AppendBytes(p, end, rec.file, strlen(rec.file));
+		p = AppendBytes(p, end, ":", 1);
+		p = AppendInt(p, end, rec.line);
+		p = AppendBytes(p, end, "\t", 1);
+		if (rec.spec)
+		{
+			const char* fmt = rec.spec->getFormat();
+			p = AppendBytes(p, end, fmt, strlen(fmt));
+			p = AppendBytes(p, end, "\t", 1);
+			p = AppendHex(p, end, rec.data, rec.len);
+		}
+		else
+		{
+			p = AppendBytes(p, end, rec.data, rec.len);
+		}
+		return p;
+	}
+
+	void FlightRecorderLogAppender::dump(const char* reason, bool in_signal)
+	{
+		if (m_dumping.exchange(true, std::memory_order_acquire))
+		{
+			return;
+		}
+		int fd = ::open(m_filename.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+		if (fd < 0)
+		{
+			m_dumping.store(false, std::memory_order_release);
+			return;
+		}
+		char buf[LogStream::BUFFER_SIZE * 2 + 256];
+		char* end = buf + sizeof(buf) - 1;	//һֽڸ
+		char* p = AppendBytes(buf, end, "==== FlightRecorder dump: ", 26);
+		p = AppendBytes(p, end, reason, strlen(reason));
+		p = AppendBytes(p, end, " pid=", 5);
+		p = AppendUInt(p, end, getpid());
+		p = AppendBytes(p, end, " ====\n", 6);
+		WriteAll(fd, buf, p - buf);
+
+		FlightRecord rec;
+		uint32_t count = m_ringCount.load(std::memory_order_acquire);
+		for (uint32_t r = 0; r < count; ++r)
+		{
+			FlightRing* ring = m_rings[r].load(std::memory_order_acquire);
+			uint64_t head = ring->head.load(std::memory_order_acquire);
+			uint64_t begin = head > ring->capacity ? head - ring->capacity : 0;
+			for (uint64_t seq = begin; seq < head; ++seq)
+			{
+				FlightSlot& slot = ring->slots[seq % ring->capacity];
+				//б̸߳ǵļ¼ֱ
+				if (slot.seq.load(std::memory_order_acquire) != seq + 1)
+				{
+					continue;
+				}
+				memcpy(&rec, &slot.rec, sizeof(rec));
+				std::atomic_thread_fence(std::memory_order_acquire);
+				if (slot.seq.load(std::memory_order_relaxed) != seq + 1)
+				{
+					continue;
+				}
+
+				if (in_signal)
+				{
+					p = DumpRaw(buf, end, rec);
+				}
+				else
+				{
+					time_t sec = rec.time / 1000000;
+					struct tm tm;
+					localtime_r(&sec, &tm);
+					size_t len = strftime(buf, sizeof(buf), "%Y-%m-%d %H:%M:%S", &tm);
+					int n = snprintf(buf + len, sizeof(buf) - len, ".%06u\t%u\t%u\t[%s]\t[%s]\t%s:%d\t",
+						(uint32_t)(rec.time % 1000000), rec.threadid, rec.fiberid,
+						LogLevel::ToString((LogLevel::Level)rec.level), rec.name, rec.file, rec.line);
+					p = buf + len + std::min((size_t)n, sizeof(buf) - len - 1);
+					if (rec.spec)
+					{
+						p += rec.spec->render(p, end - p, rec.data, rec.len);
+					}
+					else
+					{
+						p = AppendBytes(p, end, rec.data, rec.len);
+					}
+				}
+				*p++ = '\n';
+				WriteAll(fd, buf, p - buf);
+			}
+		}
+		::close(fd);
+		m_dumping.store(false, std::memory_order_release);
+	}
+
+	std::string FlightRecorderLogAppender::toYamlString()
+	{
+		YAML::Node node;
+		node["type"] = "FlightRecorderLogAppender";
+		node["file"] = m_filename;
+		node["capacity"] = m_capacity;
+		node["level"] = LogLevel::ToString(m_level);
+		std::stringstream ss;
+		ss << node;
+		return ss.str();
+	}
+
+	void LogAppender::setFormatter(LogFormatter::ptr val)
+	{
+		m_formatter = val;
+	}
+
+	LogFormatter::ptr LogAppender::getFormatter() const
+	{
+		return m_formatter;
+	}
+
+	const char * LogLevel::ToString(LogLevel::Level level)
+	{
+		switch (level)
+		{
+#define XX(name) \
+		case LogLevel::name: \
+			return #name; \
+			break;
+
+			XX(DEBUG);
+			XX(INFO);
+			XX(WARN);
+			XX(ERROR);
+			XX(FATAL);
+#undef XX
+		default:
+			return "UNKNOW";
+		}
+		return "UNKNOW";
+	}
+
+	LogStreamBuf::LogStreamBuf()
+	{
+		setp(nullptr, nullptr);
+	}
+
+	void LogStreamBuf::reset(char* buf, size_t size)
+	{
+		setp(buf, buf + size);
+	}
+
+	LogStreamBuf::int_type LogStreamBuf::overflow(int_type ch)
+	{
+		//ַسɹbadbitȫʧ
+		return traits_type::not_eof(ch);
+	}
+
+	std::streamsize LogStreamBuf::xsputn(const char* s, std::streamsize n)
+	{
+		std::streamsize left = epptr() - pptr();
+		std::streamsize len = n < left ? n : left;
+		memcpy(pptr(), s, len);
+		pbump(len);
+		return n;
+	}
+
+	void LogStreamBuf::vprintf(const char* fmt, va_list al)
+	{
+		size_t left = epptr() - pptr();
+		if (left == 0)
+		{
+			return;
+		}
+		int len = vsnprintf(pptr(), left, fmt, al);
+		if (len > 0)
+		{
+			//vsnprintfдβ'\0'ʱֻܷµĲ
+			pbump((size_t)len < left ? len : left - 1);
+		}
+	}
+
+	//ÿ߳һݵLogStreamأλͼ¼ռһʹʱ䣬֮ڴ
+	struct LogStreamPool
+	{
+		enum { SIZE = 8 };
+		LogStreamPool()
+		{
+			for (int i = 0; i < SIZE; ++i)
+			{
+				streams[i].m_pool = this;
+				streams[i].m_index = i;
+			}
+		}
+		LogStream streams[SIZE];
+		uint32_t used = 0;
+	};
+
+	static thread_local std::unique_ptr<LogStreamPool> t_stream_pool;
+
+	LogStream::LogStream()
+		:std::ostream(nullptr)
+	{
+		rdbuf(&m_buf);
+	}
+
+	void LogStream::reset(size_t limit)
+	{
+		m_buf.reset(m_data, limit < (size_t)BUFFER_SIZE ? limit : (size_t)BUFFER_SIZE);
+		//һʹ߿ܸĹʽ־std::hex
+		clear();
+		flags(std::ios_base::dec | std::ios_base::skipws);
+		width(0);
+		precision(6);
+		fill(' ');
+	}
+
+	LogStream* LogStream::Acquire(size_t limit)
+	{
+		if (!t_stream_pool)
+		{
+			t_stream_pool.reset(new LogStreamPool);
+		}
+		LogStreamPool* pool = t_stream_pool.get();
+		LogStream* stream = nullptr;
+		if (pool->used != (1u << LogStreamPool::SIZE) - 1)
+		{
+			int idx = __builtin_ctz(~pool->used);
+			pool->used |= 1u << idx;
+			stream = &pool->streams[idx];
+		}
+		else
+		{
+			stream = new LogStream;
+		}
+		stream->reset(limit);
+		return stream;
+	}
+
+	void LogStream::Release(LogStream* stream)
+	{
+		if (stream->m_pool)
+		{
+			stream->m_pool->used &= ~(1u << stream->m_index);
+		}
+		else
+		{
+			delete stream;
+		}
+	}
+
+	static std::atomic<uint32_t> s_site_id(0);
+
+	//һת˵pָ'%'棬ɹʱתַλ
+	static const char* ParseConversion(const char* p, LogFmtSpec::Piece& piece)
+	{
+		const char* begin = p - 1;
+		while (*p && strchr("-+ #0'I", *p))
+		{
+			++p;
+		}
+		//
+		if (*p == '*')
+		{
+			++piece.stars;
+			++p;
+		}
+		else
+		{
+			while (*p >= '0' && *p <= '9')
+			{
+				++p;
+			}
+			if (*p == '$')
+			{
+				return nullptr; //λò
+			}
+		}
+		//
+		if (*p == '.')
+		{
+			++p;
+			if (*p == '*')
+			{
+				++piece.stars;
+				piece.star_precision = true;
+				++p;
+			}
+			else
+			{
+				piece.precision = 0;
+				while (*p >= '0' && *p <= '9')
+				{
+					piece.precision = piece.precision * 10 + (*p - '0');
+					++p;
+				}
+			}
+		}
+		//
+		int longs = 0;
+		bool long_double = false;
+		while (*p && strchr("hlLqjzt", *p))
+		{
+			if (*p == 'l' || *p == 'j' || *p == 'z' || *p == 't')
+			{
+				++longs;
+			}
+			else if (*p == 'q')
+			{
+				longs += 2;
+			}
+			else if (*p == 'L')
+			{
+				long_double = true;
+				longs += 2;
+			}
+			++p;
+		}
+		switch (*p)
+		{
+		case 'd': case 'i': case 'o': case 'u': case 'x': case 'X':
+			piece.type = longs >= 2 ? LogFmtSpec::ARG_LONGLONG : longs == 1 ? LogFmtSpec::ARG_LONG : LogFmtSpec::ARG_INT;
+			break;
+		case 'c':
+			if (longs)
+			{
+				return nullptr; //ַ
+			}
+			piece.type = LogFmtSpec::ARG_INT;
+			break;
+		case 'e': case 'E': case 'f': case 'F': case 'g': case 'G': case 'a': case 'A':
+			piece.type = long_double ? LogFmtSpec::ARG_LONGDOUBLE : LogFmtSpec::ARG_DOUBLE;
+			break;
+		case 's':
+			if (longs)
+			{
+				return nullptr; //ַ
+			}
+			piece.type = LogFmtSpec::ARG_STRING;
+			break;
+		case 'p':
+			piece.type = LogFmtSpec::ARG_POINTER;
+			break;
+		default:
+			return nullptr; //%n %m %C %SǷת
+		}
+		++p;
+		piece.spec.assign(begin, p - begin);
+		return p;
+	}
+
+	LogFmtSpec* LogFmtSpec::Compile(const char* fmt)
+	{
+		std::unique_ptr<LogFmtSpec> spec(new LogFmtSpec);
+		spec->m_format = fmt;
+		Piece piece;
+		const char* p = fmt;
+		while (*p)
+		{
+			if (*p != '%')
+			{
+				piece.literal.push_back(*p++);
+				continue;
+			}
+			++p;
+			if (*p == '%')
+			{
+				piece.literal.push_back(*p++);
+				continue;
+			}
+			p = ParseConversion(p, piece);
+			if (!p)
+			{
+				return nullptr;
+			}
+			spec->m_pieces.push_back(std::move(piece));
+			piece = Piece();
+		}
+		if (!piece.literal.empty())
+		{
+			spec->m_pieces.push_back(std::move(piece));
+		}
+		return spec.release();
+	}
+
+	template<class T>
+	static inline bool EncodeValue(char*& p, char* end, T v)
+	{
+		if ((size_t)(end - p) < sizeof(T))
+		{
+			return false;
+		}
+		memcpy(p, &v, sizeof(T));
+		p += sizeof(T);
+		return true;
+	}
+
+	size_t LogFmtSpec::encode(char* buf, size_t size, va_list al) const
+	{
+		char* p = buf;
+		char* end = buf + size;
+		bool ok = true;
+		for (auto& i : m_pieces)
+		{
+			int star = 0;
+			for (int s = 0; s < i.stars; ++s)
+			{
+				star = va_arg(al, int);
+				ok = ok && EncodeValue(p, end, star);
+			}
+			switch (i.type)
+			{
+			case ARG_NONE:
+				break;
+			case ARG_INT:
+				ok = ok && EncodeValue(p, end, va_arg(al, int));
+				break;
+			case ARG_LONG:
+				ok = ok && EncodeValue(p, end, va_arg(al, long));
+				break;
+			case ARG_LONGLONG:
+				ok = ok && EncodeValue(p, end, va_arg(al, long long));
+				break;
+			case ARG_DOUBLE:
+				ok = ok && EncodeValue(p, end, va_arg(al, double));
+				break;
+			case ARG_LONGDOUBLE:
+				ok = ok && EncodeValue(p, end, va_arg(al, long double));
+				break;
+			case ARG_POINTER:
+				ok = ok && EncodeValue(p, end, va_arg(al, void*));
+				break;
+			case ARG_STRING:
+			{
+				//u32 +  + '\0'ָ볤ȼΪ0xFFFFFFFF
+				const char* s = va_arg(al, const char*);
+				if (!s)
+				{
+					ok = ok && EncodeValue(p, end, (uint32_t)0xFFFFFFFF);
+					break;
+				}
+				//оʱַһ'\0'βֻȸֽڣ'*'ȵûд
+				int precision = i.star_precision ? star : i.precision;
+				size_t len = precision >= 0 ? strnlen(s, precision) : strlen(s);
+				if (!ok || (size_t)(end - p) < sizeof(uint32_t) + len + 1)
+				{
+					ok = false;
+					break;
+				}
+				EncodeValue(p, end, (uint32_t)len);
+				memcpy(p, s, len);
+				p[len] = '\0';
+				p += len + 1;
+				break;
+			}
+			}
+			if (!ok)
+			{
+				return (size_t)-1;
+			}
+		}
+		return p - buf;
+	}
+
+	template<class T>
+	static inline bool DecodeValue(const char*& p, const char* end, T& v)
+	{
+		if ((size_t)(end - p) < sizeof(T))
+		{
+			return false;
+		}
+		memcpy(&v, p, sizeof(T));
+		p += sizeof(T);
+		return true;
+	}
+
+	template<class T>
+	static inline int RenderValue(char* out, size_t size, const LogFmtSpec::Piece& piece, const int* stars, T v)
+	{
+		switch (piece.stars)
+		{
+		case 0:
+			return snprintf(out, size, piece.spec.c_str(), v);
+		case 1:
+			return snprintf(out, size, piece.spec.c_str(), stars[0], v);
+		default:
+			return snprintf(out, size, piece.spec.c_str(), stars[0], stars[1], v);
+		}
+	}
+
+	size_t LogFmtSpec::render(char* out, size_t size, const char* args, size_t len) const
+	{
+		char* p = out;
+		char* end = out + size;
+		const char* in = args;
+		const char* in_end = args + len;
+		for (auto& i : m_pieces)
+		{
+			p = AppendString(p, end, i.literal);
+			if (i.type == ARG_NONE)
+			{
+				continue;
+			}
+			int stars[2] = { 0, 0 };
+			for (int s = 0; s < i.stars; ++s)
+			{
+				if (!DecodeValue(in, in_end, stars[s]))
+				{
+					return p - out;
+				}
+			}
+			if (p == end)
+			{
+				break;
+			}
+			int n = -1;
+			switch (i.type)
+			{
+#define XX(type, ctype) \
+			case type: { \
+				ctype v; \
+				if (DecodeValue(in, in_end, v)) { \
+					n = RenderValue(p, end - p, i, stars, v); \
+				} \
+				break; \
+			}
+			XX(ARG_INT, int);
+			XX(ARG_LONG, long);
+			XX(ARG_LONGLONG, long long);
+			XX(ARG_DOUBLE, double);
+			XX(ARG_LONGDOUBLE, long double);
+			XX(ARG_POINTER, void*);
+#undef XX
+			case ARG_STRING:
+			{
+				uint32_t slen;
+				if (!DecodeValue(in, in_end, slen))
+				{
+					break;
+				}
+				if (slen == 0xFFFFFFFF)
+				{
+					n = RenderValue(p, end - p, i, stars, (const char*)nullptr);
+					break;
+				}
+				if ((size_t)(in_end - in) < (size_t)slen + 1 || in[slen] != '\0')
+				{
+					break;
+				}
+				n = RenderValue(p, end - p, i, stars, in);
+				in += slen + 1;
+				break;
+			}
+			default:
+				break;
+			}
+			if (n < 0)
+			{
+				return p - out;
+			}
+			//snprintfдβ'\0'ʱֻܷµĲ
+			p += (size_t)n < (size_t)(end - p) ? (size_t)n : (size_t)(end - p) - 1;
+		}
+		return p - out;
+	}
+
+	uint32_t LogCallSite::assignId() const
+	{
+		uint32_t id = ++s_site_id;
+		uint32_t expected = 0;
+		//ʱֻһ̷߳ɹ߳id
+		return m_id.compare_exchange_strong(expected, id, std::memory_order_relaxed) ? id : expected;
+	}
+
+	bool LogCallSite::updateEnabled(const Logger& logger, LogLevel::Level level)
+	{
+		//ʱддkeyȶkeyٶ𣬿keyһ¼
+		uint64_t key = logger.getSiteKey() | ((uint64_t)level & 7) << 1;
+		bool enabled = level >= logger.getLevel();
+		m_enabled.store(key | enabled, std::memory_order_relaxed);
+		return enabled;
+	}
+
+	const LogFmtSpec* LogCallSite::getSpec(const char* fmt)
+	{
+		if (!m_compiled.load(std::memory_order_acquire))
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			if (!m_compiled.load(std::memory_order_relaxed))
+			{
+				m_spec = LogFmtSpec::Compile(fmt);
+				m_compiled.store(true, std::memory_order_release);
+			}
+		}
+		return m_spec && m_spec->getFormat() == fmt ? m_spec : nullptr;
+	}
+
+	LogEvent::LogEvent(std::shared_ptr<Logger> logger, LogLevel::Level level, const char * file, int32_t line,
+		uint32_t elapse, uint32_t threadid, uint32_t fiberid, uint64_t time, uint32_t usec, LogCallSite* site)
+		:m_file(file),m_line(line),m_elapse(elapse),m_threadid(threadid),m_fiberid(fiberid),m_time(time),m_usec(usec)
+		,m_site(site),m_logger(logger),m_level(level)
+	{
+		m_ss = LogStream::Acquire(LogStream::CONTENT_SIZE);
+	}
+	LogEvent::~LogEvent()
+	{
+		if (m_args)
+		{
+			LogStream::Release(m_args);
+		}
+		if (m_fields)
+		{
+			LogStream::Release(m_fields);
+		}
+		LogStream::Release(m_ss);
+	}
+
+	void LogEvent::render() const
+	{
+		if (m_rendered)
+		{
+			return;
+		}
+		m_rendered = true;
+		size_t left;
+		char* p = m_ss->tail(left);
+		m_ss->commit(m_spec->render(p, left, m_args->data(), m_args->size()));
+	}
+
+	void LogEvent::setArgs(const LogFmtSpec* spec, const char* data, size_t len)
+	{
+		render();
+		if (m_args)
+		{
+			LogStream::Release(m_args);
+		}
+		m_args = LogStream::Acquire(LogStream::CONTENT_SIZE);
+		m_args->write(data, len);
+		m_spec = spec;
+		m_rendered = false;
+	}
+
+	void LogEvent::formatLazy(bool literal, const char* fmt, ...)
+	{
+		va_list al;
+		va_start(al, fmt);
+		//Ѿı(дǰ׺)ʱֱӸʽ֤appender
+		const LogFmtSpec* spec = literal && m_site && !m_args && !m_ss->size() ? m_site->getSpec(fmt) : nullptr;
+		if (spec)
+		{
+			LogStream* args = LogStream::Acquire(LogStream::CONTENT_SIZE);
+			size_t left;
+			char* p = args->tail(left);
+			va_list ap;
+			va_copy(ap, al);
+			size_t len = spec->encode(p, left, ap);
+			va_end(ap);
+			if (len != (size_t)-1)
+			{
+				args->commit(len);
+				m_args = args;
+				m_spec = spec;
+				m_rendered = false;
+				va_end(al);
+				return;
+			}
+			//̫Ų£ֱӸʽ
+			LogStream::Release(args);
+		}
+		format(fmt, al);
+		va_end(al);
+	}
+
+	void LogEvent::format(const char* fmt, ...)
+	{
+		va_list al;
+		va_start(al, fmt);
+		format(fmt, al);
+		va_end(al);
+	}
+
+	void LogEvent::format(const char* fmt, va_list al)
+	{
+		render();
+		m_ss->vprintf(fmt, al);
+	}
+
+	static inline char* AppendFill(char* p, char* end, char c, size_t n)
+	{
+		size_t left = end - p;
+		if (n > left)
+		{
+			n = left;
+		}
+		memset(p, c, n);
+		return p + n;
+	}
+
+	//ȺͶд[s, s + len)ĬҶ롢ַĬ룬ָ0ʱڷ֮0
+	static char* AppendPadded(char* p, char* end, const char* s, size_t len, const LogBrace::Spec& spec, bool numeric)
+	{
+		size_t width = spec.width > 0 ? spec.width : 0;
+		if (len >= width)
+		{
+			return AppendBytes(p, end, s, len);
+		}
+		size_t pad = width - len;
+		if (numeric && spec.zero && !spec.align)
+		{
+			if (*s == '-')
+			{
+				p = AppendBytes(p, end, s++, 1);
+				--len;
+			}
+			p = AppendFill(p, end, '0', pad);
+			return AppendBytes(p, end, s, len);
+		}
+		bool left = spec.align ? spec.align == '<' : !numeric;
+		if (!left)
+		{
+			p = AppendFill(p, end, ' ', pad);
+		}
+		p = AppendBytes(p, end, s, len);
+		if (left)
+		{
+			p = AppendFill(p, end, ' ', pad);
+		}
+		return p;
+	}
+
+	//endǰдvbaseƱʾʼλ
+	static char* FormatRadix(char* end, uint64_t v, unsigned base, bool upper)
+	{
+		const char* digits = upper ? "0123456789ABCDEF" : "0123456789abcdef";
+		char* q = end;
+		do
+		{
+			*--q = digits[v % base];
+			v /= base;
+		} while (v);
+		return q;
+	}
+
+	static char* AppendBraceInt(char* p, char* end, const LogBrace::Spec& spec, bool negative, uint64_t v)
+	{
+		char tmp[72];
+		char* tmp_end = tmp + sizeof(tmp);
+		char* q = nullptr;
+		switch (spec.type)
+		{
+		case 'c':
+		{
+			char c = (char)(negative ? 0 - v : v);
+			return AppendPadded(p, end, &c, 1, spec, false);
+		}
+		case 'x':
+			q = FormatRadix(tmp_end, v, 16, false);
+			break;
+		case 'X':
+			q = FormatRadix(tmp_end, v, 16, true);
+			break;
+		case 'o':
+			q = FormatRadix(tmp_end, v, 8, false);
+			break;
+		case 'b':
+			q = FormatRadix(tmp_end, v, 2, false);
+			break;
+		default:
+		{
+			q = tmp;
+			if (negative)
+			{
+				*q++ = '-';
+			}
+			q = AppendUInt(q, tmp_end, v);
+			return AppendPadded(p, end, tmp, q - tmp, spec, true);
+		}
+		}
+		if (negative)
+		{
+			*--q = '-';
+		}
+		return AppendPadded(p, end, q, tmp_end - q, spec, true);
+	}
+
+	static char* AppendBraceFloat(char* p, char* end, const LogBrace::Spec& spec, double v)
+	{
+		char tmp[512];
+		size_t len = 0;
+		int precision = spec.precision < 0 ? 6 : spec.precision;
+#if __cplusplus >= 201703L && defined(__cpp_lib_to_chars)
+		std::to_chars_result r;
+		if (!spec.type && spec.precision < 0)
+		{
+			r = std::to_chars(tmp, tmp + sizeof(tmp), v);
+		}
+		else
+		{
+			std::chars_format f = spec.type == 'f' ? std::chars_format::fixed
+				: spec.type == 'e' ? std::chars_format::scientific : std::chars_format::general;
+			r = std::to_chars(tmp, tmp + sizeof(tmp), v, f, precision);
+		}
+		if (r.ec == std::errc())
+		{
+			len = r.ptr - tmp;
+		}
+		else
+#endif
+		{
+			//ûto_chars߾̫ŲʱsnprintfĲֽض
+			int n = !spec.type && spec.precision < 0 ? snprintf(tmp, sizeof(tmp), "%.17g", v)
+				: snprintf(tmp, sizeof(tmp), spec.type == 'f' ? "%.*f" : spec.type == 'e' ? "%.*e" : "%.*g", precision, v);
+			len = n < 0 ? 0 : std::min((size_t)n, sizeof(tmp) - 1);
+		}
+		return AppendPadded(p, end, tmp, len, spec, true);
+	}
+
+	static char* AppendBraceArg(char* p, char* end, const LogBrace::Spec& spec, const LogBraceArg& arg)
+	{
+		switch (arg.kind)
+		{
+		case LogBrace::KIND_INT:
+			return AppendBraceInt(p, end, spec, arg.i < 0, arg.i < 0 ? 0 - (uint64_t)arg.i : arg.i);
+		case LogBrace::KIND_UINT:
+			return AppendBraceInt(p, end, spec, false, arg.u);
+		case LogBrace::KIND_FLOAT:
+			return AppendBraceFloat(p, end, spec, arg.d);
+		case LogBrace::KIND_STRING:
+		{
+			size_t len = arg.s.size;
+			if (spec.precision >= 0 && (size_t)spec.precision < len)
+			{
+				len = spec.precision;
+			}
+			return AppendPadded(p, end, arg.s.data, len, spec, false);
+		}
+		case LogBrace::KIND_CHAR:
+			if (spec.type && spec.type != 'c')
+			{
+				return AppendBraceInt(p, end, spec, arg.i < 0, arg.i < 0 ? 0 - (uint64_t)arg.i : arg.i);
+			}
+			else
+			{
+				char c = (char)arg.i;
+				return AppendPadded(p, end, &c, 1, spec, false);
+			}
+		case LogBrace::KIND_BOOL:
+			if (spec.type == 'd')
+			{
+				return AppendBraceInt(p, end, spec, false, arg.u);
+			}
+			return AppendPadded(p, end, arg.u ? "true" : "false", arg.u ? 4 : 5, spec, false);
+		case LogBrace::KIND_POINTER:
+		{
+			char tmp[24];
+			char* q = FormatRadix(tmp + sizeof(tmp), (uintptr_t)arg.p, 16, false);
+			*--q = 'x';
+			*--q = '0';
+			return AppendPadded(p, end, q, tmp + sizeof(tmp) - q, spec, true);
+		}
+		default:
+			return p;
+		}
+	}
+
+	void LogEvent::print(const char* fmt, const LogBraceArg* args, size_t count)
+	{
+		render();
+		LogStream& os = *m_ss;
+		size_t left;
+		char* begin = os.tail(left);
+		char* p = begin;
+		char* end = begin + left;
+		size_t next = 0;
+		const char* literal = fmt;
+		for (const char* f = fmt; *f; ++f)
+		{
+			if (*f != '{' && *f != '}')
+			{
+				continue;
+			}
+			p = AppendBytes(p, end, literal, f - literal);
+			literal = f + 1;
+			if (f[1] == f[0])
+			{
+				//{{ }}
+				p = AppendBytes(p, end, f++, 1);
+				literal = f + 1;
+				continue;
+			}
+			LogBrace::Spec spec;
+			const char* close = *f == '{' ? LogBrace::ParseSpec(f + 1, spec) : nullptr;
+			if (!close || next >= count || !LogBrace::Accepts(args[next].kind, spec))
+			{
+				//ûоڼĴʽԭ
+				p = AppendBytes(p, end, f, 1);
+				continue;
+			}
+			const LogBraceArg& arg = args[next++];
+			if (arg.kind == LogBrace::KIND_OTHER)
+			{
+				os.commit(p - begin);
+				arg.o.write(os, arg.o.obj);
+				begin = os.tail(left);
+				p = begin;
+				end = begin + left;
+			}
+			else
+			{
+				p = AppendBraceArg(p, end, spec, arg);
+			}
+			f = close - 1;
+			literal = close;
+		}
+		p = AppendBytes(p, end, literal, strlen(literal));
+		os.commit(p - begin);
+	}
+
+	LogEvent& LogEvent::field(const char* key, size_t len, const LogBraceArg& value)
+	{
+		if (!m_fields)
+		{
+			m_fields = LogStream::Acquire(LogStream::CONTENT_SIZE);
+		}
+		LogBraceArg arg = value;
+		LogStream* other = nullptr;
+		if (arg.kind == LogBrace::KIND_OTHER)
+		{
+			other = LogStream::Acquire(LogStream::CONTENT_SIZE);
+			arg.o.write(*other, arg.o.obj);
+			arg.kind = LogBrace::KIND_STRING;
+			arg.s.data = other->data();
+			arg.s.size = other->size();
+		}
+		if (len > 255)
+		{
+			len = 255;
+		}
+		size_t value_size = arg.kind == LogBrace::KIND_STRING ? 4 + arg.s.size : 8;
+		size_t left;
+		char* p = m_fields->tail(left);
+		if (2 + len + value_size <= left)
+		{
+			p[0] = (char)arg.kind;
+			p[1] = (char)len;
+			memcpy(p + 2, key, len);
+			p += 2 + len;
+			if (arg.kind == LogBrace::KIND_STRING)
+			{
+				uint32_t n = arg.s.size;
+				memcpy(p, &n, 4);
+				memcpy(p + 4, arg.s.data, n);
+			}
+			else
+			{
+				memcpy(p, &arg.u, 8);
+			}
+			m_fields->commit(2 + len + value_size);
+		}
+		if (other)
+		{
+			LogStream::Release(other);
+		}
+		return *this;
+	}
+
+	static inline bool IsJsonSpecial(unsigned char c)
+	{
+		return c < 0x20 || c == '"' || c == '\\';
+	}
+
+	//logfmtֵЩֽʱҪţЩֽ滻'_'
+	static inline bool IsLogfmtSpecial(unsigned char c)
+	{
+		return c <= ' ' || c == '"' || c == '\\' || c == '=';
+	}
+
+#if CCH_LOG_SIMD >= 2
+	//ֽڶӦλΪ0xff޷ŵ v <= low  max(v, low) == low ж
+	template<bool LOGFMT>
+	static inline __m256i SpecialMask(__m256i v)
+	{
+		const __m256i low = _mm256_set1_epi8(LOGFMT ? ' ' : 0x1f);
+		__m256i m = _mm256_or_si256(_mm256_cmpeq_epi8(_mm256_max_epu8(v, low), low),
+			_mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('"')), _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\\'))));
+		return LOGFMT ? _mm256_or_si256(m, _mm256_cmpeq_epi8(v, _mm256_set1_epi8('='))) : m;
+	}
+#endif
+#if CCH_LOG_SIMD >= 1
+	template<bool LOGFMT>
+	static inline __m128i SpecialMask(__m128i v)
+	{
+		const __m128i low = _mm_set1_epi8(LOGFMT ? ' ' : 0x1f);
+		__m128i m = _mm_or_si128(_mm_cmpeq_epi8(_mm_max_epu8(v, low), low),
+			_mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('"')), _mm_cmpeq_epi8(v, _mm_set1_epi8('\\'))));
+		return LOGFMT ? _mm_or_si128(m, _mm_cmpeq_epi8(v, _mm_set1_epi8('='))) : m;
+	}
+#endif
+
+	//[s, s + len)еһֽڵ±꣬ûʱlenϢĿ
+	//ÿ64ֽںϲһжϣֽʱٰ16/32ֽڶλ
+	template<bool LOGFMT>
+	static inline size_t FindSpecial(const char* s, size_t len)
+	{
+		size_t i = 0;
+#if CCH_LOG_SIMD >= 2
+		for (; i + 64 <= len; i += 64)
+		{
+			__m256i m = _mm256_or_si256(SpecialMask<LOGFMT>(_mm256_loadu_si256((const __m256i*)(s + i))),
+				SpecialMask<LOGFMT>(_mm256_loadu_si256((const __m256i*)(s + i + 32))));
+			if (!_mm256_testz_si256(m, m))
+			{
+				break;
+			}
+		}
+		for (; i + 32 <= len; i += 32)
+		{
+			uint32_t bits = (uint32_t)_mm256_movemask_epi8(SpecialMask<LOGFMT>(_mm256_loadu_si256((const __m256i*)(s + i))));
+			if (bits)
+			{
+				return i + __builtin_ctz(bits);
+			}
+		}
+#elif CCH_LOG_SIMD >= 1
+		for (; i + 64 <= len; i += 64)
+		{
+			__m128i m = _mm_or_si128(
+				_mm_or_si128(SpecialMask<LOGFMT>(_mm_loadu_si128((const __m128i*)(s + i))),
+					SpecialMask<LOGFMT>(_mm_loadu_si128((const __m128i*)(s + i + 16)))),
+				_mm_or_si128(SpecialMask<LOGFMT>(_mm_loadu_si128((const __m128i*)(s + i + 32))),
+					SpecialMask<LOGFMT>(_mm_loadu_si128((const __m128i*)(s + i + 48)))));
+			if (_mm_movemask_epi8(m))
+			{
+				break;
+			}
+		}
+#endif
+#if CCH_LOG_SIMD >= 1
+		for (; i + 16 <= len; i += 16)
+		{
+			uint32_t bits = (uint32_t)_mm_movemask_epi8(SpecialMask<LOGFMT>(_mm_loadu_si128((const __m128i*)(s + i))));
+			if (bits)
+			{
+				return i + __builtin_ctz(bits);
+			}
+		}
+#endif
+		for (; i < len; ++i)
+		{
+			if (LOGFMT ? IsLogfmtSpecial(s[i]) : IsJsonSpecial(s[i]))
+			{
+				return i;
+			}
+		}
+		return len;
+	}
+
+	//ضϵsǰnֽʱضUTF-8ַֽм(3ֽ)
+	static inline size_t Utf8Floor(const char* s, size_t n)
+	{
+		size_t i = n;
+		while (i > 0 && n - i < 3 && ((unsigned char)s[i] & 0xC0) == 0x80)
+		{
+			--i;
+		}
+		return ((unsigned char)s[i] & 0xC0) == 0xC0 ? i : n;
+	}
+
+	//json/logfmtλáŲʱfull֮д붼ԣ÷ֵԻعûаֶ
+	struct StructuredOut
+	{
+		char* p;
+		char* end;
+		bool full;
+
+		void put(const char* s, size_t len)
+		{
+			if (full || len > (size_t)(end - p))
+			{
+				full = true;
+				return;
+			}
+			memcpy(p, s, len);
+			p += len;
+		}
+		void put(char c) { put(&c, 1); }
+		//ŲʱдܷµĲ
+		void putTruncated(const char* s, size_t len)
+		{
+			size_t left = end - p;
+			if (len > left)
+			{
+				len = Utf8Floor(s, left);
+				full = true;
+			}
+			memcpy(p, s, len);
+			p += len;
+		}
+	};
+
+	//JSONַĹת()ASCIIֽԭlogfmtĴֵҲ
+	//truncateΪtrueʱŲµĲֽضϣضתм
+	static void PutEscaped(StructuredOut& out, const char* s, size_t len, bool truncate)
+	{
+		static const char s_hex[] = "0123456789abcdef";
+		const char* end = s + len;
+		while (s < end && !out.full)
+		{
+			size_t n = FindSpecial<false>(s, end - s);
+			if (truncate)
+			{
+				out.putTruncated(s, n);
+			}
+			else
+			{
+				out.put(s, n);
+			}
+			s += n;
+			if (s == end)
+			{
+				break;
+			}
+			unsigned char c = *s++;
+			char esc[6] = { '\\', (char)c, '0', '0', s_hex[c >> 4], s_hex[c & 15] };
+			size_t esc_len = 2;
+			switch (c)
+			{
+			case '"':
+			case '\\':
+				break;
+			case '\n':
+				esc[1] = 'n';
+				break;
+			case '\r':
+				esc[1] = 'r';
+				break;
+			case '\t':
+				esc[1] = 't';
+				break;
+			case '\b':
+				esc[1] = 'b';
+				break;
+			case '\f':
+				esc[1] = 'f';
+				break;
+			default:
+				esc[1] = 'u';
+				esc_len = 6;
+				break;
+			}
+			out.put(esc, esc_len);
+		}
+	}
+
+	//ֶεļjsonΪ ,"key": logfmtΪ ոkey=
+	static void PutKey(StructuredOut& out, bool json, const char* key, size_t len)
+	{
+		out.put(json ? ',' : ' ');
+		if (json)
+		{
+			out.put('"');
+			PutEscaped(out, key, len, false);
+			out.put("\":", 2);
+			return;
+		}
+		if (len == 0)
+		{
+			out.put('_');
+		}
+		for (size_t i = 0; i < len; ++i)
+		{
+			out.put(IsLogfmtSpecial(key[i]) ? '_' : key[i]);
+		}
+		out.put('=');
+	}
+
+	//ֵַlogfmtֽڵķǿֵ
+	//truncateΪtrueʱŲµĲֽضϣȻպϣǷضϹŶŲʱfull
+	static bool PutStringValue(StructuredOut& out, bool json, const char* s, size_t len, bool truncate)
+	{
+		if (!json && len && FindSpecial<true>(s, len) == len)
+		{
+			if (!truncate)
+			{
+				out.put(s, len);
+				return false;
+			}
+			out.putTruncated(s, len);
+			bool cut = out.full;
+			out.full = false;
+			return cut;
+		}
+		out.put('"');
+		if (!truncate || out.full || out.p == out.end)
+		{
+			PutEscaped(out, s, len, false);
+			out.put('"');
+			return false;
+		}
+		//һֽ
+		--out.end;
+		PutEscaped(out, s, len, true);
+		++out.end;
+		bool cut = out.full;
+		out.full = false;
+		out.put('"');
+		return cut;
+	}
+
+	static void PutArgValue(StructuredOut& out, bool json, const LogBraceArg& arg)
+	{
+		char tmp[512];
+		char* q = tmp;
+		switch (arg.kind)
+		{
+		case LogBrace::KIND_INT:
+			q = AppendInt(tmp, tmp + sizeof(tmp), arg.i);
+			break;
+		case LogBrace::KIND_UINT:
+			q = AppendUInt(tmp, tmp + sizeof(tmp), arg.u);
+			break;
+		case LogBrace::KIND_FLOAT:
+			if (!std::isfinite(arg.d))
+			{
+				//JSONûnan/infַ
+				const char* s = std::isnan(arg.d) ? "nan" : arg.d < 0 ? "-inf" : "inf";
+				PutStringValue(out, json, s, strlen(s), false);
+				return;
+			}
+			q = AppendBraceFloat(tmp, tmp + sizeof(tmp), LogBrace::Spec(), arg.d);
+			break;
+		case LogBrace::KIND_BOOL:
+			out.put(arg.u ? "true" : "false", arg.u ? 4 : 5);
+			return;
+		case LogBrace::KIND_CHAR:
+		{
+			char c = (char)arg.i;
+			PutStringValue(out, json, &c, 1, false);
+			return;
+		}
+		case LogBrace::KIND_POINTER:
+			q = AppendBraceArg(tmp, tmp + sizeof(tmp), LogBrace::Spec(), arg);
+			PutStringValue(out, json, tmp, q - tmp, false);
+			return;
+		case LogBrace::KIND_STRING:
+			PutStringValue(out, json, arg.s.data, arg.s.size, false);
+			return;
+		default:
+			out.put("null", 4);
+			return;
+		}
+		out.put(tmp, q - tmp);
+	}
+
+	//̶ֶεļͬǰķָ
+	struct StructuredKey
+	{
+		const char* str;
+		size_t len;
+	};
+#define XX(json, logfmt) { { json, sizeof(json) - 1 }, { logfmt, sizeof(logfmt) - 1 } }
+	static const StructuredKey s_structured_keys[][2] = {
+		XX("\"time\":\"", "time="),
+		XX("\",\"level\":\"", " level="),
+		XX(",\"logger\":", " logger="),
+		XX(",\"thread\":", " thread="),
+		XX(",\"fiber\":", " fiber="),
+		XX(",\"file\":", " file="),
+		XX(",\"line\":", " line="),
+		XX(",\"msg\":", " msg=")
+	};
+#undef XX
+
+	size_t LogFormatter::formatStructured(char* buf, size_t size, LogLevel::Level level, LogEvent::ptr event)
+	{
+		bool json = m_mode == MODE_JSON;
+		//β"}\n""\n"ԤضʱҲһ
+		size_t tail = json ? 2 : 1;
+		if (size <= tail)
+		{
+			return 0;
+		}
+		StructuredOut out = { buf, buf + size - tail, false };
+		if (json)
+		{
+			out.put('{');
+		}
+		char* mark = out.p;
+		auto commit = [&]() {
+			if (out.full)
+			{
+				out.p = mark;
+				return false;
+			}
+			mark = out.p;
+			return true;
+		};
+		//ʱͼ𲻺ֽڣjsonѾڼ
+		char tmp[128];
+		size_t idx = json ? 0 : 1;
+		const StructuredKey* key = s_structured_keys[0] + idx;
+		out.put(key->str, key->len);
+		out.put(tmp, AppendDate(tmp, tmp + sizeof(tmp), m_dateFormats[0], event->getTime(), event->getUsec()) - tmp);
+		const char* level_str = LogLevel::ToString(level);
+		key = s_structured_keys[1] + idx;
+		out.put(key->str, key->len);
+		out.put(level_str, strlen(level_str));
+		if (json)
+		{
+			out.put('"');
+		}
+		bool ok = commit();
+		if (ok)
+		{
+			const std::string& name = event->getLogger()->getName();
+			key = s_structured_keys[2] + idx;
+			out.put(key->str, key->len);
+			PutStringValue(out, json, name.data(), name.size(), false);
+			key = s_structured_keys[3] + idx;
+			out.put(key->str, key->len);
+			out.put(tmp, AppendUInt(tmp, tmp + sizeof(tmp), event->getThreadId()) - tmp);
+			key = s_structured_keys[4] + idx;
+			out.put(key->str, key->len);
+			out.put(tmp, AppendUInt(tmp, tmp + sizeof(tmp), event->getFiberId()) - tmp);
+			const char* file = event->getFile();
+			key = s_structured_keys[5] + idx;
+			out.put(key->str, key->len);
+			PutStringValue(out, json, file, strlen(file), false);
+			key = s_structured_keys[6] + idx;
+			out.put(key->str, key->len);
+			out.put(tmp, AppendInt(tmp, tmp + sizeof(tmp), event->getLine()) - tmp);
+			ok = commit();
+		}
+		if (ok)
+		{
+			//ϢŲʱضϣֶβ
+			key = s_structured_keys[7] + idx;
+			out.put(key->str, key->len);
+			bool cut = !out.full && PutStringValue(out, json, event->getContentData(), event->getContentSize(), true);
+			ok = commit() && !cut;
+		}
+		const char* f = event->getFieldsData();
+		const char* f_end = f + event->getFieldsSize();
+		while (ok && f < f_end)
+		{
+			LogBraceArg arg;
+			arg.kind = (LogBrace::Kind)(uint8_t)f[0];
+			size_t key_len = (uint8_t)f[1];
+			const char* field_key = f + 2;
+			f += 2 + key_len;
+			if (arg.kind == LogBrace::KIND_STRING)
+			{
+				uint32_t n;
+				memcpy(&n, f, 4);
+				arg.s.data = f + 4;
+				arg.s.size = n;
+				f += 4 + n;
+			}
+			else
+			{
+				memcpy(&arg.u, f, 8);
+				f += 8;
+			}
+			PutKey(out, json, field_key, key_len);
+			PutArgValue(out, json, arg);
+			ok = commit();
+		}
+		//ԤĿռ
+		out.end += tail;
+		out.full = false;
+		if (json)
+		{
+			out.put('}');
+		}
+		out.put('\n');
+		return out.p - buf;
+	}
+
+	LogLevel::Level LogLevel::FromString(const std::string& str)
+	{
+#define XX(level, v) \
 		if (str == #v) { \
 			return LogLevel::level; \
 		}
@@ -557,18 +4197,55 @@ namespace cch
 #undef XX
 	}
 
-	LogEventWrap::LogEventWrap(LogEvent::ptr e):m_event(e)
+	LogEventWrap::LogEventWrap(std::shared_ptr<Logger> logger, LogLevel::Level level, const char* file, int32_t line,
+		uint32_t elapse, uint32_t threadid, uint32_t fiberid, uint64_t time_us, LogCallSite* site)
+		:m_event(logger, level, file, line, elapse, threadid, fiberid, time_us / 1000000, time_us % 1000000, site)
 	{
 	}
 
 	LogEventWrap::~LogEventWrap()
 	{
-		m_event->getLogger()->log(m_event->getLevel(), m_event);
+		m_event.getLogger()->log(m_event.getLevel(), getEvent());
+	}
+
+	LogEventWrap& LogEventWrap::limit(const LogLimitResult& r)
+	{
+		if (r.suppressed)
+		{
+			m_event.getSS() << "[suppressed " << r.suppressed << "] ";
+		}
+		return *this;
+	}
+
+	LogLimitResult LogLimiter::perSecond(uint32_t n)
+	{
+		uint32_t now = (uint32_t)(GetCurrentUS() / 1000000);
+		uint64_t old = m_state.fetch_add(1, std::memory_order_relaxed);
+		//ھһ(̶߳µʱȿ˴)·ֻһfetch_add
+		if ((uint32_t)(old >> 32) >= now)
+		{
+			return LogLimitResult{ (uint32_t)old < n, 0 };
+		}
+		//ڸ룬ɴʣµĴãһ´ڡ
+		//ֻڽµһļε﷢ÿʧܶ˵̸߳״̬
+		uint64_t expect = old + 1;
+		uint64_t fresh = ((uint64_t)now << 32) | 1;
+		while ((uint32_t)(expect >> 32) < now)
+		{
+			if (m_state.compare_exchange_weak(expect, fresh, std::memory_order_relaxed))
+			{
+				//ɹ߳һڱƵexpectĴԼһ
+				uint32_t calls = (uint32_t)expect - 1;
+				return LogLimitResult{ n > 0, calls > n ? calls - n : 0 };
+			}
+		}
+		//߳Ѿ˴ڣεھɴɻڵ̱߳
+		return LogLimitResult{ false, 0 };
 	}
 
-	std::stringstream & LogEventWrap::getSS()
+	std::ostream & LogEventWrap::getSS()
 	{
-		return m_event->getSS();
+		return m_event.getSS();
 		// TODO: ڴ˴ return 
 	}
 
@@ -582,6 +4259,12 @@ namespace cch
 		init();
 	}
 	Logger::ptr LoggerManager::getLogger(const std::string& name)
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		return create(name);
+	}
+
+	Logger::ptr LoggerManager::create(const std::string& name)
 	{
 		auto it = m_logger.find(name);
 		if (it != m_logger.end())
@@ -589,23 +4272,58 @@ namespace cch
 			return it->second;
 		}
 
+		size_t pos = name.rfind('.');
+		Logger::ptr parent = pos == std::string::npos || pos == 0 ? m_root : create(name.substr(0, pos));
+		//־ļappender̳ϼûб߳̿Ҫ
 		Logger::ptr logger(new Logger(name));
-		logger->m_root = m_root;
+		logger->m_parent = parent;
+		Logger::State* state = logger->copyState();
+		state->ownLevel = LogLevel::UNKNOW;
+		logger->publish(state);
+		{
+			std::lock_guard<std::mutex> lock(parent->m_mutex);
+			parent->m_children.push_back(logger.get());
+		}
+		//ȥ֮ǰϼַ¿գºϲһ
+		{
+			std::lock_guard<std::mutex> lock(logger->m_mutex);
+			logger->publish(logger->copyState());
+		}
 		m_logger[name] = logger;
 		return logger;
-		//return it == m_logger.end() ? m_root : it->second;
 	}
 
 	struct LogAppenderDefine
 	{
-		int type = 0;//1 File, 2 Stdout;
+		int type = 0;//1 File, 2 Stdout, 3 Binary, 4 Mmap, 5 FlightRecorder;
 		LogLevel::Level level = LogLevel::UNKNOW;
 		std::string formatter;
 		std::string file;
+		bool async = false;	//File/Binary/StdoutLogAppenderǷʹ첽˫
+		size_t buffer_size = 1024 * 1024;	//첽ģʽֽ
+		uint32_t flush_interval = 1000;	//첽ģʽˢ̼()
+		int overflow = FileLogAppender::BLOCK;	//첽ģʽʱĲ
+		FileLogAppender::RollPolicy roll;	//ļ
+		size_t segment_size = MmapLogAppender::DEFAULT_SEGMENT_SIZE;	//MmapLogAppenderεֽ
+		uint32_t capacity = FlightRecorderLogAppender::DEFAULT_CAPACITY;	//FlightRecorderLogAppenderÿ̱߳
+		int compress = FileLogAppender::COMPRESS_NONE;	//File/BinaryLogAppenderѹʽʱǿ첽
+		int compress_level = -1;
+		uint32_t index_records = 0;	//FileLogAppenderʱÿһ
+		uint32_t index_interval = 0;	//FileLogAppenderʱÿٺһ
+		int sync = FileLogAppender::SYNC_NONE;	//File/Binary/StdoutLogAppenderfdatasync
+		uint32_t sync_interval = 1000;	//SYNC_INTERVALͬ()
 
 		bool operator==(const LogAppenderDefine& oth) const
 		{
-			return type == oth.type && level == oth.level && formatter == oth.formatter && file == oth.file;
+			return type == oth.type && level == oth.level && formatter == oth.formatter && file == oth.file
+				&& async == oth.async && buffer_size == oth.buffer_size
+				&& flush_interval == oth.flush_interval && overflow == oth.overflow
+				&& roll.max_size == oth.roll.max_size && roll.interval == oth.roll.interval
+				&& roll.max_files == oth.roll.max_files && roll.preallocate == oth.roll.preallocate
+				&& segment_size == oth.segment_size && capacity == oth.capacity
+				&& compress == oth.compress && compress_level == oth.compress_level
+				&& index_records == oth.index_records && index_interval == oth.index_interval
+				&& sync == oth.sync && sync_interval == oth.sync_interval;
 		}
 	};
 
@@ -626,14 +4344,47 @@ namespace cch
 		}
 	};
 
+	//첽дͬԣFile/Binary/StdoutLogAppender
+	static void ParseBatchDefine(const YAML::Node& a, LogAppenderDefine& lad)
+	{
+		if (a["async"].IsDefined())
+		{
+			lad.async = a["async"].as<bool>();
+		}
+		if (a["buffer_size"].IsDefined())
+		{
+			lad.buffer_size = a["buffer_size"].as<size_t>();
+		}
+		if (a["flush_interval"].IsDefined())
+		{
+			lad.flush_interval = a["flush_interval"].as<uint32_t>();
+		}
+		if (a["overflow"].IsDefined())
+		{
+			lad.overflow = FileLogAppender::OverflowFromString(a["overflow"].as<std::string>());
+		}
+		if (a["sync"].IsDefined())
+		{
+			lad.sync = FileLogAppender::SyncPolicyFromString(a["sync"].as<std::string>());
+		}
+		if (a["sync_interval"].IsDefined())
+		{
+			lad.sync_interval = a["sync_interval"].as<uint32_t>();
+		}
+	}
+
 	//ƫػ 
 	template<>
 	class LexicalCast<std::string, std::set<LogDefine>>
 	{
 	public:
+		typedef void node_cast;
 		std::set<LogDefine> operator() (const std::string& v)
 		{
-			YAML::Node node = YAML::Load(v);
+			return fromNode(YAML::Load(v));
+		}
+		std::set<LogDefine> fromNode(const YAML::Node& node)
+		{
 			typename std::set<LogDefine> vec;
 			for (size_t i = 0; i < node.size(); i++)
 			{
@@ -662,9 +4413,13 @@ namespace cch
 						}
 						std::string type = a["type"].as<std::string>();
 						LogAppenderDefine lad;
-						if (type == "FileLogAppender")
+						if (a["level"].IsDefined())
+						{
+							lad.level = LogLevel::FromString(a["level"].as<std::string>());
+						}
+						if (type == "FileLogAppender" || type == "BinaryLogAppender")
 						{
-							lad.type = 1;
+							lad.type = type == "FileLogAppender" ? 1 : 3;
 							if (!a["file"].IsDefined())
 							{
 								std::cout << "log config error: fileappender is null " << a << std::endl;
@@ -675,10 +4430,89 @@ namespace cch
 							{
 								lad.formatter = a["formatter"].as<std::string>();
 							}
+							ParseBatchDefine(a, lad);
+							if (a["max_size"].IsDefined())
+							{
+								lad.roll.max_size = a["max_size"].as<uint64_t>();
+							}
+							if (a["roll_interval"].IsDefined())
+							{
+								lad.roll.interval = FileLogAppender::RollIntervalFromString(a["roll_interval"].as<std::string>());
+							}
+							if (a["max_files"].IsDefined())
+							{
+								lad.roll.max_files = a["max_files"].as<uint32_t>();
+							}
+							if (a["preallocate"].IsDefined())
+							{
+								lad.roll.preallocate = a["preallocate"].as<bool>();
+							}
+							if (a["compress"].IsDefined())
+							{
+								std::string compress = a["compress"].as<std::string>();
+								lad.compress = FileLogAppender::CompressionFromString(compress);
+								if (lad.compress == FileLogAppender::COMPRESS_NONE && compress != "none" && compress != "NONE")
+								{
+									std::cout << "log config error: unknown compress " << compress
+										<< ", only gzip is supported" << std::endl;
+								}
+								//ѹѹʣѹʱ첽ģʽ
+								if (lad.compress != FileLogAppender::COMPRESS_NONE && !lad.async && a["async"].IsDefined())
+								{
+									std::cout << "log config error: compress " << compress << " needs async mode, "
+										<< "async: false ignored for " << lad.file << std::endl;
+								}
+								lad.async = lad.compress != FileLogAppender::COMPRESS_NONE || lad.async;
+							}
+							if (a["compress_level"].IsDefined())
+							{
+								lad.compress_level = a["compress_level"].as<int>();
+							}
+							if (lad.type == 1 && a["index_records"].IsDefined())
+							{
+								lad.index_records = a["index_records"].as<uint32_t>();
+							}
+							if (lad.type == 1 && a["index_interval"].IsDefined())
+							{
+								lad.index_interval = a["index_interval"].as<uint32_t>();
+							}
 						}
 						else if(type == "StdoutLogAppender")
 						{
 							lad.type = 2;
+							ParseBatchDefine(a, lad);
+						}
+						else if (type == "FlightRecorderLogAppender")
+						{
+							lad.type = 5;
+							if (!a["file"].IsDefined())
+							{
+								std::cout << "log config error: flightrecorder file is null " << a << std::endl;
+								continue;
+							}
+							lad.file = a["file"].as<std::string>();
+							if (a["capacity"].IsDefined())
+							{
+								lad.capacity = a["capacity"].as<uint32_t>();
+							}
+						}
+						else if (type == "MmapLogAppender")
+						{
+							lad.type = 4;
+							if (!a["file"].IsDefined())
+							{
+								std::cout << "log config error: mmapappender file is null " << a << std::endl;
+								continue;
+							}
+							lad.file = a["file"].as<std::string>();
+							if (a["formatter"].IsDefined())
+							{
+								lad.formatter = a["formatter"].as<std::string>();
+							}
+							if (a["segment_size"].IsDefined())
+							{
+								lad.segment_size = a["segment_size"].as<size_t>();
+							}
 						}
 						else
 						{
@@ -715,14 +4549,45 @@ namespace cch
 				for (auto& a : i.appenders)
 				{
 					YAML::Node na;
-					if (a.type == 1)
+					if (a.type == 1 || a.type == 3)
 					{
-						na["type"] = "FileLogAppender";
+						na["type"] = a.type == 1 ? "FileLogAppender" : "BinaryLogAppender";
 						na["file"] = a.file;
+						if (a.async)
+						{
+							na["async"] = true;
+							na["buffer_size"] = a.buffer_size;
+							na["flush_interval"] = a.flush_interval;
+							na["overflow"] = FileLogAppender::OverflowToString((FileLogAppender::OverflowPolicy)a.overflow);
+						}
+						SyncToYaml(na, (FileLogAppender::SyncPolicy)a.sync, a.sync_interval);
+						RollToYaml(na, a.roll);
+						CompressToYaml(na, (FileLogAppender::Compression)a.compress, a.compress_level);
+						IndexToYaml(na, a.index_records, a.index_interval);
 					}
 					else if (a.type == 2)
 					{
 						na["type"] = "StdoutLogAppender";
+						if (a.async)
+						{
+							na["async"] = true;
+							na["buffer_size"] = a.buffer_size;
+							na["flush_interval"] = a.flush_interval;
+							na["overflow"] = FileLogAppender::OverflowToString((FileLogAppender::OverflowPolicy)a.overflow);
+						}
+						SyncToYaml(na, (FileLogAppender::SyncPolicy)a.sync, a.sync_interval);
+					}
+					else if (a.type == 5)
+					{
+						na["type"] = "FlightRecorderLogAppender";
+						na["file"] = a.file;
+						na["capacity"] = a.capacity;
+					}
+					else if (a.type == 4)
+					{
+						na["type"] = "MmapLogAppender";
+						na["file"] = a.file;
+						na["segment_size"] = a.segment_size;
 					}
 					na["level"] = LogLevel::ToString(a.level);
 					if (!a.formatter.empty())
@@ -744,68 +4609,134 @@ namespace cch
 	cch::ConfigVar<std::set<LogDefine>>::ptr g_log_defines =
 		cch::Config::Lookup("logs", std::set<LogDefine>(), "logs config");
 
+	static LogAppender::ptr CreateAppender(const LogDefine& ld, const LogAppenderDefine& a)
+	{
+		cch::LogAppender::ptr ap;
+		if (a.type == 1 || a.type == 3)
+		{
+			FileLogAppender::Compression compress = (FileLogAppender::Compression)a.compress;
+			FileLogAppender::ptr fap(a.type == 1 ? new FileLogAppender(a.file, a.roll, compress, a.compress_level)
+				: new BinaryLogAppender(a.file, a.roll, compress, a.compress_level));
+			if (a.index_records || a.index_interval)
+			{
+				fap->setTimeIndex(a.index_records, a.index_interval);
+			}
+			fap->setSyncPolicy((FileLogAppender::SyncPolicy)a.sync, a.sync_interval);
+			if (a.async)
+			{
+				fap->setAsync(a.buffer_size, a.flush_interval,
+					(FileLogAppender::OverflowPolicy)a.overflow);
+			}
+			ap = fap;
+		}
+		else if (a.type == 2)
+		{
+			StdoutLogAppender::ptr sap(new StdoutLogAppender);
+			sap->setSyncPolicy((FileLogAppender::SyncPolicy)a.sync, a.sync_interval);
+			if (a.async)
+			{
+				sap->setAsync(a.buffer_size, a.flush_interval,
+					(FileLogAppender::OverflowPolicy)a.overflow);
+			}
+			ap = sap;
+		}
+		else if (a.type == 5)
+		{
+			ap.reset(new FlightRecorderLogAppender(a.file, a.capacity));
+		}
+		else if (a.type == 4)
+		{
+			ap.reset(new MmapLogAppender(a.file, a.segment_size));
+		}
+		ap->setLevel(a.level);
+		if (!a.formatter.empty())
+		{
+			LogFormatter::ptr fmt(new LogFormatter(a.formatter));
+			if (!fmt->isError())
+			{
+				ap->setFormatter(fmt);
+			}
+			else
+			{
+				std::cout << "log name= " << ld.name 
+					<< "appender name=" << a.type << " formatter="
+					<< a.formatter << " is invalid" << std::endl;
+			}
+		}
+		return ap;
+	}
+
+	//ļappenderĶ壬ȼʱûappenderԭ
+	//ļ첽
+	struct ConfiguredAppender
+	{
+		LogAppenderDefine define;
+		LogAppender::ptr appender;
+	};
+
 	struct LogIniter
 	{
+		std::mutex mutex;	//лñ
+		std::map<std::string, std::vector<ConfiguredAppender> > configured;
+
 		LogIniter()
 		{
-			g_log_defines->addListener(0xF1E231, [](const std::set<LogDefine>& old_value,
+			g_log_defines->addListener(0xF1E231, [this](const std::set<LogDefine>& old_value,
 				const std::set<LogDefine>& new_value) {
 					CCH_LOG_INFO(CCH_LOG_ROOT()) << "on_logger_conf_changed";
+					std::lock_guard<std::mutex> lock(mutex);
 					//	޸
 					for (auto& i : new_value)
 					{
 						auto it = old_value.find(i);
-						cch::Logger::ptr logger;
-						if (it == old_value.end())
-						{
-							//logger
-							//logger.reset(new cch::Logger(i.name));
-							logger = CCH_LOG_NAME(i.name); 
-						}
-						else
+						if (it != old_value.end() && i == *it)
 						{
-							if (!(i == *it))
-							{
-								//޸logger
-								logger = CCH_LOG_NAME(i.name);
-							}
+							//ûб仯
+							continue;
 						}
+						cch::Logger::ptr logger = CCH_LOG_NAME(i.name);
 						logger->setLevel(i.level);
-						if (!i.formatter.empty())
+						//ûԼformatterappenderõ־formatter־ıЩҲҪؽ
+						bool formatter_changed = it == old_value.end() || it->formatter != i.formatter;
+						if (!i.formatter.empty() && formatter_changed)
 						{
 							logger->setFormatter(i.formatter);
 						}
 
-						logger->clearAppenders();
+						//ȫͬappenderԭĶ½ȫһ滻
+						//滻߳ճ־滻ļappenderʱѻд
+						std::vector<ConfiguredAppender>& old_aps = configured[i.name];
+						std::vector<LogAppender::ptr> previous;
+						for (auto& o : old_aps)
+						{
+							previous.push_back(o.appender);
+						}
+						std::vector<ConfiguredAppender> new_aps;
+						std::vector<LogAppender::ptr> appenders;
 						for (auto& a : i.appenders)
 						{
-							cch::LogAppender::ptr ap;
-
-							if (a.type == 1)
-							{
-								ap.reset(new FileLogAppender(a.file));
-							}
-							else if (a.type == 2)
+							ConfiguredAppender ca;
+							ca.define = a;
+							for (auto& o : old_aps)
 							{
-								ap.reset(new StdoutLogAppender);
-							}
-							ap->setLevel(a.level);
-							if (!a.formatter.empty())
-							{
-								LogFormatter::ptr fmt(new LogFormatter(a.formatter));
-								if (!fmt->isError())
-								{
-									ap->setFormatter(fmt);
-								}
-								else
+								if (o.appender && o.define == a && (!a.formatter.empty() || !formatter_changed))
 								{
-									std::cout << "log name= " << i.name 
-										<< "appender name=" << a.type << " formatter="
-										<< a.formatter << " is invalid" << std::endl;
+									ca.appender.swap(o.appender);
+									break;
 								}
 							}
-							logger->addAppender(ap);
+							if (!ca.appender)
+							{
+								ca.appender = CreateAppender(i, a);
+							}
+							appenders.push_back(ca.appender);
+							new_aps.push_back(ca);
+						}
+						if (appenders != previous || it == old_value.end())
+						{
+							logger->setAppenders(appenders);
 						}
+						old_aps.swap(new_aps);
 					}
 
 					//ɾ
@@ -814,10 +4745,11 @@ namespace cch
 						auto it = new_value.find(i);
 						if (it == new_value.end())
 						{
-							//ɾlogger
+							//ɾloggerָɼ̳ϼ
 							auto logger = CCH_LOG_NAME(i.name);
-							logger->setLevel((LogLevel::Level) 100);
+							logger->setLevel(LogLevel::UNKNOW);
 							logger->clearAppenders();
+							configured.erase(i.name);
 						}
 					}
 				});
@@ -836,6 +4768,14 @@ namespace cch
 		YAML::Node node;
 		node["type"] = "StdoutLogAppender";
 		node["level"] = LogLevel::ToString(m_level);
+		if (m_batch)
+		{
+			node["async"] = true;
+			node["buffer_size"] = m_batch->getBufferSize();
+			node["flush_interval"] = m_batch->getFlushInterval();
+			node["overflow"] = FileLogAppender::OverflowToString(m_batch->getOverflowPolicy());
+		}
+		SyncToYaml(node, m_syncPolicy, m_syncInterval);
 		if (m_formatter)
 		{
 			node["formatter"] = m_formatter->getPattern();
@@ -845,6 +4785,39 @@ namespace cch
 		return ss.str();
 	}
 
+	void StdoutLogAppender::setAsync(size_t buffer_size, uint32_t flush_interval, FileLogAppender::OverflowPolicy policy)
+	{
+		if (m_batch)
+		{
+			return;
+		}
+		//֮ǰstd::coutдȥд־
+		std::cout.flush();
+		FileLogAppender::ptr batch(new FileLogAppender(STDOUT_FILENO));
+		if (!batch->reopen())
+		{
+			return;
+		}
+		batch->setSyncPolicy(m_syncPolicy, m_syncInterval);
+		batch->setAsync(buffer_size, flush_interval, policy);
+		m_batch = batch;
+	}
+
+	void StdoutLogAppender::setSyncPolicy(FileLogAppender::SyncPolicy policy, uint32_t interval_ms)
+	{
+		m_syncPolicy = policy;
+		m_syncInterval = interval_ms ? interval_ms : 1000;
+		if (m_batch)
+		{
+			m_batch->setSyncPolicy(policy, interval_ms);
+		}
+	}
+
+	FileLogAppender::FlushStats StdoutLogAppender::getFlushStats()
+	{
+		return m_batch ? m_batch->getFlushStats() : FileLogAppender::FlushStats();
+	}
+
 	std::string FileLogAppender::toYamlString()
 	{
 		YAML::Node node;
@@ -852,6 +4825,17 @@ namespace cch
 		node["file"] = m_filename;
 		//node["file"] = "system.txt";
 		node["level"] = LogLevel::ToString(m_level);
+		if (m_async)
+		{
+			node["async"] = true;
+			node["buffer_size"] = m_bufferSize;
+			node["flush_interval"] = m_flushInterval;
+			node["overflow"] = OverflowToString(m_overflow);
+		}
+		SyncToYaml(node, m_syncPolicy, m_syncInterval);
+		RollToYaml(node, m_roll);
+		CompressToYaml(node, m_compress, m_compressLevel);
+		IndexToYaml(node, m_indexRecords, m_indexInterval);
 		if (m_formatter)
 		{
 			node["formatter"] = m_formatter->getPattern();
@@ -865,13 +4849,15 @@ namespace cch
 	{
 		YAML::Node node;
 		node["name"] = m_name;
-		node["level"] = LogLevel::ToString(m_level);
-		if (m_formatter)
+		Rcu::ReadGuard guard;
+		const State* state = m_state.get();
+		node["level"] = LogLevel::ToString(state->ownLevel);
+		if (state->formatter)
 		{
-			node["formatter"] = m_formatter->getPattern();
+			node["formatter"] = state->formatter->getPattern();
 		}
 
-		for (auto&i : m_appenders)
+		for (auto&i : state->ownAppenders)
 		{
 			node["appenders"].push_back(YAML::Load(i->toYamlString()));
 		}
@@ -883,6 +4869,7 @@ namespace cch
 	std::string LoggerManager::toYamlString()
 	{
 		YAML::Node node;
+		std::lock_guard<std::mutex> lock(m_mutex);
 		for (auto& i : m_logger)
 		{
 			node.push_back(YAML::Load(i.second->toYamlString()));
@@ -4,6 +4,7 @@
 
 #include<string>
 #include<stdint.h>
+#include<stdarg.h>
 #include<memory>
 #include<list>
 #include<sstream>
@@ -11,14 +12,46 @@
 #include<iostream>
 #include<vector>
 #include<map>
+#include<deque>
+#include<thread>
+#include<mutex>
+#include<condition_variable>
+#include<atomic>
+#include<type_traits>
+#include<string.h>
+#include<sys/uio.h>
+#if __cplusplus >= 201703L
+#include<string_view>
+#endif
 #include"singleton.h"
+#include"rcu.h"
 #include"util.h" 
 
 
+//ڵļޣ־ȥ -DCCH_LOG_MIN_LEVEL=2 ȥDEBUG־
+//ȡֵͬLogLevel::LevelĬ0ȥκ־
+#ifndef CCH_LOG_MIN_LEVEL
+#define CCH_LOG_MIN_LEVEL 0
+#endif
+
+//ÿ־һľ̬õϢʼҪʼ
+#define CCH_LOG_SITE() \
+	([]() -> cch::LogCallSite* { static cch::LogCallSite s_site(__FILE__, __LINE__); return &s_site; }())
+
+//־Ƿõ㻺ϴεжϽ־òʱκκ
+#define CCH_LOG_ENABLED(logger, level) \
+	((level) >= CCH_LOG_MIN_LEVEL && CCH_LOG_SITE()->isEnabled(*(logger), level))
+
+//ʱĵõ㣬򷵻nullptr־if__cch_siteٴLogEventWrap
+//û͸ʽԤͬһõϣÿֻһõ
+#define CCH_LOG_ENABLED_SITE(logger, level) \
+	((level) >= CCH_LOG_MIN_LEVEL ? CCH_LOG_SITE()->ifEnabled(*(logger), level) : nullptr)
+
+//LogEventWrapջϵʱ־д߳˽еĶ䲻ڴ
 #define CCH_LOG_LEVEL(logger, level) \
-	if(logger->getLevel() <= level) \
-		cch::LogEventWrap(cch::LogEvent::ptr(new cch::LogEvent(logger, level, __FILE__, __LINE__, 0, cch::GetThreadId(), \ 
-			cch::GetFiberId(), time(0)))).getSS()
+	if(cch::LogCallSite* __cch_site = CCH_LOG_ENABLED_SITE(logger, level)) \
+		cch::LogEventWrap(logger, level, __FILE__, __LINE__, 0, cch::GetThreadId(), \
+			cch::GetFiberId(), cch::GetCurrentUS(), __cch_site).getSS()
 
 #define CCH_LOG_DEBUG(logger) CCH_LOG_LEVEL(logger, cch::LogLevel::DEBUG)
 #define CCH_LOG_ERROR(logger) CCH_LOG_LEVEL(logger, cch::LogLevel::ERROR)
@@ -27,9 +60,39 @@
 #define CCH_LOG_WARN(logger) CCH_LOG_LEVEL(logger, cch::LogLevel::WARN)
 
 #define CCH_LOG_FMT_LEVEL(logger, level, fmt, ...) \
-	if(logger->getLevel()<=level) \
-		cch::LogEventWrap(cch::LogEvent::ptr(new cch::LogEvent(logger, level, __FILE__, __LINE__, \
-			0, cch::GetThreadId(), cch::GetFiberId(), time(0)))).getEvent()->format(fmt, __VA_ARGS__)
+	if(cch::LogCallSite* __cch_site = CCH_LOG_ENABLED_SITE(logger, level)) \
+		cch::LogEventWrap(logger, level, __FILE__, __LINE__, \
+			0, cch::GetThreadId(), cch::GetFiberId(), cch::GetCurrentUS(), __cch_site).getEvent()->formatLazy(__builtin_constant_p(fmt), fmt, __VA_ARGS__)
+
+//{}ĸʽ־ CCH_LOG_PRINT_INFO(logger, "user {} login from {}:{}", name, ip, port)
+//ʽַռλʽ˵Ͳڱڼ飬ƥʱ뱨
+//C++11constexprֻһreturn䣬ʱڼ飬ռλʱԭ
+#if __cplusplus >= 201402L
+#define CCH_LOG_CONSTEXPR14 constexpr
+#define CCH_LOG_PRINT_CHECK(fmt, ...) \
+	std::integral_constant<bool, decltype(cch::LogBraceTypes(__VA_ARGS__))::Run(fmt)>::value
+#else
+#define CCH_LOG_CONSTEXPR14
+#define CCH_LOG_PRINT_CHECK(fmt, ...) true
+#endif
+
+#define CCH_LOG_PRINT_LEVEL(logger, level, fmt, ...) \
+	if(cch::LogCallSite* __cch_site = CCH_LOG_PRINT_CHECK(fmt, ##__VA_ARGS__) ? CCH_LOG_ENABLED_SITE(logger, level) : nullptr) \
+		cch::LogEventWrap(logger, level, __FILE__, __LINE__, 0, cch::GetThreadId(), \
+			cch::GetFiberId(), cch::GetCurrentUS(), __cch_site).getEvent()->print(fmt, ##__VA_ARGS__)
+
+#define CCH_LOG_PRINT_DEBUG(logger, fmt, ...) CCH_LOG_PRINT_LEVEL(logger, cch::LogLevel::DEBUG, fmt, ##__VA_ARGS__)
+#define CCH_LOG_PRINT_ERROR(logger, fmt, ...) CCH_LOG_PRINT_LEVEL(logger, cch::LogLevel::ERROR, fmt, ##__VA_ARGS__)
+#define CCH_LOG_PRINT_FATAL(logger, fmt, ...) CCH_LOG_PRINT_LEVEL(logger, cch::LogLevel::FATAL, fmt, ##__VA_ARGS__)
+#define CCH_LOG_PRINT_INFO(logger, fmt, ...) CCH_LOG_PRINT_LEVEL(logger, cch::LogLevel::INFO, fmt, ##__VA_ARGS__)
+#define CCH_LOG_PRINT_WARN(logger, fmt, ...) CCH_LOG_PRINT_LEVEL(logger, cch::LogLevel::WARN, fmt, ##__VA_ARGS__)
+
+//ֵֶε־ֶjson/logfmtʽıʽ
+// CCH_LOG_WITH(logger, cch::LogLevel::INFO).field("uid", uid).field("ip", ip).getSS() << "login"
+#define CCH_LOG_WITH(logger, level) \
+	if(cch::LogCallSite* __cch_site = CCH_LOG_ENABLED_SITE(logger, level)) \
+		cch::LogEventWrap(logger, level, __FILE__, __LINE__, 0, cch::GetThreadId(), \
+			cch::GetFiberId(), cch::GetCurrentUS(), __cch_site)
 
 #define CCH_LOG_FMT_DEBUG(logger, fmt, ...) CCH_LOG_FMT_LEVEL(logger, cch::LogLevel::DEBUG, fmt, __VA_ARGS__)
 #define CCH_LOG_FMT_ERROR(logger, fmt, ...) CCH_LOG_FMT_LEVEL(logger, cch::LogLevel::ERROR, fmt, __VA_ARGS__)
@@ -37,8 +100,45 @@
 #define CCH_LOG_FMT_INFO(logger, fmt, ...) CCH_LOG_FMT_LEVEL(logger, cch::LogLevel::INFO, fmt, __VA_ARGS__)
 #define CCH_LOG_FMT_WARN(logger, fmt, ...) CCH_LOG_FMT_LEVEL(logger, cch::LogLevel::WARN, fmt, __VA_ARGS__)
 
+//ÿ־һľ̬״̬constexpr죬Ҫʼ
+#define CCH_LOG_LIMITER() \
+	([]() -> cch::LogLimiter* { static cch::LogLimiter s_limiter; return &s_limiter; }())
+
+//־checkڴLogEvent֮ǰִУʱֻһԭӲ
+//ָʱǰ֮ǰƵ "[suppressed 99] ..."
+#define CCH_LOG_LIMIT(logger, level, check) \
+	if(cch::LogCallSite* __cch_site = CCH_LOG_ENABLED_SITE(logger, level)) \
+		if (cch::LogLimitResult __cch_limit = check) \
+			cch::LogEventWrap(logger, level, __FILE__, __LINE__, 0, cch::GetThreadId(), \
+				cch::GetFiberId(), cch::GetCurrentUS(), __cch_site).limit(__cch_limit).getSS()
+
+#define CCH_LOG_FMT_LIMIT(logger, level, check, fmt, ...) \
+	if(cch::LogCallSite* __cch_site = CCH_LOG_ENABLED_SITE(logger, level)) \
+		if (cch::LogLimitResult __cch_limit = check) \
+			cch::LogEventWrap(logger, level, __FILE__, __LINE__, 0, cch::GetThreadId(), \
+				cch::GetFiberId(), cch::GetCurrentUS(), __cch_site).limit(__cch_limit).getEvent() \
+				->formatLazy(__builtin_constant_p(fmt), fmt, __VA_ARGS__)
+
+//ÿnһ
+#define CCH_LOG_EVERY_N(logger, level, n) CCH_LOG_LIMIT(logger, level, CCH_LOG_LIMITER()->everyN(n))
+//ֻǰn
+#define CCH_LOG_FIRST_N(logger, level, n) CCH_LOG_LIMIT(logger, level, CCH_LOG_LIMITER()->firstN(n))
+//ÿn
+#define CCH_LOG_PER_SEC(logger, level, n) CCH_LOG_LIMIT(logger, level, CCH_LOG_LIMITER()->perSecond(n))
+
+#define CCH_LOG_FMT_EVERY_N(logger, level, n, fmt, ...) \
+	CCH_LOG_FMT_LIMIT(logger, level, CCH_LOG_LIMITER()->everyN(n), fmt, __VA_ARGS__)
+#define CCH_LOG_FMT_FIRST_N(logger, level, n, fmt, ...) \
+	CCH_LOG_FMT_LIMIT(logger, level, CCH_LOG_LIMITER()->firstN(n), fmt, __VA_ARGS__)
+#define CCH_LOG_FMT_PER_SEC(logger, level, n, fmt, ...) \
+	CCH_LOG_FMT_LIMIT(logger, level, CCH_LOG_LIMITER()->perSecond(n), fmt, __VA_ARGS__)
+
 #define CCH_LOG_ROOT() cch::loggerMgr::GetInstance()->getRoot()
 #define CCH_LOG_NAME(name) cch::loggerMgr::GetInstance()->getLogger(name)
+//ÿõֻڵһִʱһΣֻ֮Ƕһ̬־󲻻ɾһֱЧ
+//nameȫֳ(þֲ)
+#define CCH_LOG_NAME_CACHED(name) \
+	([]() -> const cch::Logger::ptr& { static const cch::Logger::ptr s_logger = CCH_LOG_NAME(name); return s_logger; }())
 
 //־ģ
 namespace cch {
@@ -62,26 +162,570 @@ namespace cch {
 		static LogLevel::Level FromString(const std::string& str);
 	};
 
+	//дֱӽضϣ
+	class LogStreamBuf : public std::streambuf
+	{
+	public:
+		LogStreamBuf();
+		void reset(char* buf, size_t size);
+		const char* data() const { return pbase(); }
+		size_t size() const { return pptr() - pbase(); }
+		//ֱʣռдݣȡдλúʣСдcommit
+		char* tail(size_t& left) { left = epptr() - pptr(); return pptr(); }
+		void commit(size_t n) { pbump(n); }
+		void vprintf(const char* fmt, va_list al);
+	protected:
+		int_type overflow(int_type ch) override;
+		std::streamsize xsputn(const char* s, std::streamsize n) override;
+	};
+
+	//־߳˽еĶȡ黹
+	class LogStream : public std::ostream
+	{
+		friend struct LogStreamPool;
+	public:
+		enum {
+			BUFFER_SIZE = 8192,	//Ⱦ־õ
+			CONTENT_SIZE = 4096	//־ĵ󳤶ȣʽǰ׺
+		};
+
+		//ӵǰ̵߳Ķȡһʱ˻Ϊnewһ(ֻ־Ƕ׺ʱ)
+		static LogStream* Acquire(size_t limit = BUFFER_SIZE);
+		//黹Acquireͬһ̵߳
+		static void Release(LogStream* stream);
+
+		const char* data() const { return m_buf.data(); }
+		size_t size() const { return m_buf.size(); }
+		char* tail(size_t& left) { return m_buf.tail(left); }
+		void commit(size_t n) { m_buf.commit(n); }
+		void vprintf(const char* fmt, va_list al) { m_buf.vprintf(fmt, al); }
+	private:
+		LogStream();
+		void reset(size_t limit);
+	private:
+		LogStreamBuf m_buf;
+		struct LogStreamPool* m_pool = nullptr;
+		int m_index = -1;
+		char m_data[BUFFER_SIZE];
+	};
+
+	//printfʽԤȽĽ
+	//CCH_LOG_FMT_*ĲȰԭʼƱ(encode)Ҫıʱٸʽ(render)
+	//ֻжappender־·ϲκθʽ
+	class LogFmtSpec
+	{
+	public:
+		enum ArgType : uint8_t {
+			ARG_NONE = 0,	//ûвֻ
+			ARG_INT,		//int̵%c
+			ARG_LONG,		//l z t jLP64¶8ֽ
+			ARG_LONGLONG,	//ll q
+			ARG_DOUBLE,		//f e g a
+			ARG_LONGDOUBLE,	//Lf ...
+			ARG_STRING,		//%s泤Ⱥ
+			ARG_POINTER		//%p
+		};
+
+		struct Piece
+		{
+			std::string literal;	//ת˵ǰ
+			std::string spec;	//ת˵"%-8.3f"
+			uint8_t stars = 0;	///'*'ĸÿӦһint
+			bool star_precision = false;	//'*'ȡһ'*'
+			int precision = -1;	//%.NsNûдʱΪ-1
+			ArgType type = ARG_NONE;
+		};
+
+		//ʧֵܻ֧ת(%n %m %ls λò)ʱnullptr÷˻صvsnprintf
+		static LogFmtSpec* Compile(const char* fmt);
+
+		//Ѳ˳뵽bufŲʱ(size_t)-1
+		size_t encode(char* buf, size_t size, va_list al) const;
+		//ĲʽısizeĲֽضϣдֽ
+		size_t render(char* out, size_t size, const char* args, size_t len) const;
+
+		const char* getFormat() const { return m_format; }
+	private:
+		const char* m_format = nullptr;	//ʱָ룬жͬһõfmtǷͬһ
+		std::vector<Piece> m_pieces;
+	};
+
+	//־ĵõ㣬CCH_LOG_SITE()ÿ־䴦̬
+	class LogCallSite
+	{
+	public:
+		//õǾ̬󣬽˳ʱܻ߳̿ãԤͷ
+		constexpr LogCallSite(const char* file, int32_t line)
+			:m_file(file), m_line(line), m_id(0), m_enabled(0), m_compiled(false) {}
+		//Ψһ1ʼһεʱ
+		uint32_t getId() const
+		{
+			uint32_t id = m_id.load(std::memory_order_relaxed);
+			return id ? id : assignId();
+		}
+		const char* getFile() const { return m_file; }
+		int32_t getLine() const { return m_line; }
+		//fmtԤĽֻõõĵһfmtfmtֵ֧ĸʽnullptr
+		const LogFmtSpec* getSpec(const char* fmt);
+		//ѾԤĽûfmtʽ֧ʱnullptr
+		const LogFmtSpec* getCompiled() const { return m_compiled.load(std::memory_order_acquire) ? m_spec : nullptr; }
+		//loggerڸõõlevelʱǷᱻĽ־ôһʱֱӷأ
+		//־ÿηöһţȻʧЧ
+		bool isEnabled(const Logger& logger, LogLevel::Level level);
+		//ͬisEnabledʱԼ򷵻nullptr
+		LogCallSite* ifEnabled(const Logger& logger, LogLevel::Level level) { return isEnabled(logger, level) ? this : nullptr; }
+	private:
+		uint32_t assignId() const;
+		bool updateEnabled(const Logger& logger, LogLevel::Level level);
+	private:
+		const char* m_file;
+		int32_t m_line;
+		mutable std::atomic<uint32_t> m_id;
+		//Logger::getSiteKey() | level << 1 | Ƿ
+		std::atomic<uint64_t> m_enabled;
+		std::atomic<bool> m_compiled;
+		LogFmtSpec* m_spec = nullptr;	//m_compiledλֻ
+		std::mutex m_mutex;
+	};
+
+	//жϵĽתΪboolʾǷ
+	struct LogLimitResult
+	{
+		bool pass;
+		uint64_t suppressed;	//ϴ֮Ƶ
+		explicit operator bool() const { return pass; }
+	};
+
+	//õ״̬CCH_LOG_LIMITER()ÿ־䴦̬
+	//вֻһ64λԭӱ·һrelaxedfetch_add
+	class LogLimiter
+	{
+	public:
+		constexpr LogLimiter() :m_state(0) {}
+		//1n+12n+1...
+		LogLimitResult everyN(uint64_t n)
+		{
+			uint64_t c = m_state.fetch_add(1, std::memory_order_relaxed);
+			if (n <= 1)
+			{
+				return LogLimitResult{ true, 0 };
+			}
+			return LogLimitResult{ c % n == 0, c ? n - 1 : 0 };
+		}
+		//ֻǰnΣ֮ٻָ
+		LogLimitResult firstN(uint64_t n)
+		{
+			return LogLimitResult{ m_state.fetch_add(1, std::memory_order_relaxed) < n, 0 };
+		}
+		//ÿȻnΣ32λ룬32λǸڵĵô
+		//·һʱӡһfetch_addڸʱCASڣ0ʼ
+		LogLimitResult perSecond(uint32_t n);
+	private:
+		std::atomic<uint64_t> m_state;
+	};
+
+	//{}ĸʽʽڱڼ飬ֱд־ݣprintf
+	//ռλΪ {}  {:[][0][][.][]}{{  }}  {  }
+	//  룺< (ַĬ)> Ҷ(Ĭ)00
+	//  d(Ĭ) x X o b c    㣺f e gָʱ̵ľȷʾֻоʱͬg
+	//  ַs(Ĭ)Ϊַ    ַc(Ĭ) d x X
+	//  bools(Ĭϣtrue/false) d    ָ룺p(Ĭ)
+	//  operator<<ֻд{}
+	class LogBrace
+	{
+	public:
+		enum Kind {
+			KIND_NONE = 0,
+			KIND_INT,
+			KIND_UINT,
+			KIND_FLOAT,
+			KIND_STRING,
+			KIND_CHAR,
+			KIND_BOOL,
+			KIND_POINTER,
+			KIND_OTHER
+		};
+
+		enum Error {
+			OK = 0,
+			ERR_UNMATCHED_BRACE,
+			ERR_INVALID_SPEC,
+			ERR_TOO_FEW_ARGS,
+			ERR_TOO_MANY_ARGS,
+			ERR_SPEC_TYPE	//ʽ˵ͲͲƥ䣬f
+		};
+
+		struct Spec
+		{
+			char align = 0;
+			char type = 0;
+			bool zero = false;
+			int width = -1;
+			int precision = -1;
+		};
+
+		//pָ'{'֮󣬽ɹ'}'֮λãʧܷnullptr
+		static CCH_LOG_CONSTEXPR14 const char* ParseSpec(const char* p, Spec& spec)
+		{
+			if (*p == '}')
+			{
+				return p + 1;
+			}
+			if (*p != ':')
+			{
+				return nullptr;
+			}
+			++p;
+			if (*p == '<' || *p == '>')
+			{
+				spec.align = *p++;
+			}
+			if (*p == '0')
+			{
+				spec.zero = true;
+				++p;
+			}
+			if (*p >= '0' && *p <= '9')
+			{
+				spec.width = 0;
+				while (*p >= '0' && *p <= '9')
+				{
+					spec.width = spec.width * 10 + (*p++ - '0');
+				}
+			}
+			if (*p == '.')
+			{
+				++p;
+				if (*p < '0' || *p > '9')
+				{
+					return nullptr;
+				}
+				spec.precision = 0;
+				while (*p >= '0' && *p <= '9')
+				{
+					spec.precision = spec.precision * 10 + (*p++ - '0');
+				}
+			}
+			const char* types = "dxXobcfegsp";
+			for (const char* t = types; *t; ++t)
+			{
+				if (*p == *t)
+				{
+					spec.type = *p++;
+					break;
+				}
+			}
+			return *p == '}' ? p + 1 : nullptr;
+		}
+
+		//͵Ĳܷʹspec
+		static CCH_LOG_CONSTEXPR14 bool Accepts(Kind kind, const Spec& spec)
+		{
+			switch (kind)
+			{
+			case KIND_INT:
+			case KIND_UINT:
+				return spec.precision < 0 && (!spec.type || spec.type == 'd' || spec.type == 'x' || spec.type == 'X'
+					|| spec.type == 'o' || spec.type == 'b' || spec.type == 'c');
+			case KIND_FLOAT:
+				return !spec.type || spec.type == 'f' || spec.type == 'e' || spec.type == 'g';
+			case KIND_STRING:
+				return !spec.type || spec.type == 's';
+			case KIND_CHAR:
+				return spec.precision < 0 && (!spec.type || spec.type == 'c' || spec.type == 'd'
+					|| spec.type == 'x' || spec.type == 'X');
+			case KIND_BOOL:
+				return spec.precision < 0 && (!spec.type || spec.type == 's' || spec.type == 'd');
+			case KIND_POINTER:
+				return spec.precision < 0 && (!spec.type || spec.type == 'p');
+			case KIND_OTHER:
+				return !spec.type && !spec.align && !spec.zero && spec.width < 0 && spec.precision < 0;
+			default:
+				return false;
+			}
+		}
+
+		//ʽcountǷƥ䣬ںʱԵ
+		static CCH_LOG_CONSTEXPR14 Error Validate(const char* fmt, const Kind* kinds, size_t count)
+		{
+			size_t next = 0;
+			for (const char* p = fmt; *p; ++p)
+			{
+				if (*p == '}')
+				{
+					if (p[1] != '}')
+					{
+						return ERR_UNMATCHED_BRACE;
+					}
+					++p;
+					continue;
+				}
+				if (*p != '{')
+				{
+					continue;
+				}
+				if (p[1] == '{')
+				{
+					++p;
+					continue;
+				}
+				Spec spec;
+				const char* end = ParseSpec(p + 1, spec);
+				if (!end)
+				{
+					return p[1] ? ERR_INVALID_SPEC : ERR_UNMATCHED_BRACE;
+				}
+				if (next >= count)
+				{
+					return ERR_TOO_FEW_ARGS;
+				}
+				if (!Accepts(kinds[next], spec))
+				{
+					return ERR_SPEC_TYPE;
+				}
+				++next;
+				p = end - 1;
+			}
+			return next == count ? OK : ERR_TOO_MANY_ARGS;
+		}
+	};
+
+	//ͲĲֻһθʽЧ
+	struct LogBraceArg
+	{
+		LogBrace::Kind kind = LogBrace::KIND_NONE;
+		union
+		{
+			int64_t i;
+			uint64_t u;
+			double d;
+			const void* p;
+			struct
+			{
+				const char* data;
+				size_t size;
+			} s;
+			struct
+			{
+				const void* obj;
+				void (*write)(std::ostream& os, const void* obj);
+			} o;
+		};
+
+		LogBraceArg() :u(0) {}
+		template<class T>
+		LogBraceArg(const T& v);
+	};
+
+	//͵LogBrace::Kindӳ䣬Tdecay֮
+	template<class T, class Enable = void>
+	struct LogBraceTraits
+	{
+		static constexpr LogBrace::Kind kind = LogBrace::KIND_OTHER;
+		static void Set(LogBraceArg& a, const T& v)
+		{
+			a.o.obj = &v;
+			a.o.write = &Write;
+		}
+		static void Write(std::ostream& os, const void* obj) { os << *static_cast<const T*>(obj); }
+	};
+
+	template<class T>
+	struct LogBraceTraits<T, typename std::enable_if<std::is_integral<T>::value && std::is_signed<T>::value>::type>
+	{
+		static constexpr LogBrace::Kind kind = LogBrace::KIND_INT;
+		static void Set(LogBraceArg& a, T v) { a.i = v; }
+	};
+
+	template<class T>
+	struct LogBraceTraits<T, typename std::enable_if<std::is_integral<T>::value && std::is_unsigned<T>::value>::type>
+	{
+		static constexpr LogBrace::Kind kind = LogBrace::KIND_UINT;
+		static void Set(LogBraceArg& a, T v) { a.u = v; }
+	};
+
+	template<class T>
+	struct LogBraceTraits<T, typename std::enable_if<std::is_floating_point<T>::value>::type>
+	{
+		static constexpr LogBrace::Kind kind = LogBrace::KIND_FLOAT;
+		static void Set(LogBraceArg& a, T v) { a.d = v; }
+	};
+
+	template<class T>
+	struct LogBraceTraits<T*>
+	{
+		static constexpr LogBrace::Kind kind = LogBrace::KIND_POINTER;
+		static void Set(LogBraceArg& a, const T* v) { a.p = v; }
+	};
+
+	template<>
+	struct LogBraceTraits<std::nullptr_t>
+	{
+		static constexpr LogBrace::Kind kind = LogBrace::KIND_POINTER;
+		static void Set(LogBraceArg& a, std::nullptr_t) { a.p = nullptr; }
+	};
+
+	template<>
+	struct LogBraceTraits<bool>
+	{
+		static constexpr LogBrace::Kind kind = LogBrace::KIND_BOOL;
+		static void Set(LogBraceArg& a, bool v) { a.u = v; }
+	};
+
+	template<>
+	struct LogBraceTraits<char>
+	{
+		static constexpr LogBrace::Kind kind = LogBrace::KIND_CHAR;
+		static void Set(LogBraceArg& a, char v) { a.i = v; }
+	};
+
+	template<>
+	struct LogBraceTraits<const char*>
+	{
+		static constexpr LogBrace::Kind kind = LogBrace::KIND_STRING;
+		static void Set(LogBraceArg& a, const char* v)
+		{
+			a.s.data = v ? v : "(null)";
+			a.s.size = strlen(a.s.data);
+		}
+	};
+
+	template<>
+	struct LogBraceTraits<char*> : public LogBraceTraits<const char*> {};
+
+	template<>
+	struct LogBraceTraits<std::string>
+	{
+		static constexpr LogBrace::Kind kind = LogBrace::KIND_STRING;
+		static void Set(LogBraceArg& a, const std::string& v)
+		{
+			a.s.data = v.data();
+			a.s.size = v.size();
+		}
+	};
+
+#if __cplusplus >= 201703L
+	template<>
+	struct LogBraceTraits<std::string_view>
+	{
+		static constexpr LogBrace::Kind kind = LogBrace::KIND_STRING;
+		static void Set(LogBraceArg& a, std::string_view v)
+		{
+			a.s.data = v.data();
+			a.s.size = v.size();
+		}
+	};
+#endif
+
+	template<class T>
+	LogBraceArg::LogBraceArg(const T& v)
+	{
+		typedef LogBraceTraits<typename std::decay<T>::type> Traits;
+		kind = Traits::kind;
+		Traits::Set(*this, v);
+	}
+
+	//ʱõĺconstexprڼʧʱıϢк
+	inline void log_format_error_unmatched_brace() {}
+	inline void log_format_error_invalid_spec() {}
+	inline void log_format_error_too_few_arguments() {}
+	inline void log_format_error_too_many_arguments() {}
+	inline void log_format_error_spec_does_not_match_argument_type() {}
+
+	template<class... Args>
+	struct LogBraceCheck
+	{
+		static constexpr LogBrace::Kind s_kinds[] = { LogBraceTraits<typename std::decay<Args>::type>::kind..., LogBrace::KIND_NONE };
+
+		static CCH_LOG_CONSTEXPR14 bool Run(const char* fmt)
+		{
+			switch (LogBrace::Validate(fmt, s_kinds, sizeof...(Args)))
+			{
+			case LogBrace::OK:
+				return true;
+			case LogBrace::ERR_UNMATCHED_BRACE:
+				log_format_error_unmatched_brace();
+				break;
+			case LogBrace::ERR_INVALID_SPEC:
+				log_format_error_invalid_spec();
+				break;
+			case LogBrace::ERR_TOO_FEW_ARGS:
+				log_format_error_too_few_arguments();
+				break;
+			case LogBrace::ERR_TOO_MANY_ARGS:
+				log_format_error_too_many_arguments();
+				break;
+			case LogBrace::ERR_SPEC_TYPE:
+				log_format_error_spec_does_not_match_argument_type();
+				break;
+			}
+			return false;
+		}
+	};
+
+	template<class... Args>
+	constexpr LogBrace::Kind LogBraceCheck<Args...>::s_kinds[];
+
+	//ֻdecltypeȡͣҪ
+	template<class... Args>
+	LogBraceCheck<Args...> LogBraceTypes(const Args&...);
+
 	//־¼
+	//дLogStreamLogEventWrapջϣֻһ־Ч
+	//ڴ߳
 	class LogEvent
 	{
 	public:
 		typedef std::shared_ptr<LogEvent> ptr;
 		LogEvent(std::shared_ptr<Logger> logger, LogLevel::Level level, const char* file, int32_t line, uint32_t elapse,
-			uint32_t threadid, uint32_t fiberid, uint64_t time);
+			uint32_t threadid, uint32_t fiberid, uint64_t time, uint32_t usec = 0, LogCallSite* site = nullptr);
 		~LogEvent();
+		LogEvent(const LogEvent&) = delete;
+		LogEvent& operator=(const LogEvent&) = delete;
 		const char* getFile() const { return m_file; }
 		int32_t getLine() const { return m_line; }
 		uint32_t gettElapse() const { return m_elapse; }
 		uint32_t getThreadId() const { return m_threadid; }
 		uint32_t getFiberId() const { return m_fiberid; }
 		uint64_t getTime() const { return m_time; }
-		std::string getContent() { return m_ss.str(); }
+		uint32_t getUsec() const { return m_usec; }
+		//CCH_LOG_FMT_*ݵһζȡʱŸʽ
+		std::string getContent() const { render(); return std::string(m_ss->data(), m_ss->size()); }
+		const char* getContentData() const { render(); return m_ss->data(); }
+		size_t getContentSize() const { render(); return m_ss->size(); }
+		LogCallSite* getSite() const { return m_site; }
+		//ԶƱʱضӦLogFmtSpec򷵻nullptr
+		const LogFmtSpec* getFmtSpec() const { return m_spec; }
+		const char* getArgsData() const { return m_args ? m_args->data() : nullptr; }
+		size_t getArgsSize() const { return m_args ? m_args->size() : 0; }
+		//ñõĲ־ʱʹ
+		void setArgs(const LogFmtSpec* spec, const char* data, size_t len);
 		std::shared_ptr<Logger> getLogger() const { return m_logger; }
 		LogLevel::Level getLevel() const { return m_level; }
-		std::stringstream& getSS() { return m_ss; }
+		std::ostream& getSS() { render(); return *m_ss; }
 		void format(const char* fmt, ...);
 		void format(const char* fmt, va_list al);
+		//literalΪtrue(fmtַ)ʱƱ棬һҪıʱŸʽͬformat
+		void formatLazy(bool literal, const char* fmt, ...);
+		//{}ĸʽLogBraceͨCCH_LOG_PRINT_*ʱʽڱڼ
+		//ֱӵʱʽĲԭ
+		template<class... Args>
+		void print(const char* fmt, const Args&... args)
+		{
+			const LogBraceArg list[] = { LogBraceArg(args)..., LogBraceArg() };
+			print(fmt, list, sizeof...(Args));
+		}
+		void print(const char* fmt, const LogBraceArg* args, size_t count);
+		//һ͵ļֵֶΡֵͬCCH_LOG_PRINT_*Ĳoperator<<תַ
+		//255ֽڽضϣֶдֶζ
+		template<class T>
+		LogEvent& field(const char* key, const T& value) { return field(key, strlen(key), LogBraceArg(value)); }
+		LogEvent& field(const char* key, size_t len, const LogBraceArg& value);
+		//ֶΣΪ kind(1) keylen(1) key valueַvalueΪ len(4) dataΪ8ֽ
+		const char* getFieldsData() const { return m_fields ? m_fields->data() : nullptr; }
+		size_t getFieldsSize() const { return m_fields ? m_fields->size() : 0; }
+	private:
+		void render() const;
 	private:
 		const char* m_file = nullptr;  //ļ
 		int32_t m_line = 0; //к
@@ -89,7 +733,13 @@ namespace cch {
 		uint32_t m_threadid = 0; //߳id
 		uint32_t m_fiberid = 0; //Эid
 		uint64_t m_time = 0;	//ʱ
-		std::stringstream m_ss; //
+		uint32_t m_usec = 0;	//ʱ΢벿
+		LogStream* m_ss; //
+		LogCallSite* m_site = nullptr;	//õ㣬ͨ־Ϊnullptr
+		const LogFmtSpec* m_spec = nullptr;	//ǿձʾԶƵʽm_args
+		LogStream* m_args = nullptr;
+		LogStream* m_fields = nullptr;	//ֵֶΣһεfield()ʱȡ
+		mutable bool m_rendered = true;	//m_argsǷѾʽm_ss
 
 		std::shared_ptr<Logger> m_logger;
 		LogLevel::Level m_level;
@@ -98,49 +748,107 @@ namespace cch {
 	class LogEventWrap
 	{
 	public:
-		LogEventWrap(LogEvent::ptr e);
+		//time_usΪ΢ʱ
+		LogEventWrap(std::shared_ptr<Logger> logger, LogLevel::Level level, const char* file, int32_t line,
+			uint32_t elapse, uint32_t threadid, uint32_t fiberid, uint64_t time_us, LogCallSite* site = nullptr);
 		~LogEventWrap();
-		std::stringstream& getSS();
-		LogEvent::ptr getEvent() const { return m_event; }
+		std::ostream& getSS();
+		//ʹãǰд֮ǰƵ
+		LogEventWrap& limit(const LogLimitResult& r);
+		template<class T>
+		LogEventWrap& field(const char* key, const T& value) { m_event.field(key, value); return *this; }
+		//Ȩָ(죬ƿ)ֻڱ־Ч
+		LogEvent::ptr getEvent() { return LogEvent::ptr(LogEvent::ptr(), &m_event); }
 	private:
-		LogEvent::ptr m_event;
+		LogEvent m_event;
 	};
 
 
 	//־ʽ
+	//patternΪ"json""logfmt"ʱģʽÿ־һУʱ䡢־̡߳Э̡
+	//ļкšϢLogEventϵļֵֶ
 	class LogFormatter
 	{
 	public:
 		typedef std::shared_ptr<LogFormatter> ptr;
+		//Ⱦ÷ṩsizeĲֽضϣдֽ
+		size_t format(char* buf, size_t size, std::shared_ptr<Logger> logger, LogLevel::Level level, LogEvent::ptr event);
 		std::string format(std::shared_ptr<Logger> logger, LogLevel::Level level, LogEvent::ptr event);
+		std::ostream& format(std::ostream& ofs, std::shared_ptr<Logger> logger, LogLevel::Level level, LogEvent::ptr event);
 		LogFormatter(const std::string& pattern);
 	public:
-		class FormatItem
+		//patternָ
+		enum OpCode : uint8_t {
+			OP_STRING,		//[arg, arg+len)Ϊm_literalsе
+			OP_MESSAGE,		//%m Ϣ
+			OP_LEVEL,		//%p level
+			OP_ELAPSE,		//%r ʱ
+			OP_NAME,		//%c ־
+			OP_THREAD_ID,	//%t ߳id
+			OP_NEWLINE,		//%n س
+			OP_DATETIME,	//%d ʱ䣬argΪm_dateFormats±֧꣬%3N()%6N(΢)
+			OP_FILENAME,	//%f ļ
+			OP_LINE,		//%l к
+			OP_TAB,			//%T Tabʱ
+			OP_FIBER_ID		//%F Эid
+		};
+
+		enum Mode : uint8_t {
+			MODE_PATTERN,
+			MODE_JSON,
+			MODE_LOGFMT
+		};
+
+		struct Op
+		{
+			OpCode code;
+			uint32_t arg;
+			uint32_t len;
+		};
+
+		//%d{...}ĽȾ̡߳뻺棬ͬһֻλ
+		struct DateFormat
 		{
-		public:
-			typedef std::shared_ptr<FormatItem> ptr;
-			//FormatItem(const std::string fmt = "") {};
-			virtual ~FormatItem(){}
-			virtual void format(std::ostream& os, std::shared_ptr<Logger> logger, LogLevel::Level level, LogEvent::ptr event) = 0;
+			std::vector<std::string> parts;	//%3N/%6NпstrftimeƬ
+			std::vector<uint8_t> subsec;	//parts[i]λ(36)0ʾû
+			uint64_t id;	//ȫΨһΪ̻߳key
 		};
 
 		void init();
 
 		bool isError() const { return m_error; }
 		const std::string getPattern() const { return m_pattern; }
+		//ǷҪflush(pattern%n)
+		bool needFlush() const { return m_flush; }
+		Mode getMode() const { return m_mode; }
+	private:
+		size_t formatStructured(char* buf, size_t size, LogLevel::Level level, LogEvent::ptr event);
 	private:
-		std::vector<FormatItem::ptr> m_items;
+		Mode m_mode = MODE_PATTERN;
+		std::vector<Op> m_program;	//ָУformatһswitchѭִ
+		std::string m_literals;	//ƴһ
+		std::vector<DateFormat> m_dateFormats;	//%d{...}ĸʽ
 		std::string m_pattern;
 		bool m_error = false;
+		bool m_flush = false;	//pattern%nʱflushstd::endlһ
 	};
 
 	//־
 	class LogAppender
 	{
+		friend class Logger;
 	public:
 		typedef std::shared_ptr<LogAppender> ptr;
 		virtual ~LogAppender() {}
 		virtual void log(std::shared_ptr<Logger> logger, LogLevel::Level level, LogEvent::ptr event) = 0;
+		//datam_formatterȾõ־LoggerͬһformatterֻȾһΣͬappender
+		//ĬϺdatalog()m_formatterıappenderдusesRendered()true
+		virtual void logRendered(std::shared_ptr<Logger> logger, LogLevel::Level level, LogEvent::ptr event,
+			const char* /*data*/, size_t /*len*/) { log(logger, level, event); }
+		virtual bool usesRendered() const { return false; }
+		//trueʱ־levelƣֻԼm_levelˡ־ЧȡߵСֵ
+		//м¼־INFOʱȻյDEBUG
+		virtual bool ignoreLoggerLevel() const { return false; }
 		virtual std::string toYamlString() = 0;
 		void setFormatter(LogFormatter::ptr val);
 		LogFormatter::ptr getFormatter() const;
@@ -153,6 +861,8 @@ namespace cch {
 
 
 	//־
+	//levelformatterappenderϷһɱlog()ͨRCUȡ
+	//޸Ľӿڸһݿո滻̴߳־ͬʱȸ
 	class Logger: public std::enable_shared_from_this<Logger>
 	{
 		friend class LoggerManager;
@@ -172,57 +882,470 @@ namespace cch {
 		void addAppender(LogAppender::ptr appender);
 		void delAppender(LogAppender::ptr appender);
 		void clearAppenders();
+		void setAppenders(const std::vector<LogAppender::ptr>& appenders);//滻appender
+		std::vector<LogAppender::ptr> getAppenders() const;//Լappenderϼ̳е
+		//жϼõЧignoreLoggerLevel()appenderʱܵsetLevelõļ
 		LogLevel::Level getLevel() const;
+		//UNKNOWʾ̳ϼ־ļ
 		void setLevel(LogLevel::Level level);
 		const std::string& getName() const { return m_name; }
+		uint32_t getId() const { return m_id; }
+		//ô << 36 | id << 4ÿη¿ʱȫֵĴɣõжϻǷ
+		uint64_t getSiteKey() const { return m_siteKey.load(std::memory_order_acquire); }
 
 		void setFormatter(LogFormatter::ptr val);
 		void setFormatter(const std::string& val);
-		LogFormatter::ptr getFormatter() const { return m_formatter; };
+		LogFormatter::ptr getFormatter() const;
 
 		std::string toYamlString();
+	private:
+		//ɱգ޸
+		//ownLevelownAppendersԼãlevelappendersǺϼϲĽ
+		//ΪUNKNOWappenderΪʱȡϼģlog()ֻϲĽת
+		struct State
+		{
+			LogLevel::Level ownLevel;
+			LogLevel::Level level;
+			LogFormatter::ptr formatter;
+			std::vector<LogAppender::ptr> ownAppenders;
+			//Чappenderϣϼálog()ڶٽָֻ룬
+			//appender(ܵȻfdatasync)ʱѾ뿪ٽסȿڵд
+			std::shared_ptr<const std::vector<LogAppender::ptr> > appenders;
+			bool bypass = false;	//appendersignoreLoggerLevel()appender
+		};
+		//Ƶǰգд߳m_mutexʱ
+		State* copyState() const;
+		//ϼϲ󷢲¿գͬʱЧm_levelˢ¼д߳m_mutexʱ
+		void publish(State* state);
+		//formatterͬappenderŵһ(䰴״γֵ˳ڱԭ˳)log()ʱÿֻȾһ
+		static void GroupByFormatter(std::vector<LogAppender::ptr>& appenders);
 	private:
 		std::string m_name;	//־
-		LogLevel::Level m_level;
-		std::list<LogAppender::ptr> m_appenders; //appender
-		LogFormatter::ptr m_formatter;
-		Logger::ptr m_root;
+		uint32_t m_id;	//Ψһ־
+		std::atomic<LogLevel::Level> m_level;	//Ч𣬵õ㻺ʧЧʱж
+		std::atomic<uint64_t> m_siteKey;
+		RcuPtr<State> m_state;
+		std::mutex m_mutex;	//лдߣͬʱm_childrenҪͬʱʱϼ¼
+		Logger::ptr m_parent;	//a.b.cϼa.b־ϼrootֻLoggerManager
+		std::vector<Logger*> m_children;
 		//LogEvent::ptr	
 	};
 
+	inline bool LogCallSite::isEnabled(const Logger& logger, LogLevel::Level level)
+	{
+		uint64_t key = logger.getSiteKey() | ((uint64_t)level & 7) << 1;
+		uint64_t cached = m_enabled.load(std::memory_order_relaxed);
+		if ((cached >> 1) == (key >> 1))
+		{
+			return cached & 1;
+		}
+		return updateEnabled(logger, level);
+	}
+
+	struct LogCompressor;
+
+	//ļappender
+	class FileLogAppender : public LogAppender
+	{
+	public:
+		typedef std::shared_ptr<FileLogAppender> ptr;
+
+		//첽ģʽǰ̨дʱĴ
+		enum OverflowPolicy {
+			BLOCK = 0,	//д־ֱ̨̣߳߳̽־
+			DROP = 1	//ֱӶ־´ˢʱдһʾ
+		};
+
+		//ʱڣʱ/з
+		enum RollInterval {
+			ROLL_NONE = 0,
+			ROLL_HOURLY = 1,
+			ROLL_DAILY = 2
+		};
+
+		//ļԣmax_sizeintervalûʱ
+		//ʱǰļΪ ļ.YYYYmmdd-HHMMSS(ļʼдʱ)½ͬļ
+		struct RollPolicy
+		{
+			uint64_t max_size = 0;	//ǰļֽʱ
+			RollInterval interval = ROLL_NONE;
+			uint32_t max_files = 0;	//ʷļ0ʾɾ
+			bool preallocate = true;	//ļfallocateԤmax_sizeֽ
+			bool enabled() const { return max_size || interval != ROLL_NONE; }
+		};
+
+		//ʽѹÿдļһѹһgzip member
+		//׼(zcatgzip -dc)ֱӽѹβӵĿ飬̱ʱһ顣
+		//ѹں̨ˢ̰߳ѹappender첽ģʽ(ʱĬϲٵsetAsync)
+		//gzipzlib.hʱԶ
+		enum Compression {
+			COMPRESS_NONE = 0,
+			COMPRESS_GZIP = 1
+		};
+
+		//ʱļ(־ļ + ".idx")һֽļĶ顣
+		//offsetʼ־ʱΪtime_usoffset֮ǰ־ʱ䶼(̼߳΢뼶)
+		struct IndexEntry
+		{
+			uint64_t time_us;
+			uint64_t offset;
+		};
+
+		//̲ԣдļʲôʱfdatasync첽ģʽˢ߳дһͬ
+		//һ־һfdatasync(ύ)
+		enum SyncPolicy {
+			SYNC_NONE = 0,	//ͬϵͳ
+			SYNC_INTERVAL = 1,	//ϴͬsync_intervalʱд굱ǰһͬ
+			SYNC_FATAL = 2	//дFATAL־ͬдFATAL̵߳ȵͬɲŷ
+		};
+
+		//дļͳƣ첽ģʽһֻһwritev
+		struct FlushStats
+		{
+			uint64_t flushes = 0;	//writev
+			uint64_t bytes = 0;	//дֽ(ѹ)
+			uint64_t syncs = 0;	//ɹfdatasync
+			uint64_t sync_ns = 0;	//fdatasyncܺʱ
+			uint64_t max_sync_ns = 0;	//fdatasyncʱ
+		};
+
+		struct CompressStats
+		{
+			uint64_t raw_bytes = 0;	//ѹǰ
+			uint64_t compressed_bytes = 0;	//ѹ󣬼ʵдļֽ
+			uint64_t blocks = 0;
+			uint64_t cpu_ns = 0;	//ѹķѵ߳CPUʱ
+		};
+
+		void log(Logger::ptr logger, LogLevel::Level level, LogEvent::ptr event) override;
+		void logRendered(Logger::ptr logger, LogLevel::Level level, LogEvent::ptr event,
+			const char* data, size_t len) override;
+		bool usesRendered() const override { return true; }
+		FileLogAppender(const std::string &filename);
+		//дѾ򿪵(ڲdupһ)reopenʲôҲStdoutLogAppenderģʽʹ
+		explicit FileLogAppender(int fd);
+		//compress_levelС0ʱøѹ㷨Ĭϼ𣻲ֵ֧ѹʽ󰴲ѹ
+		//ѹʱͬʱ첽ģʽ1MBˢ̼1000
+		FileLogAppender(const std::string& filename, const RollPolicy& roll,
+			Compression compress = COMPRESS_NONE, int compress_level = -1);
+		~FileLogAppender();
+		//´ļļ򿪳ɹtrue
+		//ʱ׷ӵԭļĩβģʽȰѷǿյԭļ鵵
+		virtual bool reopen();
+		std::string toYamlString() override;
+		const RollPolicy& getRollPolicy() const { return m_roll; }
+		static RollInterval RollIntervalFromString(const std::string& str);
+		static const char* RollIntervalToString(RollInterval interval);
+
+		//첽˫ģʽbuffer_sizeΪֽflush_intervalΪˢ̼()
+		void setAsync(size_t buffer_size, uint32_t flush_interval, OverflowPolicy policy = BLOCK);
+		bool isAsync() const { return m_async; }
+		size_t getBufferSize() const { return m_bufferSize; }
+		uint32_t getFlushInterval() const { return m_flushInterval; }
+		OverflowPolicy getOverflowPolicy() const { return m_overflow; }
+		static OverflowPolicy OverflowFromString(const std::string& str);
+		static const char* OverflowToString(OverflowPolicy policy);
+
+		//ʱÿrecordsÿinterval_ms(־ʱ)һΪ0ʱرա
+		//־ļһ(鵵 + ".idx")ֲֻ֧ѹı־Ҫڴ־֮ǰ
+		bool setTimeIndex(uint32_t records, uint32_t interval_ms);
+		//ȡ־ʱ[begin_us, end_us)ڵдosֻеһ(mmap)
+		//ɨļȡǰܸһ־
+		static bool ExtractTimeRange(const std::string& filename, uint64_t begin_us, uint64_t end_us, std::ostream& os);
+
+		//interval_msֻSYNC_INTERVALЧΪ0ʱ1000
+		void setSyncPolicy(SyncPolicy policy, uint32_t interval_ms = 0);
+		SyncPolicy getSyncPolicy() const { return m_syncPolicy; }
+		uint32_t getSyncInterval() const { return m_syncInterval; }
+		FlushStats getFlushStats();
+		static SyncPolicy SyncPolicyFromString(const std::string& str);
+		static const char* SyncPolicyToString(SyncPolicy policy);
+
+		Compression getCompression() const { return m_compress; }
+		CompressStats getCompressStats();
+		static bool IsCompressionSupported(Compression compress);
+		static Compression CompressionFromString(const std::string& str);
+		static const char* CompressionToString(Compression compress);
+	protected:
+		//дһѾȾõݣͬģʽֱдļ첽ģʽ׷ӵǰ̨
+		//time_us־ʱ䣬ʱʱ0ʾ
+		//syncΪtrueʱfdatasync֮ŷأSYNC_FATAL
+		//falseʾDROP±
+		bool write(const char* data, size_t len, uint64_t time_us = 0, bool sync = false);
+		//һ־ǷҪͬ
+		bool needSync(LogLevel::Level level) const { return m_syncPolicy == SYNC_FATAL && level >= LogLevel::FATAL; }
+		//DROPµĶʾˢ̺߳һһд
+		virtual std::string droppedNotice(uint64_t dropped);
+		//m_fileMutexʱãÿδļ()дļͷҪ
+		virtual void onOpen() {}
+		//m_fileMutexʱãֱдļһwritevд(޸iov)
+		//ѹʱÿѹһд
+		void writeFile(struct iovec* iov, int count);
+		void writeFile(const char* data, size_t len);
+		void stopAsync();
+	private:
+		//ʱļ֮Ĺ(Ԥ䡢رվļɾļ)ŵ
+		struct RollResult
+		{
+			int old_fd = -1;
+			bool trim = false;	//ļѹ鵵صԤ䵫ûõĿռ
+			int prealloc_fd = -1;
+			uint64_t prealloc_size = 0;
+			std::vector<std::string> expired;
+			bool sync = false;	//ļرǰfdatasync
+		};
+		void flushThread();//̨ˢ̣߳ǰ̨дļ
+		//־ǷҪͬģʽm_fileMutex첽ģʽm_mutexʱ
+		bool needIndex(uint64_t time_us);
+		//³m_fileMutexʱ
+		bool openLocked(RollResult& r);
+		void openIndexLocked();
+		void archiveLocked(RollResult& r, time_t start);
+		//marksoffsetdataͷƫƣдݺĳļƫд
+		//noticeǿʱdataһд
+		void writeLocked(const char* data, size_t len, RollResult& r, IndexEntry* marks = nullptr, size_t count = 0,
+			const std::string& notice = std::string());
+		//̲ҪʱfdatasyncforceΪtrueʱֻҪûͬݾͬ
+		void syncLocked(bool force);
+		static void FinishRoll(RollResult& r);
+	protected:
+		std::string m_filename;
+		int m_fd = -1;
+		std::mutex m_fileMutex; //m_fd״̬
+
+		RollPolicy m_roll;
+		uint64_t m_fileSize = 0;	//ǰļдֽ
+		time_t m_segmentStart = 0;	//ǰļʼдʱ
+		time_t m_nextRoll = 0;	//ʱһʱ
+		std::deque<std::string> m_segments;	//ѹ鵵ļӾɵ
+		Compression m_compress = COMPRESS_NONE;
+		int m_compressLevel = -1;
+		std::unique_ptr<LogCompressor> m_compressor;	//m_fileMutex
+		CompressStats m_compressStats;	//m_fileMutex
+
+		bool m_index = false;	//Ƿʱ
+		uint32_t m_indexRecords = 0;
+		uint32_t m_indexInterval = 0;	//
+		uint32_t m_sinceIndex = 0;	//һ֮д˼
+		uint64_t m_lastIndex = 0;	//һʱ
+		int m_indexFd = -1;	//m_fileMutex
+		bool m_adopted = false;	//ɹ캯룬ûļ
+
+		SyncPolicy m_syncPolicy = SYNC_NONE;
+		uint32_t m_syncInterval = 1000;	//
+		bool m_unsynced = false;	//д뵫ûͬݣm_fileMutex
+		uint64_t m_lastSync = 0;	//ϴͬʱ(΢)m_fileMutex
+		FlushStats m_flushStats;	//m_fileMutex
+
+		bool m_async = false;
+		bool m_stop = false;
+		size_t m_bufferSize = 0;
+		uint32_t m_flushInterval = 0;
+		OverflowPolicy m_overflow = BLOCK;
+		uint64_t m_dropped = 0; //DROP±־
+		std::string m_front;	//ǰ̨д־߳׷
+		std::string m_back;		//̨ˢ߳дļ
+		std::vector<IndexEntry> m_frontIndex;	//ǰ̨Ҫ־offsetԻͷ
+		std::vector<IndexEntry> m_backIndex;
+		std::mutex m_mutex;	//ǰ̨״̬
+		std::condition_variable m_cond; //ˢ߳
+		std::condition_variable m_notFull; //BLOCK»ѵȴд־߳
+		uint64_t m_flushSeq = 0;	//ˢ߳ȡߵκ
+		uint64_t m_syncedSeq = 0;	//Ѿͬκ
+		bool m_syncPending = false;	//ǰ̨еͬ־
+		std::condition_variable m_synced;	//SYNC_FATAL»ѵͬд־߳
+		std::thread m_thread;
+	};
+
 	//̨appender
+	//Ĭÿ־дstd::coutģʽ־Ƚܹһʱһwritevд׼
+	//پstd::coutͳstd::cout֮Ⱥ˳ٱ֤
 	class StdoutLogAppender : public LogAppender
 	{
 	public:
 		typedef std::shared_ptr<StdoutLogAppender> ptr;
 		void log(Logger::ptr logger, LogLevel::Level level, LogEvent::ptr event) override;
+		void logRendered(Logger::ptr logger, LogLevel::Level level, LogEvent::ptr event,
+			const char* data, size_t len) override;
+		bool usesRendered() const override { return true; }
 		std::string toYamlString() override;
+		//ͬFileLogAppender::setAsyncҪڴ־֮ǰ
+		void setAsync(size_t buffer_size, uint32_t flush_interval,
+			FileLogAppender::OverflowPolicy policy = FileLogAppender::BLOCK);
+		bool isAsync() const { return m_batch != nullptr; }
+		//׼ն˻ܵʱfdatasyncʧܣͳ
+		void setSyncPolicy(FileLogAppender::SyncPolicy policy, uint32_t interval_ms = 0);
+		FileLogAppender::FlushStats getFlushStats();
 	private:
+		FileLogAppender::ptr m_batch;	//ģʽд׼첽FileLogAppender
+		FileLogAppender::SyncPolicy m_syncPolicy = FileLogAppender::SYNC_NONE;
+		uint32_t m_syncInterval = 1000;
 	};
 
-	//ļappender
-	class FileLogAppender : public LogAppender
+	//־appender
+	//κıʽÿ־ֻдõid־idlevelʱ䡢߳/Эidԭʼ
+	//õ(ļкšʽ)־ļһγʱдһζ塣
+	//log_decoderLogFormatter patternԭıдļFileLogAppenderͬ/첽߼
+	//
+	//ļʽ(С)ļͷ "CCHBLOG\0" + u32汾֮ļ¼ļ׷Ӵ򿪣
+	//ÿδдһļͷ֮ļ¼ԳһΣõ־idֻڶЧ
+	//  ¼ = u8 + u32س + أַΪ u32 + 
+	//  SITE   : u32 site_id, i32 line, str file, str fmt(ʽ־Ϊ)
+	//  LOGGER : u32 logger_id, str name
+	//  EVENT  : u32 site_id(0ʾûеõ), u32 logger_id, u8 level, u8 flags, u64 time_us,
+	//           u32 thread_id, u32 fiber_id, u32 elapse, [site_idΪ0ʱ: i32 line, str file]
+	//           ֮󵽼¼ĩβ: flags&1 ? SITE.fmtĲ : ı
+	class BinaryLogAppender : public FileLogAppender
 	{
 	public:
-		typedef std::shared_ptr<FileLogAppender> ptr;
+		typedef std::shared_ptr<BinaryLogAppender> ptr;
+		enum RecordType {
+			RECORD_SITE = 1,
+			RECORD_LOGGER = 2,
+			RECORD_EVENT = 3
+		};
+		enum { EVENT_FLAG_ARGS = 1 };
+		static const char MAGIC[8];
+		static const uint32_t VERSION = 1;
+
+		BinaryLogAppender(const std::string& filename, const RollPolicy& roll = RollPolicy(),
+			Compression compress = COMPRESS_NONE, int compress_level = -1);
+		~BinaryLogAppender();
 		void log(Logger::ptr logger, LogLevel::Level level, LogEvent::ptr event) override;
-		FileLogAppender(const std::string &filename);
-		bool reopen();//´ļļ򿪳ɹtrue
+		//ʹıȾ
+		bool usesRendered() const override { return false; }
+		std::string toYamlString() override;
+		//дıǺͻ棬ļд
+		bool reopen() override;
+
+		//Ѷ־ļformatterԭıдosļڻʽʱfalse
+		static bool Decode(const std::string& filename, std::ostream& os, LogFormatter::ptr formatter);
+	protected:
+		std::string droppedNotice(uint64_t dropped) override;
+		//ÿļļͷʼдеȫ壬ÿļԵ
+		void onOpen() override;
+	private:
+		enum {
+			MAX_SITES = 65536,	//ĵõidÿζд
+			MAX_LOGGERS = 4096
+		};
+		//ȷõ־ĶѾдļдλ߳̿λʱһѾǰ档
+		//첽ģʽ¶屻ʱλfalseһ־д
+		bool define(LogCallSite* site, const Logger::ptr& logger);
+		//沢дһ壬Ƿдɹ
+		bool writeDefine(const char* data, size_t len);
+	private:
+		std::mutex m_defineMutex;
+		std::mutex m_cacheMutex;	//ֻm_definesonOpenm_fileMutexʱҲ
+		std::string m_defines;	//дȫ¼
+		std::unique_ptr<std::atomic<bool>[]> m_sites;
+		std::unique_ptr<std::atomic<bool>[]> m_loggers;
+	};
+
+	//дڴӳļappender
+	//־д ļ.000000ļ.000001 ... һ̶СĶд־߳һԭ
+	//fetch_addԤռֱmemcpyӳwriteں˻дҳ̱ʱ
+	//Ѿ־ҳᶪǰдʱԤԽβǸ̸߳лһΣ
+	//Ⱦɶεдȫɺļصʵʳٽӳ䡣
+	//̱ʱһĩβ'\0'䣬ܼԤ˵ûĿն
+	//¶δ򲻿()ʱдľɶΣڼ־֮ÿһΣʧֻһ
+	class MmapLogAppender : public LogAppender
+	{
+	public:
+		typedef std::shared_ptr<MmapLogAppender> ptr;
+		enum {
+			MIN_SEGMENT_SIZE = 64 * 1024,	//ٷŵ¼־
+			DEFAULT_SEGMENT_SIZE = 64 * 1024 * 1024
+		};
+
+		MmapLogAppender(const std::string& filename, size_t segment_size = DEFAULT_SEGMENT_SIZE);
+		~MmapLogAppender();
+		void log(Logger::ptr logger, LogLevel::Level level, LogEvent::ptr event) override;
+		void logRendered(Logger::ptr logger, LogLevel::Level level, LogEvent::ptr event,
+			const char* data, size_t len) override;
+		bool usesRendered() const override { return true; }
 		std::string toYamlString() override;
+		size_t getSegmentSize() const { return m_segmentSize; }
+	private:
+		struct Segment;
+		Segment* openSegment(uint32_t seq);
+		//m_openMutexãϴʧܲһʱֱӷnullptr
+		Segment* tryOpenSegment(uint32_t seq);
+		//segѾǵǰΣend֮ǰд붼ɺضļӳ
+		void closeSegment(Segment* seg, uint64_t end);
+		//Ԥ[off, off + len)ԽsegĶβлһΡ
+		//¶δ򲻿ʱsegԤλ˻صofffalseɹʱsegɵ÷ڶٽRetire
+		bool rollover(Segment* seg, uint64_t off);
+		void append(const char* data, size_t len);
+		//ڶٽ׷һΣд󷵻trueл˶ʱfalseretiredΪľɶ
+		bool tryAppend(const char* data, size_t len, Segment*& retired);
+	private:
+		std::string m_filename;
+		size_t m_segmentSize;
+		std::atomic<Segment*> m_current;
+		std::mutex m_openMutex;	//л¶
+		uint32_t m_firstSeq;	//ʱһû򿪣֮κ
+		uint64_t m_retryTime;	//ʧܺһԵʱ(΢)
+		bool m_openFailed;	//Ѿʧܣָ֮ǰظ
+	};
+
+	struct FlightRing;
+
+	//м¼appenderʱֳ
+	//ÿ߳һ̶СĻλֻcapacity־¼ʱֻ¼ԭʼֶκ
+	//δʽĲȾϵͳãֻڼ¼FATAL־dump()
+	//յSIGSEGV/SIGABRTʱŰ̵߳Ļ̶ʽ׷дļ
+	//־levelƣ־INFOʱDEBUG
+	//źŴﲻڴ棬תָԭĴʽ·ź
+	class FlightRecorderLogAppender : public LogAppender
+	{
+	public:
+		typedef std::shared_ptr<FlightRecorderLogAppender> ptr;
+		enum {
+			DEFAULT_CAPACITY = 256,	//ÿ̱߳
+			KEEP_RINGS = 64,	//ﵽ̸֮߳˳̵߳Ļ
+			MAX_RINGS = 1024	//ͬʱ¼̲߳߳¼
+		};
+
+		FlightRecorderLogAppender(const std::string& filename, uint32_t capacity = DEFAULT_CAPACITY);
+		~FlightRecorderLogAppender();
+		void log(Logger::ptr logger, LogLevel::Level level, LogEvent::ptr event) override;
+		bool ignoreLoggerLevel() const override { return true; }
+		std::string toYamlString() override;
+		uint32_t getCapacity() const { return m_capacity; }
+		//̻߳־׷дļreasonдתĿͷ
+		//in_signalΪtrueʱֻдԭʼֶ(ʱʽʮƵĲ)ʽźŴ
+		void dump(const char* reason, bool in_signal = false);
+	private:
+		//ȡǰ߳ڱ¼Ļһεʱ߸˳߳µ
+		FlightRing* ring();
+		static void InstallSignalHandlers();
+		static void OnSignal(int sig);
 	private:
 		std::string m_filename;
-		std::ofstream m_filestream;
+		uint32_t m_capacity;
+		uint64_t m_id;	//Ψһ̻߳水һ(ַܱ)
+		std::mutex m_mutex;	//ֻ仺
+		std::unique_ptr<std::atomic<FlightRing*>[]> m_rings;
+		std::atomic<uint32_t> m_ringCount;
+		std::atomic<bool> m_dumping;	//ֹFATALתźת
 	};
 
+	//ƹ־.ּ(system.net.http)ڵϼһ𴴽
 	class LoggerManager
 	{
 	public:
 		LoggerManager();
+		//̰߳ȫÿζҪ·CCH_LOG_NAME_CACHED
 		Logger::ptr getLogger(const std::string& name);
 		void init();
-		Logger::ptr getRoot() const { return m_root; };
+		const Logger::ptr& getRoot() const { return m_root; };
 		std::string toYamlString();
 	private:
+		//ʱm_mutex
+		Logger::ptr create(const std::string& name);
+	private:
+		std::mutex m_mutex;
 		std::map<std::string, Logger::ptr> m_logger;
 		Logger::ptr m_root;
 	};
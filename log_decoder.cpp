@@ -0,0 +1,23 @@
+#include "log.h"
+#include <stdio.h>
+
+//BinaryLogAppenderдĶ־ԭı
+//÷: log_decoder <file> [pattern]׼
+
+int main(int argc, char** argv)
+{
+	if (argc < 2)
+	{
+		std::cout << "usage: " << argv[0] << " <file> [pattern]" << std::endl;
+		return 1;
+	}
+	std::string pattern = argc > 2 ? argv[2] : "%d{%Y-%m-%d %H:%M:%S.%6N}%T%t%T%F%T[%p]%T[%c]%T%f:%l%T%m%n";
+	cch::LogFormatter::ptr formatter(new cch::LogFormatter(pattern));
+	if (formatter->isError())
+	{
+		std::cout << "invalid pattern: " << pattern << std::endl;
+		return 1;
+	}
+	std::ios::sync_with_stdio(false);
+	return cch::BinaryLogAppender::Decode(argv[1], std::cout, formatter) ? 0 : 1;
+}
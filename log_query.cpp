@@ -0,0 +1,47 @@
+#include "log.h"
+#include <stdio.h>
+#include <time.h>
+
+//FileLogAppenderдʱ(־ļ.idx)ȡһʱڵ־ɨļ
+//÷: log_query <file> <begin> <end>׼
+//ʱ "YYYY-mm-dd HH:MM:SS"(ʱ)unixȡ[begin, end)
+//ȡǰܸһ־
+
+static bool ParseTime(const char* str, uint64_t& us)
+{
+	struct tm tm;
+	memset(&tm, 0, sizeof(tm));
+	const char* end = strptime(str, "%Y-%m-%d %H:%M:%S", &tm);
+	if (end && !*end)
+	{
+		tm.tm_isdst = -1;
+		us = (uint64_t)mktime(&tm) * 1000000;
+		return true;
+	}
+	char* p = nullptr;
+	unsigned long long sec = strtoull(str, &p, 10);
+	if (p != str && !*p)
+	{
+		us = sec * 1000000;
+		return true;
+	}
+	return false;
+}
+
+int main(int argc, char** argv)
+{
+	if (argc < 4)
+	{
+		std::cout << "usage: " << argv[0] << " <file> <begin> <end>" << std::endl;
+		return 1;
+	}
+	uint64_t begin = 0;
+	uint64_t end = 0;
+	if (!ParseTime(argv[2], begin) || !ParseTime(argv[3], end))
+	{
+		std::cout << "invalid time, use \"YYYY-mm-dd HH:MM:SS\" or unix seconds" << std::endl;
+		return 1;
+	}
+	std::ios::sync_with_stdio(false);
+	return cch::FileLogAppender::ExtractTimeRange(argv[1], begin, end, std::cout) ? 0 : 1;
+}
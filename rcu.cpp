@@ -0,0 +1,152 @@
+#include "rcu.h"
+#include <list>
+#include <vector>
+#include <mutex>
+#include <thread>
+#include <memory>
+
+namespace cch
+{
+	//ÿ߳һĶ߲λepochΪ0ʾٽ
+	//дߵȴʱŲλshared_ptr߳˳λҪдͷ
+	struct RcuReader
+	{
+		std::atomic<uint64_t> epoch;
+		uint32_t nest = 0;
+		RcuReader() :epoch(0) {}
+	};
+
+	struct RcuDomain
+	{
+		std::mutex mutex;	//ֻreadersڵȴʱ
+		std::mutex pendingMutex;	//ֻpendingڵȴʱ
+		std::atomic<uint64_t> epoch;
+		std::list<std::shared_ptr<RcuReader> > readers;
+		std::vector<std::function<void()> > pending;
+
+		RcuDomain() :epoch(1) {}
+		~RcuDomain()
+		{
+			for (auto& i : pending)
+			{
+				i();
+			}
+		}
+
+		static RcuDomain* GetInstance()
+		{
+			static RcuDomain s_domain;
+			return &s_domain;
+		}
+
+		//ȴʼʱѾٽĶȫ뿪selfΪ߳ԼĲλ(ȴ)
+		//κбȿһݳȴڼдߺٽRetireĶ߶ᱻס
+		void waitReaders(RcuReader* self)
+		{
+			uint64_t target = epoch.fetch_add(1, std::memory_order_seq_cst) + 1;
+			std::vector<std::shared_ptr<RcuReader> > snapshot;
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				snapshot.assign(readers.begin(), readers.end());
+			}
+			for (auto& r : snapshot)
+			{
+				if (r.get() == self)
+				{
+					continue;
+				}
+				while (true)
+				{
+					uint64_t e = r->epoch.load(std::memory_order_seq_cst);
+					if (e == 0 || e >= target)
+					{
+						break;
+					}
+					std::this_thread::yield();
+				}
+			}
+		}
+
+		//ȴںͷŹľݡȡpendingٵȴȡĶǵȴʼǰѾժ
+		void reclaim(RcuReader* self)
+		{
+			std::vector<std::function<void()> > todo;
+			{
+				std::lock_guard<std::mutex> lock(pendingMutex);
+				todo.swap(pending);
+			}
+			waitReaders(self);
+			for (auto& i : todo)
+			{
+				i();
+			}
+		}
+	};
+
+	//̵߳һνٽʱעλ˳ʱע
+	struct RcuReaderSlot
+	{
+		std::shared_ptr<RcuReader> reader;
+		RcuReaderSlot()
+			:reader(std::make_shared<RcuReader>())
+		{
+			RcuDomain* d = RcuDomain::GetInstance();
+			std::lock_guard<std::mutex> lock(d->mutex);
+			d->readers.push_back(reader);
+		}
+		~RcuReaderSlot()
+		{
+			RcuDomain* d = RcuDomain::GetInstance();
+			std::lock_guard<std::mutex> lock(d->mutex);
+			d->readers.remove(reader);
+		}
+	};
+
+	static thread_local RcuReaderSlot t_slot;
+
+	Rcu::ReadGuard::ReadGuard()
+	{
+		RcuReader& r = *t_slot.reader;
+		if (r.nest++ == 0)
+		{
+			r.epoch.store(RcuDomain::GetInstance()->epoch.load(std::memory_order_relaxed), std::memory_order_seq_cst);
+		}
+	}
+
+	Rcu::ReadGuard::~ReadGuard()
+	{
+		RcuReader& r = *t_slot.reader;
+		if (--r.nest == 0)
+		{
+			r.epoch.store(0, std::memory_order_release);
+		}
+	}
+
+	void Rcu::Retire(std::function<void()> deleter)
+	{
+		RcuDomain* d = RcuDomain::GetInstance();
+		//ȡλ״ʹʱעҪ
+		RcuReader* self = t_slot.reader.get();
+		{
+			std::lock_guard<std::mutex> lock(d->pendingMutex);
+			d->pending.push_back(std::move(deleter));
+		}
+		//ٽﲻܵȴһRetireSynchronize
+		if (self->nest)
+		{
+			return;
+		}
+		d->reclaim(self);
+	}
+
+	void Rcu::Synchronize()
+	{
+		RcuDomain* d = RcuDomain::GetInstance();
+		RcuReader* self = t_slot.reader.get();
+		if (self->nest)
+		{
+			return;
+		}
+		d->reclaim(self);
+	}
+}
@@ -0,0 +1,60 @@
+#pragma once
+#ifndef __CCH_RCU_H__
+#define __CCH_RCU_H__
+
+#include<atomic>
+#include<functional>
+
+namespace cch
+{
+	//epochRCU
+	//߽/뿪ٽֻд̵߳epochλ
+	//д߷ݺȴпܻڶݵĶ뿪ͷž
+	class Rcu
+	{
+	public:
+		//ٽǶףٽõRcuPtr::get()ָ뿪ǰһֱЧ
+		class ReadGuard
+		{
+		public:
+			ReadGuard();
+			~ReadGuard();
+			ReadGuard(const ReadGuard&) = delete;
+			ReadGuard& operator=(const ReadGuard&) = delete;
+		};
+
+		//ȴڽdeleterͷžݣȴڼ䲻κ
+		//߳ԼڶٽʱܵȴȹһRetireSynchronizeʱͷ
+		static void Retire(std::function<void()> deleter);
+		//ȴڲͷйľ
+		static void Synchronize();
+	};
+
+	//RCUָ룬д١Rcu::ReadGuardڵget()дreset()滻
+	template<class T>
+	class RcuPtr
+	{
+	public:
+		explicit RcuPtr(T* p = nullptr) :m_ptr(p) {}
+		~RcuPtr() { delete m_ptr.load(std::memory_order_relaxed); }
+		RcuPtr(const RcuPtr&) = delete;
+		RcuPtr& operator=(const RcuPtr&) = delete;
+
+		//Rcu::ReadGuardʹ
+		T* get() const { return m_ptr.load(std::memory_order_acquire); }
+
+		//ݣڿںͷšд֮Ҫ÷Լ
+		void reset(T* p)
+		{
+			T* old = m_ptr.exchange(p, std::memory_order_seq_cst);
+			if (old)
+			{
+				Rcu::Retire([old]() { delete old; });
+			}
+		}
+	private:
+		std::atomic<T*> m_ptr;
+	};
+}
+
+#endif // !__CCH_RCU_H__
@@ -0,0 +1,2149 @@
+#include "log.h"
+#include "config.h"
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <stdlib.h>
+#include <algorithm>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <signal.h>
+#include <fstream>
+#include <cmath>
+#include <fcntl.h>
+#include <sys/mman.h>
+
+//滻mallocϵкͳƶѷoperator newҲmalloc
+extern "C" void* __libc_malloc(size_t size);
+extern "C" void* __libc_calloc(size_t n, size_t size);
+extern "C" void* __libc_realloc(void* ptr, size_t size);
+
+static std::atomic<uint64_t> s_malloc_count(0);
+static bool s_counting = false;
+
+extern "C" void* malloc(size_t size)
+{
+	if (s_counting)
+		++s_malloc_count;
+	return __libc_malloc(size);
+}
+
+extern "C" void* calloc(size_t n, size_t size)
+{
+	if (s_counting)
+		++s_malloc_count;
+	return __libc_calloc(n, size);
+}
+
+extern "C" void* realloc(void* ptr, size_t size)
+{
+	if (s_counting)
+		++s_malloc_count;
+	return __libc_realloc(ptr, size);
+}
+
+//ʱִһ־֤Ƕʱ߳˽лụา
+struct NestedLog
+{
+	cch::Logger::ptr logger;
+};
+
+std::ostream& operator<<(std::ostream& os, const NestedLog& v)
+{
+	CCH_LOG_INFO(v.logger) << "inner";
+	return os << "outer";
+}
+
+//ȶ״̬ÿ־ĶѷӦΪ0
+bool test_log_no_alloc()
+{
+	cch::Logger::ptr logger(new cch::Logger("alloc_test"));
+	logger->setFormatter("%d{%Y-%m-%d %H:%M:%S}%T%t%T%F%T[%p]%T[%c]%T%f:%l%T%m%n");
+	logger->addAppender(cch::LogAppender::ptr(new cch::FileLogAppender("/dev/null")));
+	cch::FileLogAppender::ptr async_appender(new cch::FileLogAppender("/dev/null"));
+	async_appender->setAsync(1024 * 1024, 100);
+	logger->addAppender(async_appender);
+	cch::BinaryLogAppender::ptr binary_appender(new cch::BinaryLogAppender("/dev/null"));
+	binary_appender->setAsync(1024 * 1024, 100);
+	logger->addAppender(binary_appender);
+
+	const int N = 10000;
+	std::string str = "a string longer than the small string buffer";
+	//õһִʱԤʽԤȺͼͬһõ
+	auto body = [&](int i) {
+		CCH_LOG_INFO(logger) << "stream " << i << " " << 1.5 << " " << str << std::hex << i;
+		CCH_LOG_FMT_INFO(logger, "fmt %d %s %f", i, str.c_str(), 1.5);
+		CCH_LOG_PRINT_INFO(logger, "print {} {} {:.3f} {:x}", i, str, 1.5, i);
+		CCH_LOG_DEBUG(logger) << "nested " << NestedLog{logger};
+		CCH_LOG_EVERY_N(logger, cch::LogLevel::WARN, 7) << "limited " << i;
+	};
+	for (int i = 0; i < 100; ++i)
+	{
+		body(i);
+	}
+
+	s_malloc_count = 0;
+	s_counting = true;
+	for (int i = 0; i < N; ++i)
+	{
+		body(i);
+	}
+	s_counting = false;
+
+	uint64_t count = s_malloc_count;
+	std::cout << "test_log_no_alloc: " << count << " mallocs for " << N * 6 << " log calls" << std::endl;
+	return count == 0;
+}
+
+//16̳߳־ͬʱ̷߳־ã鲻һ־
+//ÿμضһļ´ͬļʱض
+bool test_log_reload_stress()
+{
+	const int THREADS = 16;
+	const int RELOADS = 200;
+	cch::Logger::ptr logger = CCH_LOG_NAME("stress");
+	std::atomic<bool> stop(false);
+	std::atomic<uint64_t> total(0);
+
+	auto load = [](int idx) {
+		std::stringstream ss;
+		ss << "logs:\n"
+			<< "  - name: stress\n"
+			<< "    level: " << (idx % 2 ? "info" : "debug") << "\n"
+			<< "    formatter: \"" << (idx % 3 ? "%m%n" : "%p %m%n") << "\"\n"
+			<< "    appenders:\n"
+			<< "      - type: FileLogAppender\n"
+			<< "        file: stress_" << idx << ".log\n"
+			<< "        async: " << (idx % 2 ? "true" : "false") << "\n"
+			<< "      - type: FileLogAppender\n"
+			<< "        file: stress_" << idx << "_copy.log\n";
+		cch::Config::LoadFromYaml(YAML::Load(ss.str()));
+	};
+
+	load(0);
+	std::vector<std::thread> threads;
+	for (int t = 0; t < THREADS; ++t)
+	{
+		threads.emplace_back([&, t]() {
+			uint64_t n = 0;
+			while (!stop)
+			{
+				CCH_LOG_INFO(logger) << "thread " << t << " seq " << n++;
+			}
+			total += n;
+		});
+	}
+	for (int i = 1; i <= RELOADS; ++i)
+	{
+		load(i);
+	}
+	stop = true;
+	for (auto& i : threads)
+	{
+		i.join();
+	}
+	//дһݿãͷŲˢһappender
+	cch::Config::LoadFromYaml(YAML::Load("logs: []"));
+	cch::Rcu::Synchronize();
+
+	uint64_t lines = 0;
+	uint64_t copy_lines = 0;
+	for (int i = 0; i <= RELOADS; ++i)
+	{
+		std::string name = "stress_" + std::to_string(i);
+		std::ifstream ifs(name + ".log");
+		std::string line;
+		while (std::getline(ifs, line))
+			++lines;
+		std::ifstream copy(name + "_copy.log");
+		while (std::getline(copy, line))
+			++copy_lines;
+		remove((name + ".log").c_str());
+		remove((name + "_copy.log").c_str());
+	}
+	std::cout << "test_log_reload_stress: logged=" << total << " file_lines=" << lines
+		<< " copy_lines=" << copy_lines << std::endl;
+	return lines == total && copy_lines == total;
+}
+
+//log()appenderģ⻺ȴfdatasync
+class BlockingLogAppender : public cch::LogAppender
+{
+public:
+	typedef std::shared_ptr<BlockingLogAppender> ptr;
+	void log(cch::Logger::ptr /*logger*/, cch::LogLevel::Level /*level*/, cch::LogEvent::ptr /*event*/) override
+	{
+		m_entered = true;
+		while (!m_release)
+		{
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+	}
+	std::string toYamlString() override { return ""; }
+
+	std::atomic<bool> m_entered{false};
+	std::atomic<bool> m_release{false};
+};
+
+//appenderʱ־ܸãlog()appenderʱѾ뿪ٽд߲õ
+bool test_log_blocking_appender()
+{
+	cch::Logger::ptr slow(new cch::Logger("blocking_test"));
+	cch::Logger::ptr other(new cch::Logger("blocking_other"));
+	BlockingLogAppender::ptr blocking(new BlockingLogAppender);
+	slow->addAppender(blocking);
+	std::thread logger_thread([slow]() {
+		CCH_LOG_INFO(slow) << "blocked";
+	});
+	while (!blocking->m_entered)
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+	std::atomic<bool> done(false);
+	std::thread writer([&]() {
+		other->setLevel(cch::LogLevel::WARN);
+		slow->clearAppenders();
+		done = true;
+	});
+	for (int i = 0; i < 5000 && !done; ++i)
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+	bool ok = done;
+	blocking->m_release = true;
+	logger_thread.join();
+	writer.join();
+	std::cout << "test_log_blocking_appender: " << (ok ? "ok" : "FAILED") << std::endl;
+	return ok;
+}
+
+//ٽRetireͬʱһ̲߳ͣٽRetireֻ𲻵ȴ
+//ܺڵȿڵд߻һSynchronize֮йľݶͷ
+bool test_rcu_retire_in_read()
+{
+	const int N = 20000;
+	std::atomic<int> freed(0);
+	std::atomic<bool> stop(false);
+	cch::RcuPtr<int> ptr(new int(0));
+	std::thread writer([&]() {
+		for (int i = 1; !stop; ++i)
+		{
+			ptr.reset(new int(i));
+		}
+	});
+	for (int i = 0; i < N; ++i)
+	{
+		cch::Rcu::ReadGuard guard;
+		//óCPUдٽ￪ʼȿ
+		std::this_thread::yield();
+		cch::Rcu::Retire([&freed]() { ++freed; });
+	}
+	stop = true;
+	writer.join();
+	cch::Rcu::Synchronize();
+	bool ok = freed == N;
+	std::cout << "test_rcu_retire_in_read: " << (ok ? "ok" : "FAILED") << std::endl;
+	return ok;
+}
+
+//ͬһ־ֱдıͶļļͬpatternӦıļֽͬ
+bool test_binary_roundtrip()
+{
+	const char* pattern = "%d{%Y-%m-%d %H:%M:%S.%6N}%T%t%T%F%T[%p]%T[%c]%T%f:%l%T%m%n";
+	cch::Logger::ptr logger(new cch::Logger("binary_test"));
+	logger->setFormatter(pattern);
+	logger->addAppender(cch::LogAppender::ptr(new cch::FileLogAppender("binary_test.log")));
+	cch::BinaryLogAppender::ptr binary_appender(new cch::BinaryLogAppender("binary_test.blog"));
+	binary_appender->setAsync(64 * 1024, 10);
+	logger->addAppender(binary_appender);
+
+	const char* null_str = nullptr;
+	std::string long_str(6000, 'x');
+	for (int i = 0; i < 1000; ++i)
+	{
+		CCH_LOG_FMT_INFO(logger, "int=%d neg=%-5d hex=%#x ll=%lld size=%zu 100%%", i, -i, i, (long long)i << 40, (size_t)i);
+		CCH_LOG_FMT_WARN(logger, "double=%.3f sci=%e ld=%Lf star=[%*d] [%-*.*s]", i / 7.0, i * 1e10,
+			(long double)i / 3, 6, i, 8, 3, "abcdef");
+		CCH_LOG_FMT_ERROR(logger, "str=%s null=%s char=%c ptr=%p", "hello", null_str, 'a' + i % 26, (void*)&i);
+		CCH_LOG_DEBUG(logger) << "stream " << i << " " << 1.5;
+		if (i % 100 == 0)
+		{
+			CCH_LOG_FMT_INFO(logger, "too long for args, formatted directly: %s", long_str.c_str());
+			char fmt[32];
+			snprintf(fmt, sizeof(fmt), "runtime fmt %%d/%d", i);
+			CCH_LOG_FMT_INFO(logger, fmt, i);
+		}
+	}
+	logger->clearAppenders();
+	binary_appender.reset();
+
+	std::ifstream ifs("binary_test.log");
+	std::string text((std::istreambuf_iterator<char>(ifs)), std::istreambuf_iterator<char>());
+	std::stringstream decoded;
+	bool ok = cch::BinaryLogAppender::Decode("binary_test.blog", decoded,
+		cch::LogFormatter::ptr(new cch::LogFormatter(pattern)));
+	ok = ok && decoded.str() == text;
+	std::cout << "test_binary_roundtrip: text=" << text.size() << " bytes decoded="
+		<< decoded.str().size() << " bytes " << (ok ? "match" : "MISMATCH") << std::endl;
+	remove("binary_test.log");
+	remove("binary_test.blog");
+	return ok;
+}
+
+//гdirprefixͷļ鵵˳(ͬһڵ .N ׺ֱȽ)
+static std::vector<std::string> list_files(const std::string& dir, const std::string& prefix)
+{
+	std::vector<std::string> names;
+	DIR* d = opendir(dir.c_str());
+	while (struct dirent* e = d ? readdir(d) : nullptr)
+	{
+		std::string name = e->d_name;
+		if (name.compare(0, prefix.size(), prefix) == 0)
+		{
+			names.push_back(dir + "/" + name);
+		}
+	}
+	if (d)
+	{
+		closedir(d);
+	}
+	std::sort(names.begin(), names.end(), [](const std::string& a, const std::string& b) {
+		if (a.rfind('-') == std::string::npos || b.rfind('-') == std::string::npos)
+		{
+			return a < b;
+		}
+		size_t pa = a.find('.', a.rfind('-') + 1);
+		size_t pb = b.find('.', b.rfind('-') + 1);
+		std::string sa = a.substr(0, pa);
+		std::string sb = b.substr(0, pb);
+		if (sa != sb)
+		{
+			return sa < sb;
+		}
+		return (pa == std::string::npos ? 0 : atoi(a.c_str() + pa + 1))
+			< (pb == std::string::npos ? 0 : atoi(b.c_str() + pb + 1));
+	});
+	return names;
+}
+
+//Сıļֻ3鵵ÿmax_sizeļÿһζܵ룬ƴ־
+bool test_log_rolling()
+{
+	const int N = 20000;
+	const uint64_t MAX_SIZE = 64 * 1024;
+	mkdir("roll_test", 0755);
+	for (auto& i : list_files("roll_test", ""))
+	{
+		remove(i.c_str());
+	}
+
+	//(logrotate)µͬǰ׺ļ鵵ᱻmax_filesɾ
+	const char* foreign[] = { "roll_test/text.log.1", "roll_test/text.log.20260101", "roll_test/text.log.1.gz" };
+	for (auto i : foreign)
+	{
+		std::ofstream(i) << "foreign\n";
+	}
+
+	cch::FileLogAppender::RollPolicy roll;
+	roll.max_size = MAX_SIZE;
+	roll.max_files = 3;
+	cch::Logger::ptr logger(new cch::Logger("roll_test"));
+	logger->setFormatter("%m%n");
+	logger->addAppender(cch::LogAppender::ptr(new cch::FileLogAppender("roll_test/text.log", roll)));
+	roll.max_files = 0;
+	cch::BinaryLogAppender::ptr binary_appender(new cch::BinaryLogAppender("roll_test/bin.log", roll));
+	binary_appender->setAsync(16 * 1024, 10);
+	logger->addAppender(binary_appender);
+	for (int i = 0; i < N; ++i)
+	{
+		CCH_LOG_FMT_INFO(logger, "line %d", i);
+	}
+	logger->clearAppenders();
+	binary_appender.reset();
+
+	bool ok = true;
+	for (auto i : foreign)
+	{
+		std::string line;
+		ok = ok && std::getline(std::ifstream(i), line) && line == "foreign";
+		remove(i);
+	}
+	std::vector<std::string> texts = list_files("roll_test", "text.log.");
+	texts.push_back("roll_test/text.log");
+	std::string text;
+	for (auto& i : texts)
+	{
+		struct stat st;
+		stat(i.c_str(), &st);
+		ok = ok && (uint64_t)st.st_size <= MAX_SIZE;
+		std::ifstream ifs(i);
+		text.append((std::istreambuf_iterator<char>(ifs)), std::istreambuf_iterator<char>());
+	}
+	std::string tail;
+	for (int i = N - 1; tail.size() < text.size(); --i)
+	{
+		tail.insert(0, "line " + std::to_string(i) + "\n");
+	}
+	ok = ok && texts.size() == 4 && text == tail;
+
+	std::vector<std::string> bins = list_files("roll_test", "bin.log.");
+	bins.push_back("roll_test/bin.log");
+	std::stringstream decoded;
+	cch::LogFormatter::ptr fmt(new cch::LogFormatter("%m%n"));
+	for (auto& i : bins)
+	{
+		ok = cch::BinaryLogAppender::Decode(i, decoded, fmt) && ok;
+	}
+	std::string all;
+	for (int i = 0; i < N; ++i)
+	{
+		all += "line " + std::to_string(i) + "\n";
+	}
+	ok = ok && bins.size() > 2 && decoded.str() == all;
+	std::cout << "test_log_rolling: text_files=" << texts.size() << " binary_files=" << bins.size()
+		<< " " << (ok ? "ok" : "FAILED") << std::endl;
+
+	for (auto& i : list_files("roll_test", ""))
+	{
+		remove(i.c_str());
+	}
+	rmdir("roll_test");
+	return ok;
+}
+
+//߳дСĶΣƵлÿ־سֻһΣļĩβû'\0'
+bool test_mmap_appender()
+{
+	const int THREADS = 8;
+	const int N = 20000;
+	mkdir("mmap_test", 0755);
+	for (auto& i : list_files("mmap_test", ""))
+	{
+		remove(i.c_str());
+	}
+
+	cch::Logger::ptr logger(new cch::Logger("mmap_test"));
+	logger->setFormatter("%m%n");
+	logger->addAppender(cch::LogAppender::ptr(new cch::MmapLogAppender("mmap_test/mmap.log",
+		cch::MmapLogAppender::MIN_SEGMENT_SIZE)));
+	std::vector<std::thread> threads;
+	for (int t = 0; t < THREADS; ++t)
+	{
+		threads.push_back(std::thread([logger, t]() {
+			for (int i = 0; i < N; ++i)
+			{
+				CCH_LOG_FMT_INFO(logger, "thread %d line %d", t, i);
+			}
+		}));
+	}
+	for (auto& i : threads)
+	{
+		i.join();
+	}
+	logger->clearAppenders();
+
+	std::vector<std::string> files = list_files("mmap_test", "mmap.log.");
+	std::vector<int> next(THREADS, 0);
+	bool ok = files.size() > 2;
+	for (auto& f : files)
+	{
+		std::ifstream ifs(f);
+		std::string line;
+		while (std::getline(ifs, line))
+		{
+			int t = -1;
+			int i = -1;
+			//ͬһ̵߳־˳
+			if (sscanf(line.c_str(), "thread %d line %d", &t, &i) != 2 || t < 0 || t >= THREADS || next[t] != i)
+			{
+				ok = false;
+				break;
+			}
+			++next[t];
+		}
+	}
+	for (auto n : next)
+	{
+		ok = ok && n == N;
+	}
+	std::cout << "test_mmap_appender: segments=" << files.size() << " " << (ok ? "ok" : "FAILED") << std::endl;
+
+	for (auto& i : list_files("mmap_test", ""))
+	{
+		remove(i.c_str());
+	}
+	rmdir("mmap_test");
+	return ok;
+}
+
+//Ƶлεͬʱͣ¼־ãľɶڶٽRetireͷõд߻ȴ
+bool test_mmap_rollover_reload()
+{
+	const int THREADS = 4;
+	const int N = 20000;
+	mkdir("mmap_reload", 0755);
+	for (auto& i : list_files("mmap_reload", ""))
+	{
+		remove(i.c_str());
+	}
+
+	cch::Logger::ptr logger(new cch::Logger("mmap_reload"));
+	logger->setFormatter("%m%n");
+	logger->addAppender(cch::LogAppender::ptr(new cch::MmapLogAppender("mmap_reload/mmap.log",
+		cch::MmapLogAppender::MIN_SEGMENT_SIZE)));
+	std::atomic<int> running(THREADS);
+	std::vector<std::thread> threads;
+	for (int t = 0; t < THREADS; ++t)
+	{
+		threads.push_back(std::thread([logger, t, &running]() {
+			for (int i = 0; i < N; ++i)
+			{
+				CCH_LOG_FMT_INFO(logger, "thread %d line %d", t, i);
+			}
+			--running;
+		}));
+	}
+	int reloads = 0;
+	while (running)
+	{
+		cch::Config::LoadFromYaml(YAML::Load(std::string("logs:\n  - name: mmap_reload_other\n    level: ")
+			+ (reloads++ % 2 ? "info" : "debug") + "\n"));
+	}
+	for (auto& i : threads)
+	{
+		i.join();
+	}
+	logger->clearAppenders();
+	cch::Config::LoadFromYaml(YAML::Load("logs: []"));
+
+	std::vector<std::string> files = list_files("mmap_reload", "mmap.log.");
+	size_t lines = 0;
+	for (auto& f : files)
+	{
+		std::ifstream ifs(f);
+		std::string line;
+		while (std::getline(ifs, line))
+			++lines;
+		remove(f.c_str());
+	}
+	rmdir("mmap_reload");
+	bool ok = files.size() > 2 && lines == (size_t)THREADS * N;
+	std::cout << "test_mmap_rollover_reload: segments=" << files.size() << " reloads=" << reloads
+		<< " " << (ok ? "ok" : "FAILED") << std::endl;
+	return ok;
+}
+
+//¶δ򲻿ʱɶΡ־Ӵ˲дĿ¼ָһе¶
+bool test_mmap_open_failure()
+{
+	mkdir("mmap_fail", 0755);
+	cch::Logger::ptr logger(new cch::Logger("mmap_fail"));
+	logger->setFormatter("%m%n");
+	cch::MmapLogAppender::ptr appender(new cch::MmapLogAppender("mmap_fail/m.log", cch::MmapLogAppender::MIN_SEGMENT_SIZE));
+	logger->addAppender(appender);
+	std::string pad(100, 'x');
+	//һλţɾļĿ¼л¶ʧ
+	for (auto& i : list_files("mmap_fail", ""))
+	{
+		remove(i.c_str());
+	}
+	bool ok = rmdir("mmap_fail") == 0;
+	for (int i = 0; i < 2000; ++i)
+	{
+		CCH_LOG_INFO(logger) << "lost " << i << " " << pad;
+	}
+	ok = ok && list_files("mmap_fail", "").empty();
+	mkdir("mmap_fail", 0755);
+	std::this_thread::sleep_for(std::chrono::milliseconds(1100));
+	for (int i = 0; i < 10; ++i)
+	{
+		CCH_LOG_INFO(logger) << "resumed " << i;
+	}
+	logger->clearAppenders();
+	appender.reset();
+	std::vector<std::string> files = list_files("mmap_fail", "m.log.");
+	std::string text;
+	if (files.size() == 1)
+	{
+		std::ifstream ifs(files[0]);
+		text.assign((std::istreambuf_iterator<char>(ifs)), std::istreambuf_iterator<char>());
+	}
+	//ɶʣµĿռ仹ܷǰ漸־д¶
+	ok = ok && files.size() == 1 && text.find("lost") == std::string::npos
+		&& text.find("resumed 9\n") != std::string::npos;
+	std::cout << "test_mmap_open_failure: " << (ok ? "ok" : "FAILED") << std::endl;
+	for (auto& i : list_files("mmap_fail", ""))
+	{
+		remove(i.c_str());
+	}
+	rmdir("mmap_fail");
+	return ok;
+}
+
+//־ռappender
+class CaptureLogAppender : public cch::LogAppender
+{
+public:
+	typedef std::shared_ptr<CaptureLogAppender> ptr;
+	void log(cch::Logger::ptr /*logger*/, cch::LogLevel::Level /*level*/, cch::LogEvent::ptr event) override
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_lines.push_back(event->getContent());
+	}
+	std::string toYamlString() override { return ""; }
+	std::vector<std::string> take()
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		std::vector<std::string> v;
+		v.swap(m_lines);
+		return v;
+	}
+private:
+	std::mutex m_mutex;
+	std::vector<std::string> m_lines;
+};
+
+//¼յԤȾ
+class RenderedLogAppender : public cch::LogAppender
+{
+public:
+	typedef std::shared_ptr<RenderedLogAppender> ptr;
+	void log(cch::Logger::ptr /*logger*/, cch::LogLevel::Level /*level*/, cch::LogEvent::ptr /*event*/) override
+	{
+		++m_unrendered;
+	}
+	void logRendered(cch::Logger::ptr logger, cch::LogLevel::Level level, cch::LogEvent::ptr event,
+		const char* data, size_t len) override
+	{
+		m_data = data;
+		m_text.assign(data, len);
+		m_expect = m_formatter->format(logger, level, event);
+	}
+	bool usesRendered() const override { return true; }
+	std::string toYamlString() override { return ""; }
+
+	const char* m_data = nullptr;
+	std::string m_text;
+	std::string m_expect;
+	int m_unrendered = 0;
+};
+
+//formatterappenderõͬһȾformatterͬĵȾ
+bool test_log_fan_out()
+{
+	cch::Logger::ptr logger(new cch::Logger("fan_out_test"));
+	logger->setFormatter("%p %c %m%n");
+	RenderedLogAppender::ptr a(new RenderedLogAppender);
+	RenderedLogAppender::ptr b(new RenderedLogAppender);
+	RenderedLogAppender::ptr own(new RenderedLogAppender);
+	RenderedLogAppender::ptr c(new RenderedLogAppender);
+	own->setFormatter(cch::LogFormatter::ptr(new cch::LogFormatter("[%m]%n")));
+	logger->addAppender(a);
+	logger->addAppender(own);
+	logger->addAppender(b);
+	logger->addAppender(c);
+	CCH_LOG_FMT_WARN(logger, "fan out %d", 1);
+
+	bool ok = a->m_data && a->m_data == b->m_data && b->m_data == c->m_data
+		&& a->m_text == "WARN fan_out_test fan out 1\n" && a->m_text == a->m_expect
+		&& own->m_text == "[fan out 1]\n" && own->m_text == own->m_expect
+		&& a->m_unrendered + b->m_unrendered + c->m_unrendered + own->m_unrendered == 0;
+	std::cout << "test_log_fan_out: " << (ok ? "ok" : "FAILED") << std::endl;
+	return ok;
+}
+
+bool test_log_rate_limit()
+{
+	cch::Logger::ptr logger(new cch::Logger("limit_test"));
+	CaptureLogAppender::ptr capture(new CaptureLogAppender);
+	logger->addAppender(capture);
+	bool ok = true;
+
+	for (int i = 0; i < 1000; ++i)
+	{
+		CCH_LOG_EVERY_N(logger, cch::LogLevel::ERROR, 10) << "every " << i;
+	}
+	std::vector<std::string> lines = capture->take();
+	ok = ok && lines.size() == 100 && lines[0] == "every 0" && lines[1] == "[suppressed 9] every 10";
+
+	for (int i = 0; i < 1000; ++i)
+	{
+		CCH_LOG_FMT_FIRST_N(logger, cch::LogLevel::ERROR, 5, "first %d", i);
+	}
+	lines = capture->take();
+	ok = ok && lines.size() == 5 && lines[4] == "first 4";
+
+	//𲻹ĵò
+	logger->setLevel(cch::LogLevel::ERROR);
+	for (int i = 0; i < 100; ++i)
+	{
+		CCH_LOG_FIRST_N(logger, cch::LogLevel::INFO, 1) << "disabled " << i;
+	}
+	logger->setLevel(cch::LogLevel::DEBUG);
+	for (int i = 0; i < 100; ++i)
+	{
+		CCH_LOG_FIRST_N(logger, cch::LogLevel::INFO, 1) << "enabled " << i;
+	}
+	lines = capture->take();
+	ok = ok && lines.size() == 1 && lines[0] == "enabled 0";
+
+	//߳every NǾȷ
+	std::vector<std::thread> threads;
+	for (int t = 0; t < 8; ++t)
+	{
+		threads.push_back(std::thread([logger]() {
+			for (int i = 0; i < 10000; ++i)
+			{
+				CCH_LOG_FMT_EVERY_N(logger, cch::LogLevel::WARN, 100, "threads %d", i);
+			}
+		}));
+	}
+	for (auto& i : threads)
+	{
+		i.join();
+	}
+	ok = ok && capture->take().size() == 800;
+
+	//ÿ3һָ֮汻Ƶ
+	auto burst = [logger]() {
+		for (int i = 0; i < 1000; ++i)
+		{
+			CCH_LOG_FMT_PER_SEC(logger, cch::LogLevel::ERROR, 3, "per sec %d", i);
+		}
+	};
+	burst();
+	lines = capture->take();
+	bool burst_ok = lines.size() >= 3 && lines.size() <= 6;	//ɿʱ
+	std::this_thread::sleep_for(std::chrono::milliseconds(1100));
+	burst();
+	lines = capture->take();
+	burst_ok = burst_ok && lines.size() >= 3 && lines[0].compare(0, 12, "[suppressed ") == 0;
+	ok = ok && burst_ok;
+
+	//S뿪ֻõ1ΣS+1ɴʣµĴãS+13
+	cch::LogLimiter limiter;
+	while (cch::GetCurrentUS() % 1000000 > 500000)
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	}
+	uint64_t second = cch::GetCurrentUS() / 1000000;
+	limiter.perSecond(3);
+	while (cch::GetCurrentUS() / 1000000 == second)
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+	int passed = 0;
+	uint64_t suppressed = 0;
+	for (int i = 0; i < 1000; ++i)
+	{
+		uint64_t before = cch::GetCurrentUS() / 1000000;
+		cch::LogLimitResult r = limiter.perSecond(3);
+		if (before == second + 1 && cch::GetCurrentUS() / 1000000 == second + 1 && r.pass)
+		{
+			++passed;
+			suppressed += r.suppressed;
+		}
+	}
+	ok = ok && passed == 3 && suppressed == 0;
+
+	std::cout << "test_log_rate_limit: " << (ok ? "ok" : "FAILED") << std::endl;
+	return ok;
+}
+
+//ȵ%sԲ'\0'βŲɷʵҳһֽھͻ
+bool test_log_fmt_precision()
+{
+	cch::Logger::ptr logger(new cch::Logger("precision_test"));
+	CaptureLogAppender::ptr capture(new CaptureLogAppender);
+	logger->addAppender(capture);
+	long page = sysconf(_SC_PAGESIZE);
+	char* pages = (char*)mmap(nullptr, page * 2, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (pages == MAP_FAILED || mprotect(pages + page, page, PROT_NONE) != 0)
+	{
+		std::cout << "test_log_fmt_precision: mmap failed" << std::endl;
+		return false;
+	}
+	char* buf = pages + page - 4;
+	memcpy(buf, "abcd", 4);
+	CCH_LOG_FMT_INFO(logger, "len-bounded: %.*s", 4, buf);
+	CCH_LOG_FMT_INFO(logger, "fixed: %.4s|%-6.2s|%.*s", buf, buf, 3, buf + 1);
+	CCH_LOG_FMT_INFO(logger, "negative: %.*s", -1, "whole");
+	munmap(pages, page * 2);
+	std::vector<std::string> lines = capture->take();
+	bool ok = lines.size() == 3 && lines[0] == "len-bounded: abcd"
+		&& lines[1] == "fixed: abcd|ab    |bcd" && lines[2] == "negative: whole";
+	std::cout << "test_log_fmt_precision: " << (ok ? "ok" : "FAILED") << std::endl;
+	return ok;
+}
+
+static std::string read_file(const std::string& path)
+{
+	std::ifstream ifs(path);
+	std::stringstream ss;
+	ss << ifs.rdbuf();
+	return ss.str();
+}
+
+//־INFOʱм¼Ȼÿ߳DEBUGFATALSIGABRTʱת
+bool test_flight_recorder()
+{
+	const int THREADS = 4;
+	const int CAPACITY = 16;
+	remove("flight_test.log");
+	cch::Logger::ptr logger(new cch::Logger("flight_test"));
+	logger->setLevel(cch::LogLevel::INFO);
+	CaptureLogAppender::ptr capture(new CaptureLogAppender);
+	logger->addAppender(capture);
+	cch::FlightRecorderLogAppender::ptr recorder(new cch::FlightRecorderLogAppender("flight_test.log", CAPACITY));
+	logger->addAppender(recorder);
+	bool ok = logger->getLevel() == cch::LogLevel::DEBUG;
+	std::vector<std::thread> threads;
+	for (int t = 0; t < THREADS; ++t)
+	{
+		threads.push_back(std::thread([logger, t]() {
+			for (int i = 0; i < 100; ++i)
+			{
+				CCH_LOG_FMT_DEBUG(logger, "thread %d debug %d", t, i);
+			}
+			CCH_LOG_DEBUG(logger) << "thread " << t << " stream";
+		}));
+	}
+	for (auto& i : threads)
+	{
+		i.join();
+	}
+	CCH_LOG_FMT_FATAL(logger, "fatal %s", "here");
+	std::vector<std::string> lines = capture->take();
+	ok = ok && lines.size() == 1 && lines[0] == "fatal here";
+
+	std::string dump = read_file("flight_test.log");
+	ok = ok && dump.find("==== FlightRecorder dump: FATAL") == 0
+		&& dump.find("[FATAL]\t[flight_test]") != std::string::npos
+		&& dump.find("\tfatal here\n") != std::string::npos;
+	for (int t = 0; t < THREADS; ++t)
+	{
+		//ÿֻ߳ʣCAPACITY
+		char buf[64];
+		snprintf(buf, sizeof(buf), "\tthread %d debug %d\n", t, 100 - CAPACITY + 1);
+		ok = ok && dump.find(buf) != std::string::npos;
+		snprintf(buf, sizeof(buf), "\tthread %d debug %d\n", t, 100 - CAPACITY);
+		ok = ok && dump.find(buf) == std::string::npos;
+		snprintf(buf, sizeof(buf), "\tthread %d stream\n", t);
+		ok = ok && dump.find(buf) != std::string::npos;
+	}
+
+	//ӽabortSIGABRTֻдԭʼֶ(ʽ + ʮƲ)תĬϷʽֹ
+	remove("flight_test.log");
+	pid_t pid = fork();
+	if (pid == 0)
+	{
+		CCH_LOG_FMT_DEBUG(logger, "before abort %d", 42);
+		abort();
+	}
+	int status = 0;
+	waitpid(pid, &status, 0);
+	dump = read_file("flight_test.log");
+	ok = ok && WIFSIGNALED(status) && WTERMSIG(status) == SIGABRT
+		&& dump.find("==== FlightRecorder dump: SIGABRT") == 0
+		&& dump.find("]\t[flight_test]\t") != std::string::npos
+		&& dump.find("\tbefore abort %d\t2a000000\n") != std::string::npos;
+
+	logger->clearAppenders();
+	ok = ok && logger->getLevel() == cch::LogLevel::INFO;
+	remove("flight_test.log");
+	std::cout << "test_flight_recorder: " << (ok ? "ok" : "FAILED") << std::endl;
+	return ok;
+}
+
+static int s_evaluated = 0;
+static int evaluated()
+{
+	return ++s_evaluated;
+}
+
+//CCH_LOG_MIN_LEVELڱڱȥ־ٵҲִ
+#undef CCH_LOG_MIN_LEVEL
+#define CCH_LOG_MIN_LEVEL 3
+static void log_below_min_level(cch::Logger::ptr logger)
+{
+	CCH_LOG_INFO(logger) << evaluated();
+	CCH_LOG_FMT_DEBUG(logger, "%d", evaluated());
+	CCH_LOG_EVERY_N(logger, cch::LogLevel::DEBUG, 1) << evaluated();
+}
+#undef CCH_LOG_MIN_LEVEL
+#define CCH_LOG_MIN_LEVEL 0
+
+//ͬһõ㽻ʹòͬ־
+static void log_debug_to(cch::Logger::ptr logger)
+{
+	CCH_LOG_DEBUG(logger) << evaluated();
+}
+
+//õû־仯LogIniterӦúʧЧ
+bool test_log_site_cache()
+{
+	cch::Logger::ptr a(new cch::Logger("site_a"));
+	cch::Logger::ptr b(new cch::Logger("site_b"));
+	CaptureLogAppender::ptr capture(new CaptureLogAppender);
+	a->addAppender(capture);
+	b->addAppender(capture);
+	a->setLevel(cch::LogLevel::INFO);
+	s_evaluated = 0;
+	for (int i = 0; i < 3; ++i)
+	{
+		log_debug_to(a);
+		log_debug_to(b);
+	}
+	bool ok = s_evaluated == 3 && capture->take().size() == 3;
+	a->setLevel(cch::LogLevel::DEBUG);
+	log_debug_to(a);
+	ok = ok && s_evaluated == 4;
+	log_below_min_level(b);
+	ok = ok && s_evaluated == 4 && capture->take().size() == 1;
+
+	cch::Logger::ptr c = CCH_LOG_NAME("site_cache_test");
+	c->addAppender(capture);
+	log_debug_to(c);
+	ok = ok && s_evaluated == 5;
+	cch::Config::LoadFromYaml(YAML::Load("logs:\n  - name: site_cache_test\n    level: error\n"));
+	log_debug_to(c);
+	ok = ok && s_evaluated == 5;
+	cch::Config::LoadFromYaml(YAML::Load("logs:\n  - name: site_cache_test\n    level: debug\n"
+		"    appenders:\n      - type: FileLogAppender\n        file: /dev/null\n"));
+	log_debug_to(c);
+	ok = ok && s_evaluated == 6;
+	std::cout << "test_log_site_cache: " << (ok ? "ok" : "FAILED") << std::endl;
+	return ok;
+}
+
+//{}ʽԼʽڱڱܾ
+bool test_log_print()
+{
+	cch::Logger::ptr logger(new cch::Logger("print_test"));
+	CaptureLogAppender::ptr capture(new CaptureLogAppender);
+	logger->addAppender(capture);
+	std::string str = "str";
+	const char* null_str = nullptr;
+	CCH_LOG_PRINT_INFO(logger, "plain");
+	CCH_LOG_PRINT_INFO(logger, "{} {} {} {} {} {}", 1, -2, 3u, 1.5, "x", str);
+	CCH_LOG_PRINT_INFO(logger, "{:x} {:X} {:o} {:b} {:c} {:08d}|{:5d}|{:<5d}|", 255, 255, 8, 5, 65, -42, 7, 7);
+	CCH_LOG_PRINT_INFO(logger, "{:.3f} {:e} {:.2} {} {}", 3.14159, 1e10, 2.0 / 3, 0.1, -1e300);
+	CCH_LOG_PRINT_INFO(logger, "{:.2s}|{:4}|{:>4}|{} {:d} {} {:d} {}", "abcdef", "ab", "ab", true, false, 'q', 'q', null_str);
+	CCH_LOG_PRINT_INFO(logger, "{{}} {} {} {}", NestedLog{logger}, (void*)0x1234, INT64_MIN);
+	std::vector<std::string> lines = capture->take();
+	const char* expect[] = {
+		"plain",
+		"1 -2 3 1.5 x str",
+		"ff FF 10 101 A -0000042|    7|7    |",
+		"3.142 1.000000e+10 0.67 0.1 -1e+300",
+		"ab|ab  |  ab|true 0 q 113 (null)",
+		"inner",
+		"{} outer 0x1234 -9223372036854775808"
+	};
+	bool ok = lines.size() == sizeof(expect) / sizeof(expect[0]);
+	for (size_t i = 0; ok && i < lines.size(); ++i)
+	{
+		if (lines[i] != expect[i])
+		{
+			std::cout << "test_log_print: got \"" << lines[i] << "\" expect \"" << expect[i] << "\"" << std::endl;
+			ok = false;
+		}
+	}
+
+	//ʽʱCCH_LOG_PRINT_*ʧܣֱӼУ
+	typedef cch::LogBraceCheck<int> OneInt;
+	typedef cch::LogBraceCheck<std::string> OneStr;
+	static_assert(cch::LogBrace::Validate("{}", OneInt::s_kinds, 1) == cch::LogBrace::OK, "ok");
+	static_assert(cch::LogBrace::Validate("{} {}", OneInt::s_kinds, 1) == cch::LogBrace::ERR_TOO_FEW_ARGS, "too few");
+	static_assert(cch::LogBrace::Validate("{{}}", OneInt::s_kinds, 1) == cch::LogBrace::ERR_TOO_MANY_ARGS, "too many");
+	static_assert(cch::LogBrace::Validate("{", OneInt::s_kinds, 1) == cch::LogBrace::ERR_UNMATCHED_BRACE, "unmatched");
+	static_assert(cch::LogBrace::Validate("}", OneInt::s_kinds, 1) == cch::LogBrace::ERR_UNMATCHED_BRACE, "unmatched");
+	static_assert(cch::LogBrace::Validate("{:q}", OneInt::s_kinds, 1) == cch::LogBrace::ERR_INVALID_SPEC, "invalid");
+	static_assert(cch::LogBrace::Validate("{:d}", OneStr::s_kinds, 1) == cch::LogBrace::ERR_SPEC_TYPE, "type");
+	static_assert(cch::LogBrace::Validate("{:.2f}", OneInt::s_kinds, 1) == cch::LogBrace::ERR_SPEC_TYPE, "type");
+
+	//ʱʽ(ƹ˱ڼ)ԭԽ
+	cch::LogEvent event(logger, cch::LogLevel::INFO, __FILE__, __LINE__, 0, 0, 0, 0);
+	event.print("bad {} {:q} } {} {", 1);
+	ok = ok && event.getContent() == "bad 1 {:q} } {} {";
+	std::cout << "test_log_print: " << (ok ? "ok" : "FAILED") << std::endl;
+	return ok;
+}
+
+//.ư㼶̳мappender޸ϼѴڵ¼Ч
+bool test_log_hierarchy()
+{
+	cch::Logger::ptr sys = CCH_LOG_NAME("h_sys");
+	CaptureLogAppender::ptr sys_capture(new CaptureLogAppender);
+	sys->addAppender(sys_capture);
+	sys->setLevel(cch::LogLevel::WARN);
+	cch::Logger::ptr http = CCH_LOG_NAME("h_sys.net.http");
+	cch::Logger::ptr net = CCH_LOG_NAME("h_sys.net");
+	bool ok = http->getLevel() == cch::LogLevel::WARN && net->getLevel() == cch::LogLevel::WARN;
+	CCH_LOG_INFO(http) << "dropped";
+	CCH_LOG_WARN(http) << "to sys";
+	ok = ok && sys_capture->take() == std::vector<std::string>{ "to sys" };
+
+	//ԼļȣUNKNOWָ̳
+	http->setLevel(cch::LogLevel::INFO);
+	CCH_LOG_INFO(http) << "own level";
+	sys->setLevel(cch::LogLevel::ERROR);
+	ok = ok && http->getLevel() == cch::LogLevel::INFO && net->getLevel() == cch::LogLevel::ERROR;
+	http->setLevel(cch::LogLevel::UNKNOW);
+	CCH_LOG_WARN(http) << "dropped";
+	ok = ok && http->getLevel() == cch::LogLevel::ERROR && sys_capture->take().size() == 1;
+
+	//мһԼappenderʱ¼ģת
+	CaptureLogAppender::ptr net_capture(new CaptureLogAppender);
+	net->addAppender(net_capture);
+	CCH_LOG_ERROR(http) << "to net";
+	ok = ok && net_capture->take().size() == 1 && sys_capture->take().empty();
+	net->clearAppenders();
+	CCH_LOG_ERROR(http) << "back to sys";
+	ok = ok && net_capture->take().empty() && sys_capture->take().size() == 1;
+
+	//ϼȴ¼Ч
+	cch::Logger::ptr child = CCH_LOG_NAME_CACHED("h_cfg.child");
+	cch::Config::LoadFromYaml(YAML::Load("logs:\n  - name: h_cfg\n    level: error\n"));
+	ok = ok && child->getLevel() == cch::LogLevel::ERROR && child.get() == CCH_LOG_NAME("h_cfg.child").get();
+
+	//߳ͬʱͬһ־ÿֻһʵ
+	std::vector<std::thread> threads;
+	std::vector<cch::Logger*> got(8 * 16);
+	for (int t = 0; t < 8; ++t)
+	{
+		threads.push_back(std::thread([t, &got]() {
+			for (int i = 0; i < 16; ++i)
+			{
+				got[t * 16 + i] = CCH_LOG_NAME("h_mt." + std::to_string(i % 4) + ".leaf" + std::to_string(i)).get();
+			}
+		}));
+	}
+	for (auto& i : threads)
+	{
+		i.join();
+	}
+	for (int t = 1; t < 8; ++t)
+	{
+		ok = ok && std::equal(got.begin(), got.begin() + 16, got.begin() + t * 16);
+	}
+	std::cout << "test_log_hierarchy: " << (ok ? "ok" : "FAILED") << std::endl;
+	return ok;
+}
+
+static void write_file(const std::string& path, const std::string& content)
+{
+	//дʱļٸʹ༭ķʽһ
+	std::string tmp = path + ".tmp";
+	std::ofstream ofs(tmp);
+	ofs << content;
+	ofs.close();
+	rename(tmp.c_str(), path.c_str());
+}
+
+static bool wait_reloads(cch::ConfigFileWatcher& watcher, uint64_t count)
+{
+	for (int i = 0; i < 500 && watcher.getReloadCount() < count; ++i)
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	}
+	return watcher.getReloadCount() == count;
+}
+
+
+static size_t count_lines(const std::string& path)
+{
+	std::string data = read_file(path);
+	return std::count(data.begin(), data.end(), '\n');
+}
+
+//ļȼأ޸ֻһΣûappenderԭ
+//˵ؽʱ׷дԭļض
+bool test_log_hot_reload()
+{
+	const char* conf = "hot_reload.yml";
+	remove("hot_a.log");
+	remove("hot_b.log");
+	auto config = [](const char* b_level) {
+		return std::string("logs:\n"
+			"  - name: hot\n"
+			"    level: info\n"
+			"    formatter: \"%m%n\"\n"
+			"    appenders:\n"
+			"      - type: FileLogAppender\n"
+			"        file: hot_a.log\n"
+			"        async: true\n"
+			"      - type: FileLogAppender\n"
+			"        file: hot_b.log\n"
+			"        level: ") + b_level + "\n";
+	};
+	write_file(conf, config("info"));
+	cch::ConfigFileWatcher watcher(conf, 100);
+	bool ok = watcher.reload() && watcher.start();
+	cch::Logger::ptr logger = CCH_LOG_NAME("hot");
+	std::vector<cch::LogAppender::ptr> before = logger->getAppenders();
+	ok = ok && before.size() == 2;
+	for (int i = 0; i < 100; ++i)
+	{
+		CCH_LOG_INFO(logger) << "before " << i;
+	}
+
+	//ȥαֻһ
+	write_file(conf, config("warn"));
+	write_file(conf, config("fatal"));
+	write_file(conf, config("error"));
+	ok = ok && wait_reloads(watcher, 2);
+	std::this_thread::sleep_for(std::chrono::milliseconds(300));
+	ok = ok && watcher.getReloadCount() == 2;
+	std::vector<cch::LogAppender::ptr> after = logger->getAppenders();
+	ok = ok && after.size() == 2 && after[0] == before[0] && after[1] != before[1]
+		&& after[1]->getLevel() == cch::LogLevel::ERROR;
+
+	//ʧʱԭ
+	write_file(conf, "logs: [\n");
+	std::this_thread::sleep_for(std::chrono::milliseconds(400));
+	ok = ok && watcher.getReloadCount() == 2 && logger->getAppenders() == after;
+	watcher.stop();
+
+	for (int i = 0; i < 100; ++i)
+	{
+		CCH_LOG_INFO(logger) << "after " << i;
+	}
+	before.clear();
+	after.clear();
+	cch::Config::LoadFromYaml(YAML::Load("logs: []"));
+	ok = ok && logger->getAppenders().empty();
+	size_t a_lines = count_lines("hot_a.log");
+	size_t b_lines = count_lines("hot_b.log");
+	ok = ok && a_lines == 200 && b_lines == 100;
+	remove(conf);
+	remove("hot_a.log");
+	remove("hot_b.log");
+	std::cout << "test_log_hot_reload: a=" << a_lines << " b=" << b_lines << " " << (ok ? "ok" : "FAILED") << std::endl;
+	return ok;
+}
+
+//ֻappenderlevelȼأ+ԤľappenderappenderO_APPENDͬһļ
+//appenderʱͷԤռ䲻ܽصappenderдȥ
+bool test_log_reload_trim()
+{
+	remove("trim_test.log");
+	auto config = [](const char* level) {
+		return std::string("logs:\n"
+			"  - name: trim\n"
+			"    level: debug\n"
+			"    formatter: \"%m%n\"\n"
+			"    appenders:\n"
+			"      - type: FileLogAppender\n"
+			"        file: trim_test.log\n"
+			"        max_size: 1048576\n"
+			"        preallocate: true\n"
+			"        level: ") + level + "\n";
+	};
+	cch::Config::LoadFromYaml(YAML::Load(config("info")));
+	cch::Logger::ptr logger = CCH_LOG_NAME("trim");
+	std::vector<cch::LogAppender::ptr> before = logger->getAppenders();
+	cch::Config::LoadFromYaml(YAML::Load(config("debug")));
+	std::vector<cch::LogAppender::ptr> after = logger->getAppenders();
+	bool ok = before.size() == 1 && after.size() == 1 && before[0] != after[0];
+	for (int i = 0; i < 100; ++i)
+	{
+		CCH_LOG_DEBUG(logger) << "after " << i;
+	}
+	before.clear();
+	ok = ok && count_lines("trim_test.log") == 100;
+	after.clear();
+	cch::Config::LoadFromYaml(YAML::Load("logs: []"));
+	struct stat st;
+	ok = ok && stat("trim_test.log", &st) == 0 && count_lines("trim_test.log") == 100
+		&& (uint64_t)st.st_blocks * 512 < 1048576;
+	remove("trim_test.log");
+	std::cout << "test_log_reload_trim: " << (ok ? "ok" : "FAILED") << std::endl;
+	return ok;
+}
+
+//ñ׼߽ѹؽѹȫ(һ鲻ʱܽĲ)
+static std::string gunzip(const std::string& path)
+{
+	std::string cmd = "gzip -dc " + path + " 2>/dev/null";
+	FILE* fp = popen(cmd.c_str(), "r");
+	std::string out;
+	char buf[4096];
+	size_t n;
+	while (fp && (n = fread(buf, 1, sizeof(buf), fp)) > 0)
+	{
+		out.append(buf, n);
+	}
+	if (fp)
+	{
+		pclose(fp);
+	}
+	return out;
+}
+
+//gzipѹıļܱgzip -dcԭصĩβģǰĿȻɶ־ѹܽ
+bool test_log_compress()
+{
+	if (!cch::FileLogAppender::IsCompressionSupported(cch::FileLogAppender::COMPRESS_GZIP))
+	{
+		std::cout << "test_log_compress: gzip not supported, skipped" << std::endl;
+		return true;
+	}
+	const char* pattern = "%d{%Y-%m-%d %H:%M:%S}%T[%p]%T[%c]%T%f:%l%T%m%n";
+	remove("compress_test.log.gz");
+	remove("compress_test.blog.gz");
+	cch::Logger::ptr logger(new cch::Logger("compress_test"));
+	logger->setFormatter(pattern);
+	cch::FileLogAppender::ptr text(new cch::FileLogAppender("compress_test.log.gz",
+		cch::FileLogAppender::RollPolicy(), cch::FileLogAppender::COMPRESS_GZIP));
+	text->setAsync(64 * 1024, 10);
+	logger->addAppender(text);
+	cch::BinaryLogAppender::ptr binary(new cch::BinaryLogAppender("compress_test.blog.gz",
+		cch::FileLogAppender::RollPolicy(), cch::FileLogAppender::COMPRESS_GZIP));
+	//ûеsetAsyncҲ첽ģʽѹ
+	bool ok = binary->isAsync();
+	logger->addAppender(binary);
+	cch::FileLogAppender::ptr plain(new cch::FileLogAppender("compress_test.log"));
+	logger->addAppender(plain);
+
+	const int N = 20000;
+	for (int i = 0; i < N; ++i)
+	{
+		CCH_LOG_FMT_INFO(logger, "request id=%d user=%s cost=%.3fms", i, "compress", i / 7.0);
+	}
+	logger->clearAppenders();
+	text.reset();
+	ok = ok && binary->getCompressStats().blocks < N / 10;
+	binary.reset();
+	plain.reset();
+
+	std::string expect = read_file("compress_test.log");
+	ok = ok && gunzip("compress_test.log.gz") == expect;
+	std::stringstream decoded;
+	ok = ok && cch::BinaryLogAppender::Decode("compress_test.blog.gz", decoded,
+		cch::LogFormatter::ptr(new cch::LogFormatter(pattern)));
+	ok = ok && decoded.str() == expect;
+
+	//ģдһصһ룬ǰĿܽѹԭĵǰ׺
+	struct stat st;
+	stat("compress_test.log.gz", &st);
+	ok = ok && truncate("compress_test.log.gz", st.st_size / 2) == 0;
+	std::string partial = gunzip("compress_test.log.gz");
+	ok = ok && !partial.empty() && partial.size() < expect.size() && expect.compare(0, partial.size(), partial) == 0;
+	std::cout << "test_log_compress: raw=" << expect.size() << " gz=" << st.st_size
+		<< " partial=" << partial.size() << " " << (ok ? "ok" : "FAILED") << std::endl;
+	remove("compress_test.log.gz");
+	remove("compress_test.blog.gz");
+	remove("compress_test.log");
+	return ok;
+}
+
+//ʱָʱ乹־ȡķΧ븲Ҫ䣬ֻһ
+//ʱŹ鵵鵵ļ鵵־
+bool test_log_time_index()
+{
+	const char* file = "index_test.log";
+	remove(file);
+	remove("index_test.log.idx");
+	cch::Logger::ptr logger(new cch::Logger("index_test"));
+	logger->setFormatter("%m%n");
+	cch::FileLogAppender::ptr appender(new cch::FileLogAppender(file));
+	bool ok = appender->setTimeIndex(100, 0);
+	appender->setAsync(64 * 1024, 10);
+	logger->addAppender(appender);
+	const int N = 10000;
+	const uint64_t base = 1700000000;
+	for (int i = 0; i < N; ++i)
+	{
+		//ÿ1
+		uint64_t us = base * 1000000 + i * 1000;
+		cch::LogEvent ev(logger, cch::LogLevel::INFO, __FILE__, __LINE__, 0, 0, 0, us / 1000000, us % 1000000);
+		ev.getSS() << "rec " << i;
+		logger->log(cch::LogLevel::INFO, cch::LogEvent::ptr(cch::LogEvent::ptr(), &ev));
+	}
+	logger->clearAppenders();
+	appender.reset();
+
+	std::stringstream ss;
+	ok = ok && cch::FileLogAppender::ExtractTimeRange(file, base * 1000000 + 3000 * 1000, base * 1000000 + 5000 * 1000, ss);
+	std::vector<int> recs;
+	std::string line;
+	while (std::getline(ss, line))
+	{
+		recs.push_back(atoi(line.c_str() + 4));
+	}
+	ok = ok && !recs.empty() && recs.front() <= 3000 && recs.front() >= 3000 - 100
+		&& recs.back() >= 4999 && recs.back() <= 4999 + 100;
+	for (size_t i = 1; ok && i < recs.size(); ++i)
+	{
+		ok = recs[i] == recs[i - 1] + 1;
+	}
+	size_t extracted = recs.size();
+	//ļ֮
+	std::stringstream none;
+	ok = ok && cch::FileLogAppender::ExtractTimeRange(file, 0, base * 1000000, none) && none.str().empty();
+	remove(file);
+	remove("index_test.log.idx");
+
+	//
+	const char* roll_file = "index_roll.log";
+	std::vector<std::string> old_files = list_files(".", "index_roll.log");
+	for (auto& i : old_files)
+	{
+		remove(i.c_str());
+	}
+	cch::FileLogAppender::RollPolicy roll;
+	roll.max_size = 64 * 1024;
+	roll.preallocate = false;
+	cch::FileLogAppender::ptr rolled(new cch::FileLogAppender(roll_file, roll));
+	ok = rolled->setTimeIndex(0, 1000) && ok;
+	logger->addAppender(rolled);
+	for (int i = 0; i < 10000; ++i)
+	{
+		CCH_LOG_INFO(logger) << "roll " << i;
+	}
+	logger->clearAppenders();
+	rolled.reset();
+	std::vector<std::string> files = list_files(".", "index_roll.log");
+	size_t logs = 0;
+	size_t indexes = 0;
+	for (auto& i : files)
+	{
+		bool idx = i.size() > 4 && i.compare(i.size() - 4, 4, ".idx") == 0;
+		idx ? ++indexes : ++logs;
+		remove(i.c_str());
+	}
+	ok = ok && logs > 1 && indexes == logs;
+	std::cout << "test_log_time_index: extracted=" << extracted << " roll_files=" << logs
+		<< " " << (ok ? "ok" : "FAILED") << std::endl;
+	return ok;
+}
+
+//ϸRFC 8259һJSON󣬲YAMLܽܶJSONд
+//(δתĿַšǷת塢ǰ0NaNĶšظļUTF-8)
+//ֵַת󱣴棬ֵԭ
+struct JsonValue
+{
+	bool is_string = false;
+	std::string text;
+};
+
+class StrictJson
+{
+public:
+	static bool Parse(const std::string& text, std::map<std::string, JsonValue>& obj)
+	{
+		StrictJson j(text);
+		obj.clear();
+		j.skipSpace();
+		if (!j.object(&obj, 0))
+		{
+			return false;
+		}
+		j.skipSpace();
+		return j.m_p == j.m_end;
+	}
+private:
+	StrictJson(const std::string& text) :m_p(text.data()), m_end(text.data() + text.size()) {}
+
+	void skipSpace()
+	{
+		while (m_p < m_end && (*m_p == ' ' || *m_p == '\t' || *m_p == '\n' || *m_p == '\r'))
+		{
+			++m_p;
+		}
+	}
+
+	bool literal(const char* word)
+	{
+		size_t n = strlen(word);
+		if ((size_t)(m_end - m_p) < n || memcmp(m_p, word, n) != 0)
+		{
+			return false;
+		}
+		m_p += n;
+		return true;
+	}
+
+	bool digits()
+	{
+		const char* begin = m_p;
+		while (m_p < m_end && *m_p >= '0' && *m_p <= '9')
+		{
+			++m_p;
+		}
+		return m_p > begin;
+	}
+
+	//-?(0|[1-9][0-9]*)(\.[0-9]+)?([eE][+-]?[0-9]+)?
+	bool number()
+	{
+		if (m_p < m_end && *m_p == '-')
+		{
+			++m_p;
+		}
+		if (m_p < m_end && *m_p == '0')
+		{
+			++m_p;
+		}
+		else if (!digits())
+		{
+			return false;
+		}
+		if (m_p < m_end && *m_p == '.')
+		{
+			++m_p;
+			if (!digits())
+			{
+				return false;
+			}
+		}
+		if (m_p < m_end && (*m_p == 'e' || *m_p == 'E'))
+		{
+			++m_p;
+			if (m_p < m_end && (*m_p == '+' || *m_p == '-'))
+			{
+				++m_p;
+			}
+			if (!digits())
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	bool hex4(uint32_t& v)
+	{
+		if (m_end - m_p < 4)
+		{
+			return false;
+		}
+		v = 0;
+		for (int i = 0; i < 4; ++i)
+		{
+			char c = *m_p++;
+			v <<= 4;
+			if (c >= '0' && c <= '9')
+				v |= c - '0';
+			else if (c >= 'a' && c <= 'f')
+				v |= c - 'a' + 10;
+			else if (c >= 'A' && c <= 'F')
+				v |= c - 'A' + 10;
+			else
+				return false;
+		}
+		return true;
+	}
+
+	static void putUtf8(std::string& out, uint32_t cp)
+	{
+		if (cp < 0x80)
+		{
+			out += (char)cp;
+		}
+		else if (cp < 0x800)
+		{
+			out += (char)(0xC0 | cp >> 6);
+			out += (char)(0x80 | (cp & 0x3F));
+		}
+		else if (cp < 0x10000)
+		{
+			out += (char)(0xE0 | cp >> 12);
+			out += (char)(0x80 | (cp >> 6 & 0x3F));
+			out += (char)(0x80 | (cp & 0x3F));
+		}
+		else
+		{
+			out += (char)(0xF0 | cp >> 18);
+			out += (char)(0x80 | (cp >> 12 & 0x3F));
+			out += (char)(0x80 | (cp >> 6 & 0x3F));
+			out += (char)(0x80 | (cp & 0x3F));
+		}
+	}
+
+	//һUTF-8ַܾ롢ͳU+10FFFF
+	bool utf8(std::string& out)
+	{
+		uint8_t c = *m_p;
+		int n = c >= 0xF0 ? 3 : c >= 0xE0 ? 2 : c >= 0xC0 ? 1 : -1;
+		if (n < 0 || c > 0xF4 || m_end - m_p <= n)
+		{
+			return false;
+		}
+		uint32_t cp = c & (0x3F >> n);
+		for (int i = 1; i <= n; ++i)
+		{
+			uint8_t b = m_p[i];
+			if ((b & 0xC0) != 0x80)
+			{
+				return false;
+			}
+			cp = cp << 6 | (b & 0x3F);
+		}
+		static const uint32_t s_min[] = { 0, 0x80, 0x800, 0x10000 };
+		if (cp < s_min[n] || cp > 0x10FFFF || (cp >= 0xD800 && cp <= 0xDFFF))
+		{
+			return false;
+		}
+		out.append(m_p, n + 1);
+		m_p += n + 1;
+		return true;
+	}
+
+	bool str(std::string* out)
+	{
+		std::string s;
+		if (m_p >= m_end || *m_p++ != '"')
+		{
+			return false;
+		}
+		while (m_p < m_end && *m_p != '"')
+		{
+			uint8_t c = *m_p;
+			if (c < 0x20)
+			{
+				return false;
+			}
+			if (c >= 0x80)
+			{
+				if (!utf8(s))
+				{
+					return false;
+				}
+				continue;
+			}
+			++m_p;
+			if (c != '\\')
+			{
+				s += (char)c;
+				continue;
+			}
+			if (m_p >= m_end)
+			{
+				return false;
+			}
+			switch (*m_p++)
+			{
+			case '"': s += '"'; break;
+			case '\\': s += '\\'; break;
+			case '/': s += '/'; break;
+			case 'b': s += '\b'; break;
+			case 'f': s += '\f'; break;
+			case 'n': s += '\n'; break;
+			case 'r': s += '\r'; break;
+			case 't': s += '\t'; break;
+			case 'u':
+			{
+				uint32_t cp;
+				if (!hex4(cp) || (cp >= 0xDC00 && cp <= 0xDFFF))
+				{
+					return false;
+				}
+				if (cp >= 0xD800 && cp <= 0xDBFF)
+				{
+					uint32_t low;
+					if (!literal("\\u") || !hex4(low) || low < 0xDC00 || low > 0xDFFF)
+					{
+						return false;
+					}
+					cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+				}
+				putUtf8(s, cp);
+				break;
+			}
+			default:
+				return false;
+			}
+		}
+		if (m_p >= m_end)
+		{
+			return false;
+		}
+		++m_p;
+		if (out)
+		{
+			out->swap(s);
+		}
+		return true;
+	}
+
+	bool value(JsonValue* out, int depth)
+	{
+		if (m_p >= m_end || depth > 64)
+		{
+			return false;
+		}
+		const char* begin = m_p;
+		bool ok;
+		switch (*m_p)
+		{
+		case '"':
+			if (out)
+			{
+				out->is_string = true;
+				return str(&out->text);
+			}
+			return str(nullptr);
+		case '{':
+			ok = object(nullptr, depth + 1);
+			break;
+		case '[':
+			ok = array(depth + 1);
+			break;
+		case 't':
+			ok = literal("true");
+			break;
+		case 'f':
+			ok = literal("false");
+			break;
+		case 'n':
+			ok = literal("null");
+			break;
+		default:
+			ok = number();
+			break;
+		}
+		if (ok && out)
+		{
+			out->text.assign(begin, m_p);
+		}
+		return ok;
+	}
+
+	bool array(int depth)
+	{
+		++m_p;
+		skipSpace();
+		if (m_p < m_end && *m_p == ']')
+		{
+			++m_p;
+			return true;
+		}
+		while (true)
+		{
+			skipSpace();
+			if (!value(nullptr, depth))
+			{
+				return false;
+			}
+			skipSpace();
+			if (m_p < m_end && *m_p == ',')
+			{
+				++m_p;
+				continue;
+			}
+			return m_p < m_end && *m_p++ == ']';
+		}
+	}
+
+	bool object(std::map<std::string, JsonValue>* obj, int depth)
+	{
+		if (m_p >= m_end || *m_p != '{')
+		{
+			return false;
+		}
+		++m_p;
+		skipSpace();
+		if (m_p < m_end && *m_p == '}')
+		{
+			++m_p;
+			return true;
+		}
+		std::set<std::string> keys;
+		while (true)
+		{
+			skipSpace();
+			std::string key;
+			if (!str(&key) || !keys.insert(key).second)
+			{
+				return false;
+			}
+			skipSpace();
+			if (m_p >= m_end || *m_p++ != ':')
+			{
+				return false;
+			}
+			skipSpace();
+			JsonValue v;
+			if (!value(&v, depth))
+			{
+				return false;
+			}
+			if (obj)
+			{
+				(*obj)[key] = v;
+			}
+			skipSpace();
+			if (m_p < m_end && *m_p == ',')
+			{
+				++m_p;
+				continue;
+			}
+			return m_p < m_end && *m_p++ == '}';
+		}
+	}
+private:
+	const char* m_p;
+	const char* m_end;
+};
+
+//json/logfmtʽjsonϸJSONֶαȽ
+bool test_log_structured()
+{
+	cch::Logger::ptr logger(new cch::Logger("struct.test"));
+	cch::LogFormatter::ptr json(new cch::LogFormatter("json"));
+	cch::LogFormatter::ptr logfmt(new cch::LogFormatter("logfmt"));
+	bool ok = json->getMode() == cch::LogFormatter::MODE_JSON && logfmt->getMode() == cch::LogFormatter::MODE_LOGFMT;
+	//УYAMLܽǺϷJSON붼Ҫܾ
+	std::map<std::string, JsonValue> check;
+	for (const char* bad : { "{'a': 1}", "{a: 1}", "{\"a\": 1,}", "{\"a\": 01}", "{\"a\": .5}", "{\"a\": NaN}",
+		"{\"a\": \"x\ty\"}", "{\"a\": \"\\x\"}", "{\"a\": \"\\ud800\"}", "{\"a\": \"\xc0\xaf\"}",
+		"{\"a\": 1, \"a\": 2}", "{\"a\": 1} {}" })
+	{
+		ok = ok && !StrictJson::Parse(bad, check);
+	}
+	ok = ok && StrictJson::Parse("{\"a\": [1, {\"b\": null}], \"c\": \"\\u00e4\\ud83d\\ude00\", \"d\": -0.5e+3}\n", check)
+		&& check["a"].text == "[1, {\"b\": null}]" && check["c"].text == "\xc3\xa4\xf0\x9f\x98\x80" && check["d"].text == "-0.5e+3";
+	//ֽSIMDĸλ
+	std::vector<std::string> msgs = { "", "plain message", "a \"quoted\" \\ back\nslash\ttab\r\x01\x1f end",
+		std::string(100, 'x') + "\"" + std::string(37, 'y') + "\n\xe4\xb8\xad\xe6\x96\x87" };
+	std::string mixed;
+	for (int i = 0; i < 3000; ++i)
+	{
+		mixed += (char)(i % 97 == 0 ? '\\' : i % 61 == 0 ? '\x02' : 'a' + i % 26);
+	}
+	msgs.push_back(mixed);
+	for (auto& msg : msgs)
+	{
+		cch::LogEvent ev(logger, cch::LogLevel::WARN, "file.cpp", 42, 0, 7, 3, 1700000000, 123456);
+		ev.getSS() << msg;
+		ev.field("int", -5).field("uint", UINT64_MAX).field("double", 0.1).field("bool", true)
+			.field("str", msg).field("char", 'c').field("nan", NAN).field("other", std::vector<int>().size());
+		std::string out = json->format(logger, cch::LogLevel::WARN, cch::LogEvent::ptr(cch::LogEvent::ptr(), &ev));
+		ok = ok && out.size() > 2 && out.compare(out.size() - 2, 2, "}\n") == 0 && out.find('\n') == out.size() - 1;
+		std::map<std::string, JsonValue> n;
+		if (!StrictJson::Parse(out, n))
+		{
+			std::cout << "test_log_structured: invalid json " << out << std::endl;
+			ok = false;
+			continue;
+		}
+		//ֶַαţֵboolֶα벻
+		auto is = [&n](const char* key, bool is_string, const std::string& text) {
+			auto it = n.find(key);
+			return it != n.end() && it->second.is_string == is_string && it->second.text == text;
+		};
+		std::string time = n["time"].text;
+		ok = ok && n.size() == 16 && n["time"].is_string && time.size() == 26 && time[10] == 'T'
+			&& time.compare(20, 6, "123456") == 0
+			&& is("level", true, "WARN") && is("logger", true, "struct.test")
+			&& is("thread", false, "7") && is("fiber", false, "3")
+			&& is("file", true, "file.cpp") && is("line", false, "42")
+			&& is("msg", true, msg) && is("str", true, msg)
+			&& is("int", false, "-5") && is("uint", false, "18446744073709551615")
+			&& !n["double"].is_string && strtod(n["double"].text.c_str(), nullptr) == 0.1
+			&& is("bool", false, "true") && is("char", true, "c")
+			&& is("nan", true, "nan") && is("other", false, "0");
+	}
+
+	//ϢŲʱضϣȻһJSONϢֶ֮ζ
+	{
+		cch::LogEvent ev(logger, cch::LogLevel::INFO, "file.cpp", 1, 0, 1, 1, 1700000000);
+		std::string ctrl(4000, '\x01');
+		ev.getSS() << ctrl;
+		ev.field("after", 1);
+		std::string out = json->format(logger, cch::LogLevel::INFO, cch::LogEvent::ptr(cch::LogEvent::ptr(), &ev));
+		std::map<std::string, JsonValue> n;
+		ok = ok && StrictJson::Parse(out, n);
+		std::string msg = n["msg"].text;
+		ok = ok && out.size() <= cch::LogStream::BUFFER_SIZE && !msg.empty() && msg.size() < ctrl.size()
+			&& ctrl.compare(0, msg.size(), msg) == 0 && !n.count("after");
+		char small[64];
+		size_t len = json->format(small, sizeof(small), logger, cch::LogLevel::INFO, cch::LogEvent::ptr(cch::LogEvent::ptr(), &ev));
+		ok = ok && StrictJson::Parse(std::string(small, len), n) && n.count("level") && !n.count("logger");
+	}
+
+	//logfmtֻкո'='šбܡֵַ
+	{
+		cch::LogEvent ev(logger, cch::LogLevel::INFO, "file.cpp", 42, 0, 7, 3, 1700000000);
+		ev.getSS() << "a b";
+		ev.field("k", "v").field("n", 1.5).field("q", "x=\"y\"\n").field("bad key", "").field("ok", false);
+		std::string out = logfmt->format(logger, cch::LogLevel::INFO, cch::LogEvent::ptr(cch::LogEvent::ptr(), &ev));
+		size_t pos = out.find(" level=");
+		ok = ok && out.compare(0, 5, "time=") == 0 && pos != std::string::npos
+			&& out.substr(pos) == " level=INFO logger=struct.test thread=7 fiber=3 file=file.cpp line=42"
+			" msg=\"a b\" k=v n=1.5 q=\"x=\\\"y\\\"\\n\" bad_key=\"\" ok=false\n";
+	}
+
+	//ֶκjsonȾڴ
+	{
+		char buf[cch::LogStream::BUFFER_SIZE];
+		s_malloc_count = 0;
+		s_counting = true;
+		for (int i = 0; i < 1000; ++i)
+		{
+			cch::LogEvent ev(logger, cch::LogLevel::INFO, __FILE__, __LINE__, 0, 1, 1, 1700000000);
+			ev.getSS() << "alloc " << i;
+			ev.field("i", i).field("s", "str");
+			json->format(buf, sizeof(buf), logger, cch::LogLevel::INFO, cch::LogEvent::ptr(cch::LogEvent::ptr(), &ev));
+		}
+		s_counting = false;
+		ok = ok && s_malloc_count == 0;
+	}
+
+	//ͨlogsõformatterѡ
+	const char* file = "struct_test.log";
+	remove(file);
+	cch::Config::LoadFromYaml(YAML::Load("logs:\n"
+		"  - name: struct.yaml\n"
+		"    level: info\n"
+		"    formatter: json\n"
+		"    appenders:\n"
+		"      - type: FileLogAppender\n"
+		"        file: struct_test.log\n"));
+	cch::Logger::ptr yaml_logger = CCH_LOG_NAME("struct.yaml");
+	for (int i = 0; i < 10; ++i)
+	{
+		CCH_LOG_WITH(yaml_logger, cch::LogLevel::INFO).field("uid", i).field("ip", "10.0.0.1").getSS() << "login " << i;
+	}
+	cch::Config::LoadFromYaml(YAML::Load("logs: []"));
+	std::ifstream ifs(file);
+	std::string line;
+	int lines = 0;
+	while (std::getline(ifs, line))
+	{
+		std::map<std::string, JsonValue> n;
+		ok = ok && StrictJson::Parse(line, n) && n["uid"].text == std::to_string(lines)
+			&& n["ip"].text == "10.0.0.1" && n["msg"].text == "login " + std::to_string(lines);
+		++lines;
+	}
+	ok = ok && lines == 10;
+	remove(file);
+	std::cout << "test_log_structured: " << (ok ? "ok" : "FAILED") << std::endl;
+	return ok;
+}
+
+bool test_log_group_sync()
+{
+	const char* file = "sync_test.log";
+	remove(file);
+	cch::Logger::ptr logger(new cch::Logger("sync_test"));
+	logger->setFormatter("%p %m%n");
+	cch::FileLogAppender::ptr appender(new cch::FileLogAppender(file));
+	appender->setSyncPolicy(cch::FileLogAppender::SYNC_FATAL);
+	appender->setAsync(64 * 1024, 1000);
+	logger->addAppender(appender);
+	const int N = 1000;
+	for (int i = 0; i < N; ++i)
+	{
+		CCH_LOG_INFO(logger) << "rec " << i;
+	}
+	//FATALһдͬŷأ֮ǰINFOͬһ
+	CCH_LOG_FATAL(logger) << "fatal";
+	std::string content = read_file(file);
+	cch::FileLogAppender::FlushStats stats = appender->getFlushStats();
+	bool ok = content.find("FATAL fatal\n") != std::string::npos && stats.syncs == 1
+		&& stats.flushes < (uint64_t)N && stats.bytes == content.size();
+	logger->clearAppenders();
+	appender.reset();
+	remove(file);
+
+	//ͬûʱҲһͬ
+	cch::FileLogAppender::ptr interval(new cch::FileLogAppender(file));
+	interval->setSyncPolicy(cch::FileLogAppender::SYNC_INTERVAL, 10);
+	interval->setAsync(64 * 1024, 5);
+	logger->addAppender(interval);
+	for (int i = 0; i < N; ++i)
+	{
+		CCH_LOG_INFO(logger) << "rec " << i;
+	}
+	usleep(100 * 1000);
+	stats = interval->getFlushStats();
+	ok = ok && stats.syncs > 0 && stats.max_sync_ns > 0 && stats.sync_ns >= stats.max_sync_ns;
+	logger->clearAppenders();
+	interval.reset();
+	remove(file);
+
+	//д׼fd 1ضļ
+	const char* out_file = "sync_stdout.log";
+	std::cout.flush();
+	int saved = dup(STDOUT_FILENO);
+	int fd = open(out_file, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	dup2(fd, STDOUT_FILENO);
+	close(fd);
+	cch::StdoutLogAppender::ptr out(new cch::StdoutLogAppender);
+	out->setAsync(64 * 1024, 5);
+	logger->addAppender(out);
+	for (int i = 0; i < N; ++i)
+	{
+		CCH_LOG_INFO(logger) << "out " << i;
+	}
+	usleep(50 * 1000);
+	stats = out->getFlushStats();
+	logger->clearAppenders();
+	out.reset();
+	dup2(saved, STDOUT_FILENO);
+	close(saved);
+	std::ifstream in(out_file);
+	std::string line;
+	int lines = 0;
+	while (std::getline(in, line))
+	{
+		ok = ok && line == "INFO out " + std::to_string(lines);
+		++lines;
+	}
+	ok = ok && lines == N && stats.flushes > 0 && stats.flushes < (uint64_t)N;
+	remove(out_file);
+	std::cout << "test_log_group_sync: flushes=" << stats.flushes << " " << (ok ? "ok" : "FAILED") << std::endl;
+	return ok;
+}
+
+//ÿյͬʱһ̲߳ͣ¼ãʼĳһֵڼ䲻
+bool test_config_snapshot()
+{
+	const int N = 1000;
+	cch::ConfigVar<std::vector<int> >::ptr var =
+		cch::Config::Lookup("test.snapshot", std::vector<int>(N, 0), "snapshot test");
+	bool ok = var != nullptr;
+	{
+		cch::ConfigVar<std::vector<int> >::Snapshot held(*var);
+		var->setValue(std::vector<int>(N, 1));
+		ok = ok && held->size() == (size_t)N && held->front() == 0 && held->back() == 0
+			&& var->getValue().front() == 1;
+	}
+
+	std::atomic<bool> stop(false);
+	std::atomic<bool> torn(false);
+	std::atomic<uint64_t> reads(0);
+	std::vector<std::thread> readers;
+	for (int t = 0; t < 2; ++t)
+	{
+		readers.push_back(std::thread([&]() {
+			while (!stop)
+			{
+				cch::ConfigVar<std::vector<int> >::Snapshot snap(*var);
+				int first = snap->front();
+				for (int v : *snap)
+				{
+					if (v != first)
+					{
+						torn = true;
+					}
+				}
+				++reads;
+			}
+		}));
+	}
+	for (int gen = 2; gen < 200; ++gen)
+	{
+		std::stringstream ss;
+		ss << "test:\n  snapshot: [";
+		for (int i = 0; i < N; ++i)
+		{
+			ss << (i ? "," : "") << gen;
+		}
+		ss << "]";
+		cch::Config::LoadFromYaml(YAML::Load(ss.str()));
+	}
+	stop = true;
+	for (auto& i : readers)
+	{
+		i.join();
+	}
+	ok = ok && !torn && var->getValue().front() == 199 && reads > 0;
+	std::cout << "test_config_snapshot: reads=" << reads << " " << (ok ? "ok" : "FAILED") << std::endl;
+	return ok;
+}
+
+//ֻػLexicalCastûͣҲֱӴӽڵ
+struct TestPoint
+{
+	int x = 0;
+	int y = 0;
+	bool operator==(const TestPoint& o) const { return x == o.x && y == o.y; }
+};
+
+namespace cch
+{
+	template<>
+	class LexicalCast<std::string, TestPoint>
+	{
+	public:
+		TestPoint operator() (const std::string& v)
+		{
+			YAML::Node node = YAML::Load(v);
+			TestPoint p;
+			p.x = node["x"].as<int>();
+			p.y = node["y"].as<int>();
+			return p;
+		}
+	};
+
+	template<>
+	class LexicalCast<TestPoint, std::string>
+	{
+	public:
+		std::string operator() (const TestPoint& v)
+		{
+			YAML::Node node;
+			node["x"] = v.x;
+			node["y"] = v.y;
+			std::stringstream ss;
+			ss << node;
+			return ss.str();
+		}
+	};
+}
+
+bool test_config_from_node()
+{
+	typedef std::map<std::string, std::vector<TestPoint> > Points;
+	cch::ConfigVar<Points>::ptr points = cch::Config::Lookup("test.points", Points(), "");
+	cch::ConfigVar<std::map<std::string, std::vector<int> > >::ptr nested =
+		cch::Config::Lookup("test.nested", std::map<std::string, std::vector<int> >(), "");
+	cch::Config::LoadFromYaml(YAML::Load("test:\n  points: {a: [{x: 1, y: 2}, {x: 3, y: 4}]}\n"
+		"  nested: {k: [5, 6]}\n"));
+	Points p = points->getValue();
+	bool ok = p.size() == 1 && p["a"].size() == 2 && p["a"][1].x == 3 && p["a"][1].y == 4
+		&& nested->getValue().at("k") == std::vector<int>{ 5, 6 };
+	//toStringĽԭػ
+	Points copy = cch::LexicalCast<std::string, Points>()(points->toString());
+	ok = ok && copy == p;
+	std::cout << "test_config_from_node: " << (ok ? "ok" : "FAILED") << std::endl;
+	return ok;
+}
+
+//'.'ļǶдҵע޹صֱ
+bool test_config_prefix()
+{
+	cch::ConfigVar<int>::ptr a = cch::Config::Lookup("test.prefix.a", 0, "");
+	cch::ConfigVar<int>::ptr c = cch::Config::Lookup("test.prefix.b.c", 0, "");
+	cch::ConfigVar<std::map<std::string, int> >::ptr b =
+		cch::Config::Lookup("test.prefix.b", std::map<std::string, int>(), "");
+	cch::Config::LoadFromYaml(YAML::Load("test:\n  prefix.a: 5\n  prefix:\n    b: {c: 7, d: 8}\n"
+		"  unrelated: {x: [1, 2], y: {z: 3}}\n"));
+	bool ok = a->getValue() == 5 && c->getValue() == 7 && b->getValue().size() == 2
+		&& b->getValue().at("d") == 8;
+	std::cout << "test_config_prefix: " << (ok ? "ok" : "FAILED") << std::endl;
+	return ok;
+}
+
+//߳ͬʱעᡢһ̲߳ͣLoadFromYamlTSanҪûݾ
+bool test_config_registry_stress()
+{
+	const int KEYS = 64;
+	std::atomic<bool> ok(true);
+	std::atomic<bool> stop(false);
+	std::thread loader([&]() {
+		for (int round = 0; !stop; ++round)
+		{
+			std::stringstream ss;
+			ss << "test:\n  stress:\n";
+			for (int k = 0; k < KEYS; ++k)
+			{
+				ss << "    k" << k << ": " << round << "\n";
+			}
+			cch::Config::LoadFromYaml(YAML::Load(ss.str()));
+		}
+	});
+	std::vector<std::thread> threads;
+	for (int t = 0; t < 4; ++t)
+	{
+		threads.push_back(std::thread([&, t]() {
+			char name[64];
+			for (int i = 0; i < 2000; ++i)
+			{
+				int k = (i * 7 + t) % KEYS;
+				int len = snprintf(name, sizeof(name), "test.stress.k%d", k);
+				if (i % 2)
+				{
+					ok = ok && cch::Config::Lookup(name, 0, "") != nullptr;
+				}
+				cch::ConfigVarBase::ptr var = cch::Config::LookupBase(name, len);
+				if (var)
+				{
+					ok = ok && var->getName() == name;
+				}
+#if __cplusplus >= 201703L
+				ok = ok && cch::Config::LookupBase(std::string_view(name, len)) == var;
+#endif
+			}
+		}));
+	}
+	for (auto& i : threads)
+	{
+		i.join();
+	}
+	stop = true;
+	loader.join();
+	//ƶעֻһʵ
+	cch::Config::LoadFromYaml(YAML::Load("test:\n  stress:\n    k0: 12345\n"));
+	for (int k = 0; k < KEYS; ++k)
+	{
+		std::string name = "test.stress.k" + std::to_string(k);
+		ok = ok && cch::Config::Lookup<int>(name) == cch::Config::Lookup(name, 0, "");
+	}
+	ok = ok && cch::Config::Lookup<int>("test.stress.k0")->getValue() == 12345
+		&& cch::Config::LookupBase("test.stress.missing") == nullptr;
+	std::cout << "test_config_registry_stress: " << (ok ? "ok" : "FAILED") << std::endl;
+	return ok;
+}
+
+bool test_config_handle()
+{
+	static_assert(cch::ConfigNameHash("a", 1) == 0xaf63dc4c8601ec8cULL, "FNV-1a");
+	auto& port = CCH_CONFIG_VAR(int, "test.handle.port", 8080, "port");
+	bool ok = port->getValue() == 8080 && port.get() == cch::Config::Lookup<int>("test.handle.port");
+	//ͬһڱչһΣõͬһ
+	ok = ok && CCH_CONFIG_VAR(int, "test.handle.port", 1, "").get() == port.get();
+	cch::Config::LoadFromYaml(YAML::Load("test:\n  handle:\n    port: 9090\n"));
+	ok = ok && port->getValue() == 9090;
+	//Ͳһעʱ
+	bool thrown = false;
+	try
+	{
+		CCH_CONFIG_VAR(std::string, "test.handle.port", "x", "");
+	}
+	catch (std::invalid_argument& e)
+	{
+		thrown = std::string(e.what()).find("test.handle.port") != std::string::npos;
+	}
+	ok = ok && thrown && cch::Config::Lookup<int>("test.handle.port") == port.get();
+	std::cout << "test_config_handle: " << (ok ? "ok" : "FAILED") << std::endl;
+	return ok;
+}
+
+int main(int /*argc*/, char** /*argv*/)
+{
+	bool ok = test_log_no_alloc();
+	ok = test_binary_roundtrip() && ok;
+	ok = test_log_rolling() && ok;
+	ok = test_mmap_appender() && ok;
+	ok = test_mmap_open_failure() && ok;
+	ok = test_mmap_rollover_reload() && ok;
+	ok = test_log_fmt_precision() && ok;
+	ok = test_log_rate_limit() && ok;
+	ok = test_log_fan_out() && ok;
+	ok = test_flight_recorder() && ok;
+	ok = test_log_site_cache() && ok;
+	ok = test_log_print() && ok;
+	ok = test_log_hierarchy() && ok;
+	ok = test_log_hot_reload() && ok;
+	ok = test_log_reload_trim() && ok;
+	ok = test_log_compress() && ok;
+	ok = test_log_time_index() && ok;
+	ok = test_log_structured() && ok;
+	ok = test_log_group_sync() && ok;
+	ok = test_config_snapshot() && ok;
+	ok = test_config_from_node() && ok;
+	ok = test_config_prefix() && ok;
+	ok = test_config_registry_stress() && ok;
+	ok = test_config_handle() && ok;
+	ok = test_rcu_retire_in_read() && ok;
+	ok = test_log_blocking_appender() && ok;
+	ok = test_log_reload_stress() && ok;
+	std::cout << (ok ? "PASS" : "FAIL") << std::endl;
+	return ok ? 0 : 1;
+}
@@ -1,4 +1,5 @@
 #include "util.h"
+#include <time.h>
 namespace cch {
 	pid_t GetThreadId()
 	{
@@ -10,4 +11,11 @@ namespace cch {
 		return 0;
 	}
 
+	uint64_t GetCurrentUS()
+	{
+		struct timespec ts;
+		clock_gettime(CLOCK_REALTIME_COARSE, &ts);
+		return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+	}
+
 }
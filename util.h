@@ -10,6 +10,8 @@
 namespace cch {
 	pid_t GetThreadId();
 	uint32_t GetFiberId();
+	//ǰʱ(΢)ȡCLOCK_REALTIME_COARSEֻм룬Ϊںtick(ͨ1~4)
+	uint64_t GetCurrentUS();
 }
 
 #endif // !__CCH_UTIL_H__